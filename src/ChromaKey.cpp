@@ -0,0 +1,399 @@
+/**
+ @file   ChromaKey.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Class to replace the background of the RGB frame with an image, using the user map of the tracker.
+*/
+
+#include "ChromaKey.h"
+
+#include <cstring>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h> // Include for SSE2 intrinsics
+#endif
+
+using namespace std;
+using namespace cv;
+
+
+/** Builds the background mask of a band of rows of the user map */
+class ChromaMaskBody : public ParallelLoopBody
+{
+	public:
+		ChromaMaskBody(const unsigned short *userMap, int mapStride, Mat &mask) : userMap(userMap), mapStride(mapStride), mask(mask) {}
+
+		void operator()(const Range &range) const
+		{
+			for (int y = range.start; y < range.end; y++)
+			{
+				const unsigned short *labels = (const unsigned short*)((const uchar*)userMap + y * mapStride);
+				ChromaKey::buildMaskRow(labels, mask.ptr(y), mask.cols);
+			}
+		}
+
+	private:
+		const unsigned short *userMap;
+		int mapStride;
+		Mat &mask;
+};
+
+
+/** Copies the background into a band of rows of the RGB frame, wherever the dilated mask is set */
+class ChromaBlendBody : public ParallelLoopBody
+{
+	public:
+		ChromaBlendBody(const Mat &mask, const Mat &background, Mat &frameColor) : mask(mask), background(background), frameColor(frameColor) {}
+
+		void operator()(const Range &range) const
+		{
+			// Row buffer of this band, used to dilate the mask
+			vector<uchar> rowBuffer(2 * mask.cols + 2);
+
+			for (int y = range.start; y < range.end; y++)
+			{
+				// The rows outside the map are replaced by the row itself
+				const uchar *maskAbove = mask.ptr(y > 0 ? y - 1 : y);
+				const uchar *maskBelow = mask.ptr(y < mask.rows - 1 ? y + 1 : y);
+
+				ChromaKey::blendRow(maskAbove, mask.ptr(y), maskBelow, background.ptr(y), frameColor.ptr(y), mask.cols, &rowBuffer[0]);
+			}
+		}
+
+	private:
+		const Mat &mask;
+		const Mat &background;
+		Mat &frameColor;
+};
+
+
+/**
+ Makes a band of rows of the final frame in a single pass: each pixel of the RGB image of the sensor is
+ read once, and written once in its mirrored position, either with its channels in BGR or replaced by
+ the background. The background mask is built for each row as it is needed, so no full mask is stored.
+*/
+class ChromaComposeBody : public ParallelLoopBody
+{
+	public:
+		ChromaComposeBody(const Mat &sensorColor, bool isRgb, const unsigned short *userMap, int mapStride, const Mat &backgroundMirrored, Mat &frameColor)
+			: sensorColor(sensorColor), isRgb(isRgb), userMap(userMap), mapStride(mapStride), backgroundMirrored(backgroundMirrored), frameColor(frameColor) {}
+
+		void operator()(const Range &range) const
+		{
+			int width = frameColor.cols;
+			int lastRow = frameColor.rows - 1;
+
+			// Without background, the pixels are only mirrored
+			if (backgroundMirrored.empty())
+			{
+				for (int y = range.start; y < range.end; y++)
+					ChromaKey::composeRowMirrored(sensorColor.ptr(y), isRgb, NULL, NULL, frameColor.ptr(y), width);
+
+				return;
+			}
+
+			// Three rows of the mask, used in turns, and the row buffer used to dilate them
+			vector<uchar> maskRows(3 * width);
+			vector<uchar> rowBuffer(2 * width + 2);
+			uchar *maskAbove = &maskRows[0];
+			uchar *mask = &maskRows[width];
+			uchar *maskBelow = &maskRows[2 * width];
+
+			// The rows outside the map are replaced by the row itself
+			ChromaKey::buildMaskRow(labels(range.start > 0 ? range.start - 1 : range.start), maskAbove, width);
+			ChromaKey::buildMaskRow(labels(range.start), mask, width);
+
+			for (int y = range.start; y < range.end; y++)
+			{
+				ChromaKey::buildMaskRow(labels(y < lastRow ? y + 1 : y), maskBelow, width);
+
+				const uchar *dilated = ChromaKey::dilateRow(maskAbove, mask, maskBelow, width, &rowBuffer[0]);
+				ChromaKey::composeRowMirrored(sensorColor.ptr(y), isRgb, dilated, backgroundMirrored.ptr(y), frameColor.ptr(y), width);
+
+				// The current row is the row above of the next one, and so on
+				uchar *oldAbove = maskAbove;
+				maskAbove = mask;
+				mask = maskBelow;
+				maskBelow = oldAbove;
+			}
+		}
+
+	private:
+		const unsigned short *labels(int y) const
+		{
+			return (const unsigned short*)((const uchar*)userMap + y * mapStride);
+		}
+
+		const Mat &sensorColor;
+		bool isRgb;
+		const unsigned short *userMap;
+		int mapStride;
+		const Mat &backgroundMirrored;
+		Mat &frameColor;
+};
+
+
+/**
+ Constructor. There is no background until @ref setBackground is called.
+*/
+ChromaKey::ChromaKey()
+{
+}
+
+
+/**
+ Destructor.
+*/
+ChromaKey::~ChromaKey()
+{
+}
+
+
+/**
+ Sets the image shown in the background. The image is scaled only once, the first time it is applied to a frame.
+
+ @param [in] frameImageLoaded Image to show in the background.
+
+ @return Nothing.
+*/
+void ChromaKey::setBackground(const cv::Mat &frameImageLoaded)
+{
+	// If the image is the same one, the scaled background is kept
+	if (frameImageLoaded.data == backgroundLoaded.data && frameImageLoaded.size() == backgroundLoaded.size())
+		return;
+
+	backgroundLoaded = frameImageLoaded;
+	background.release();
+	backgroundMirrored.release();
+}
+
+
+/**
+ Overwrites all points of the RGB frame where there is not any user with the background image. The background
+ mask is dilated one pixel, so the edge of the users is covered in the same way as before.
+
+ @param [out] frameColor Frame containing the image of the RGB sensor, in BGR.
+ @param [in] userMap Pixels of the user map. 0 means there is no user in that pixel.
+ @param [in] mapWidth Width of the user map.
+ @param [in] mapHeight Height of the user map.
+ @param [in] mapStride Size in bytes of a row of the user map.
+
+ @return Nothing.
+*/
+void ChromaKey::apply(cv::Mat &frameColor, const unsigned short *userMap, int mapWidth, int mapHeight, int mapStride)
+{
+	if (backgroundLoaded.empty() || frameColor.empty() || userMap == NULL)
+		return;
+
+	// Scales the background to the size of the frame, only if it was not scaled yet
+	if (background.size() != frameColor.size())
+		resize(backgroundLoaded, background, frameColor.size());
+
+	// Only the area covered by both the user map and the frame is processed
+	int width = (mapWidth < frameColor.cols) ? mapWidth : frameColor.cols;
+	int height = (mapHeight < frameColor.rows) ? mapHeight : frameColor.rows;
+
+	// The mask is only allocated again if the size changes
+	mask.create(height, width, CV_8U);
+
+	// Builds the mask, and then copies the background, dividing the rows between the cores
+	parallel_for_(Range(0, height), ChromaMaskBody(userMap, mapStride, mask));
+	parallel_for_(Range(0, height), ChromaBlendBody(mask, background, frameColor));
+}
+
+
+/**
+ Makes the final RGB frame from the image of the sensor in a single pass: the channels are put in BGR,
+ the background image is inserted where there is no user, and the frame is flipped around the y-axis so
+ it looks like a mirror. It gives the same frame as cvtColor(), @ref apply and flip(), one after the other.
+
+ @param [in] sensorColor Image of the RGB sensor. It is not modified.
+ @param [in] isRgb True if the image of the sensor is in RGB, false if it is already in BGR.
+ @param [in] userMap Pixels of the user map. 0 means there is no user in that pixel.
+ @param [in] mapWidth Width of the user map.
+ @param [in] mapHeight Height of the user map.
+ @param [in] mapStride Size in bytes of a row of the user map.
+ @param [out] frameColor Final frame, in BGR and mirrored. It must not share its data with the image of the sensor.
+
+ @return True if the frame was made, false if the user map and the image of the sensor have different sizes.
+*/
+bool ChromaKey::applyMirrored(const cv::Mat &sensorColor, bool isRgb, const unsigned short *userMap, int mapWidth, int mapHeight, int mapStride, cv::Mat &frameColor)
+{
+	if (sensorColor.empty() || sensorColor.type() != CV_8UC3)
+		return false;
+
+	// The mask is built from the user map, so it must cover the whole image
+	if (!backgroundLoaded.empty() && (userMap == NULL || mapWidth != sensorColor.cols || mapHeight != sensorColor.rows))
+		return false;
+
+	// Scales and flips the background, only if it was not done yet
+	if (!backgroundLoaded.empty() && backgroundMirrored.size() != sensorColor.size())
+	{
+		resize(backgroundLoaded, background, sensorColor.size());
+		flip(background, backgroundMirrored, 1);
+	}
+
+	// The frame is only allocated again if the size changes
+	frameColor.create(sensorColor.size(), CV_8UC3);
+
+	parallel_for_(Range(0, sensorColor.rows), ChromaComposeBody(sensorColor, isRgb, userMap, mapStride, backgroundMirrored, frameColor));
+
+	return true;
+}
+
+
+/**
+ Converts a row of the user map into a row of the background mask.
+
+ @param [in] labels Row of the user map.
+ @param [out] mask Row of the mask. 255 where there is no user, 0 otherwise.
+ @param [in] width Number of pixels of the row.
+
+ @return Nothing.
+*/
+void ChromaKey::buildMaskRow(const unsigned short *labels, uchar *mask, int width)
+{
+	int x = 0;
+
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+
+	// 16 pixels at a time: the comparison gives 0xFFFF for empty pixels, which is packed to 0xFF
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i low = _mm_cmpeq_epi16( _mm_loadu_si128((const __m128i*)(labels + x)), zero );
+		__m128i high = _mm_cmpeq_epi16( _mm_loadu_si128((const __m128i*)(labels + x + 8)), zero );
+
+		_mm_storeu_si128( (__m128i*)(mask + x), _mm_packs_epi16(low, high) );
+	}
+#endif
+
+	for (; x < width; x++)
+		mask[x] = (labels[x] == 0) ? 255 : 0;
+}
+
+
+/**
+ Dilates a row of the mask with a 3x3 square.
+
+ @param [in] maskAbove Row of the mask above the current one.
+ @param [in] mask Current row of the mask.
+ @param [in] maskBelow Row of the mask below the current one.
+ @param [in] width Number of pixels of the row.
+ @param [out] rowBuffer Auxiliary buffer of (2 * width + 2) bytes.
+
+ @return The dilated row, stored inside the auxiliary buffer.
+*/
+const uchar *ChromaKey::dilateRow(const uchar *maskAbove, const uchar *mask, const uchar *maskBelow, int width, uchar *rowBuffer)
+{
+	// Vertical dilation, with a zero at both ends of the row
+	uchar *vertical = rowBuffer + 1;
+	// Horizontal dilation of the previous one
+	uchar *dilated = rowBuffer + width + 2;
+	int x = 0;
+
+	vertical[-1] = 0;
+	vertical[width] = 0;
+
+#ifdef __SSE2__
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i rows = _mm_or_si128( _mm_loadu_si128((const __m128i*)(maskAbove + x)), _mm_loadu_si128((const __m128i*)(mask + x)) );
+		_mm_storeu_si128( (__m128i*)(vertical + x), _mm_or_si128(rows, _mm_loadu_si128((const __m128i*)(maskBelow + x))) );
+	}
+#endif
+
+	for (; x < width; x++)
+		vertical[x] = maskAbove[x] | mask[x] | maskBelow[x];
+
+	x = 0;
+
+#ifdef __SSE2__
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i sides = _mm_or_si128( _mm_loadu_si128((const __m128i*)(vertical + x - 1)), _mm_loadu_si128((const __m128i*)(vertical + x + 1)) );
+		_mm_storeu_si128( (__m128i*)(dilated + x), _mm_or_si128(sides, _mm_loadu_si128((const __m128i*)(vertical + x))) );
+	}
+#endif
+
+	for (; x < width; x++)
+		dilated[x] = vertical[x - 1] | vertical[x] | vertical[x + 1];
+
+	return dilated;
+}
+
+
+/**
+ Dilates a row of the mask with a 3x3 square and copies the background into the pixels of the frame covered by it.
+
+ @param [in] maskAbove Row of the mask above the current one.
+ @param [in] mask Current row of the mask.
+ @param [in] maskBelow Row of the mask below the current one.
+ @param [in] background Row of the background image, in BGR.
+ @param [out] frame Row of the RGB frame, in BGR.
+ @param [in] width Number of pixels of the row.
+ @param [out] rowBuffer Auxiliary buffer of (2 * width + 2) bytes.
+
+ @return Nothing.
+*/
+void ChromaKey::blendRow(const uchar *maskAbove, const uchar *mask, const uchar *maskBelow, const uchar *background, uchar *frame, int width, uchar *rowBuffer)
+{
+	const uchar *dilated = dilateRow(maskAbove, mask, maskBelow, width, rowBuffer);
+	int x = 0;
+
+	// Copies every run of background pixels with a single copy
+	while (x < width)
+	{
+		// Skips the pixels of the users
+		while (x < width && dilated[x] == 0)
+			x++;
+
+		int start = x;
+
+		while (x < width && dilated[x] != 0)
+			x++;
+
+		if (x > start)
+			memcpy(frame + 3 * start, background + 3 * start, 3 * (x - start));
+	}
+}
+
+
+/**
+ Writes a row of the final frame: the row of the sensor is mirrored, and every pixel is either put in BGR
+ or replaced by the background, if the dilated mask is set in its original position.
+
+ @param [in] sensor Row of the image of the sensor.
+ @param [in] isRgb True if the row of the sensor is in RGB, false if it is already in BGR.
+ @param [in] dilated Dilated row of the mask, in the coordinates of the sensor, or NULL if there is no background.
+ @param [in] backgroundMirrored Row of the mirrored background image, in BGR. Not used if 'dilated' is NULL.
+ @param [out] frame Row of the final frame, in BGR.
+ @param [in] width Number of pixels of the row.
+
+ @return Nothing.
+*/
+void ChromaKey::composeRowMirrored(const uchar *sensor, bool isRgb, const uchar *dilated, const uchar *backgroundMirrored, uchar *frame, int width)
+{
+	// The channels of the sensor that go to the blue and the red channel of the frame
+	int blue = isRgb ? 2 : 0;
+	int red = isRgb ? 0 : 2;
+
+	for (int x = 0; x < width; x++, frame += 3)
+	{
+		int source = width - 1 - x;
+
+		if (dilated != NULL && dilated[source] != 0)
+		{
+			frame[0] = backgroundMirrored[3 * x];
+			frame[1] = backgroundMirrored[3 * x + 1];
+			frame[2] = backgroundMirrored[3 * x + 2];
+		}
+		else
+		{
+			frame[0] = sensor[3 * source + blue];
+			frame[1] = sensor[3 * source + 1];
+			frame[2] = sensor[3 * source + red];
+		}
+	}
+}
@@ -0,0 +1,38 @@
+/**
+ @file   ChromaKey.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Class to replace the background of the RGB frame with an image, using the user map of the tracker.
+*/
+
+#ifndef CHROMAKEY_H
+#define CHROMAKEY_H
+
+#include "cvaux.h" // Include for OpenCV
+
+
+using namespace std;
+
+class ChromaKey
+{
+	public:
+		ChromaKey();
+		~ChromaKey();
+
+		void setBackground(const cv::Mat &frameImageLoaded);
+		void apply(cv::Mat &frameColor, const unsigned short *userMap, int mapWidth, int mapHeight, int mapStride);
+		bool applyMirrored(const cv::Mat &sensorColor, bool isRgb, const unsigned short *userMap, int mapWidth, int mapHeight, int mapStride, cv::Mat &frameColor);
+
+		static void buildMaskRow(const unsigned short *labels, uchar *mask, int width);
+		static const uchar *dilateRow(const uchar *maskAbove, const uchar *mask, const uchar *maskBelow, int width, uchar *rowBuffer);
+		static void blendRow(const uchar *maskAbove, const uchar *mask, const uchar *maskBelow, const uchar *background, uchar *frame, int width, uchar *rowBuffer);
+		static void composeRowMirrored(const uchar *sensor, bool isRgb, const uchar *dilated, const uchar *backgroundMirrored, uchar *frame, int width);
+
+	private:
+		cv::Mat backgroundLoaded; /** Background image as it was loaded */
+		cv::Mat background; /** Background image scaled to the size of the RGB frame */
+		cv::Mat backgroundMirrored; /** Scaled background image, flipped around the y-axis */
+		cv::Mat mask; /** One byte per pixel: 255 where there is no user, 0 otherwise */
+};
+
+#endif
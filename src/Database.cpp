@@ -10,19 +10,29 @@
 #include <sqlite3.h> // Include for SQLite
 #include <sstream> // Include for string type
 #include <cstring>
-#include <cstdlib> // Include for atoi() function
+#include <cstdlib> // Include for atoi(), strtol() and realpath() functions
+#include <iostream>
+#include <unistd.h> // Include for usleep() function
 
 using namespace std;
 
 
 /**
  Constructor
+
+ @param [in] path Path of the database file. By default, the database of the application.
 */
-Database::Database()
+Database::Database(string path)
 {
+	this->path = path;
+	db = NULL;
+	memset(&stats, 0, sizeof(stats));
+	busyTimeout = 0;
+	busyWaitedMs = 0;
+
 	// Opens the database everytime an object is declarated
 	openDatabase();
-	// Creates the tables of the database if they do not exist yet
+	// Brings the tables of the database to the last version, only the first time the file is opened
 	createTables();
 }
 
@@ -43,8 +53,17 @@ Database::~Database()
 */
 bool Database::openDatabase()
 {
-	// Opens the database saved in the file 'database.db'
-	rc = sqlite3_open("database.db", &db);
+	// Opens the database saved in the file 'database.db', or in the file given to the constructor
+	rc = sqlite3_open(path.c_str(), &db);
+
+	if ( rc != SQLITE_OK )
+		return false;
+
+	// The settings of the connection are not saved in the file, so they are set every time it is opened
+	setBusyTimeout(config.busyTimeout);
+
+	string statement = "PRAGMA synchronous = " + config.synchronous + "; PRAGMA wal_autocheckpoint = " + itos(config.checkpointPages) + ";";
+	rc = sqlite3_exec(db, statement.c_str(), 0, 0, NULL);
 
 	if ( rc != SQLITE_OK )
 		return false;
@@ -58,21 +77,358 @@ bool Database::openDatabase()
 */
 void Database::closeDatabase()
 {
-	do
+	sqlite3_stmt *stmt;
+
+	// Destroys the prepared statements, otherwise the connection would stay busy forever
+	for(map<string, sqlite3_stmt*>::iterator it = statements.begin(); it != statements.end(); ++it)
+		sqlite3_finalize(it->second);
+	statements.clear();
+
+	// Destroys any other statement left, which is the only reason why the connection cannot be closed
+	while( db != NULL && (stmt = sqlite3_next_stmt(db, NULL)) != NULL )
+		sqlite3_finalize(stmt);
+
+	// Destroys the sqlite3 object
+	rc = sqlite3_close(db);
+
+	if( rc != SQLITE_OK )
+		cout << "ERROR: The database " << path << " cannot be closed: " << sqlite3_errmsg(db) << endl;
+	else
+		db = NULL;
+}
+
+
+
+/**
+ Changes the journal of the database file to a write-ahead log. With the log, the readers do not block the
+ writer and the writer does not block the readers, so a connection can stay open for a long time while
+ other programs write in the file. The mode is saved in the file, so it is kept by all the connections.
+
+ @return True if the database uses the write-ahead log, false otherwise.
+*/
+bool Database::enableWriteAheadLog()
+{
+	sqlite3_stmt *stmt = NULL;
+	bool wal = false;
+
+	rc = sqlite3_prepare_v2(db, "PRAGMA journal_mode = WAL;", -1, &stmt, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	// The pragma returns the mode in use, which is the old one if the log cannot be used
+	rc = sqlite3_step(stmt);
+	if( rc == SQLITE_ROW && sqlite3_column_text(stmt, 0) != NULL )
+		wal = (strcmp((const char*)sqlite3_column_text(stmt, 0), "wal") == 0);
+
+	sqlite3_finalize(stmt);
+
+	if( !wal )
+		cout << "ERROR: The database " << path << " cannot use a write-ahead log." << endl;
+
+	return wal;
+}
+
+
+/**
+ Sets the time that a statement waits for the lock of another connection before it fails. The waits are
+ counted in the statistics of the connection.
+
+ @param [in] milliseconds Time to wait, in milliseconds. 0 to fail at once.
+
+ @return True if the time was set, false otherwise.
+*/
+bool Database::setBusyTimeout(int milliseconds)
+{
+	busyTimeout = (milliseconds > 0) ? milliseconds : 0;
+
+	rc = sqlite3_busy_handler(db, (busyTimeout > 0) ? busyHandler : NULL, this);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	return true;
+}
+
+
+/**
+ Called by SQLite when the database is locked by another connection. Waits a little longer every time,
+ until the busy timeout of the connection is over.
+
+ @param [in] data The connection that is waiting.
+ @param [in] count Number of times it was called for the same lock.
+
+ @return 1 to try again, 0 to give up and return SQLITE_BUSY.
+*/
+int Database::busyHandler(void *data, int count)
+{
+	Database *database = (Database*)data;
+	int wait;
+
+	// The first call of a lock starts a new wait
+	if( count == 0 )
+	{
+		database->stats.busyWaits++;
+		database->busyWaitedMs = 0;
+	}
+
+	if( database->busyWaitedMs >= database->busyTimeout )
+		return 0;
+
+	// 1, 2, 4, 8 and 16 milliseconds, and then 20 milliseconds until the time is over
+	wait = (count < 5) ? (1 << count) : 20;
+	if( wait > database->busyTimeout - database->busyWaitedMs )
+		wait = database->busyTimeout - database->busyWaitedMs;
+
+	usleep(wait * 1000);
+
+	database->busyWaitedMs += wait;
+	database->stats.busyWaitMs += wait;
+
+	return 1;
+}
+
+
+/**
+ Gets the settings of the connections by default, given by the macros.
+
+ @return The settings by default.
+*/
+DatabaseConfig Database::defaultConfig()
+{
+	DatabaseConfig config;
+
+	config.synchronous = DATABASE_SYNCHRONOUS;
+	config.checkpointPages = DATABASE_CHECKPOINT_PAGES;
+	config.busyTimeout = DATABASE_BUSY_TIMEOUT;
+	config.busyRetries = DATABASE_BUSY_RETRIES;
+
+	return config;
+}
+
+
+/**
+ Reads the settings of the connections from a text: 'synchronous[:checkpointPages[:busyTimeoutMs[:busyRetries]]]',
+ where the synchronous level is 'off', 'normal' or 'full' and the rest are whole numbers, 0 or greater. The
+ settings not given keep their default value.
+
+ @param [in] text Text with the settings.
+ @param [out] config Settings of the connections.
+
+ @return True if the text is valid, false otherwise.
+*/
+bool Database::parseConfig(string text, DatabaseConfig &config)
+{
+	istringstream stream(text);
+	string field;
+	int *parameters[3];
+	char *end;
+	long value;
+
+	config = defaultConfig();
+	parameters[0] = &config.checkpointPages;
+	parameters[1] = &config.busyTimeout;
+	parameters[2] = &config.busyRetries;
+
+	getline(stream, field, ':');
+
+	if (field == "off")
+		config.synchronous = "OFF";
+	else if (field == "normal")
+		config.synchronous = "NORMAL";
+	else if (field == "full")
+		config.synchronous = "FULL";
+	else
+		return false;
+
+	for (int i = 0; getline(stream, field, ':'); i++)
 	{
-		// Destroys the sqlite3 object
-		rc = sqlite3_close(db);
-	}while(rc == SQLITE_BUSY); // If the database connection has outstanding statements, then tries again.
+		if (i >= 3 || field.empty())
+			return false;
+
+		// The whole field must be a number: a wrong value could disable the checkpoints without notice
+		value = strtol(field.c_str(), &end, 10);
+		if (*end != '\0' || value < 0 || value > 2147483647L)
+			return false;
+
+		*parameters[i] = (int)value;
+	}
+
+	return true;
 }
 
 
+/**
+ Sets the settings of the connections opened from now on. It must be called before the threads that use the
+ database are started.
+
+ @param [in] config Settings of the connections.
+
+ @return Nothing.
+*/
+void Database::setConfig(const DatabaseConfig &config)
+{
+	Database::config = config;
+}
+
 
 /**
- Creates the tables of the database if they do not exist yet.
+ Gets the counters of the waits of this connection for the locks of other connections.
 
- @return True if the tables were created successfully, false otherwise.
+ @return The counters of the connection.
+*/
+DatabaseStats Database::getStats()
+{
+	return stats;
+}
+
+
+
+/** Settings of the connections opened from now on */
+DatabaseConfig Database::config = Database::defaultConfig();
+
+/** Migrations of the tables, in order. Each one brings the tables from the version before it to its version */
+const Database::Migration Database::migrations[] =
+{
+	{1, "tables of users, specialists and games", &Database::createBaseTables},
+	{2, "samples keyed by game and frame, and indexes", &Database::keyGameDataByFrame},
+	{3, "games without an end date until they finish", &Database::allowUnfinishedGames}
+};
+
+/** Database files whose tables are already in the last version, so they are not checked again */
+set<string> Database::currentSchemas;
+
+/** Mutex of 'currentSchemas'. It is held while the tables are migrated, so two connections of the same program never migrate them at the same time */
+pthread_mutex_t Database::schemasMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ Brings the tables of the database to the last version, applying the migrations that the file does not have
+ yet, and changes the journal of the file to a write-ahead log. The tables are checked only the first time a
+ file is opened by the program: after that, the file is known to be current and no statement is run.
+
+ @return True if the tables are in the last version, false otherwise.
 */
 bool Database::createTables()
+{
+	char *fullPath;
+	string key;
+	bool ok = true;
+
+	// The file is identified by its full path. Databases without a file (in memory or temporary) are always checked
+	fullPath = realpath(path.c_str(), NULL);
+	if( fullPath != NULL )
+	{
+		key = fullPath;
+		free(fullPath);
+	}
+
+	pthread_mutex_lock(&schemasMutex);
+
+	if( key.empty() || currentSchemas.find(key) == currentSchemas.end() )
+	{
+		ok = runMigrations();
+
+		// The journal mode is saved in the file, so it is changed only once. Without the log the database still works
+		if( ok && !key.empty() )
+		{
+			enableWriteAheadLog();
+			currentSchemas.insert(key);
+		}
+	}
+
+	pthread_mutex_unlock(&schemasMutex);
+
+	return ok;
+}
+
+
+/**
+ Applies, in order, the migrations newer than the version of the tables of the database file.
+
+ @return True if all the migrations were applied, false otherwise.
+*/
+bool Database::runMigrations()
+{
+	int migrationsNum = sizeof(migrations) / sizeof(migrations[0]);
+	int version = 0;
+
+	if( !getSchemaVersion(version) )
+	{
+		cout << "ERROR: The version of the database " << path << " cannot be read." << endl;
+		return false;
+	}
+
+	// A newer application could have changed the tables in a way that this one does not know
+	if( version > DATABASE_SCHEMA_VERSION )
+	{
+		cout << "ERROR: The database " << path << " has the version " << version << ", newer than " << DATABASE_SCHEMA_VERSION << "." << endl;
+		return false;
+	}
+
+	for(int i = 0; i < migrationsNum; i++)
+	{
+		if( migrations[i].version > version && !applyMigration(migrations[i]) )
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ Applies a migration in its own transaction, together with its version number, so a file is never left
+ between two versions. The transaction takes the lock of the file at the beginning and the version is read
+ again inside it, so if another program migrated the file first, the migration is not repeated.
+
+ @param [in] migration Migration to be applied.
+
+ @return True if the migration was applied or it was already applied, false otherwise.
+*/
+bool Database::applyMigration(const Migration &migration)
+{
+	int version = 0;
+
+	if( !beginTransaction() )
+	{
+		cout << "ERROR: The database " << path << " cannot be locked to be migrated." << endl;
+		return false;
+	}
+
+	if( !getSchemaVersion(version) )
+	{
+		rollbackTransaction();
+		return false;
+	}
+
+	if( version < migration.version )
+	{
+		if( !(this->*migration.apply)() || !setSchemaVersion(migration.version) )
+		{
+			cout << "ERROR: The migration " << migration.version << " (" << migration.description << ") of the database " << path << " failed: " << sqlite3_errmsg(db) << endl;
+			rollbackTransaction();
+			return false;
+		}
+	}
+
+	if( !commitTransaction() )
+	{
+		rollbackTransaction();
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ Migration 1. Creates the tables of users, specialists, links between them and games. The databases of
+ the first version of the application have these tables without a version number, so they are only
+ created if they do not exist.
+
+ @return True if the tables were created, false otherwise.
+*/
+bool Database::createBaseTables()
 {
 	// SQL statement to create the 'users' table
 	const char *statement = "CREATE TABLE IF NOT EXISTS USERS ("  \
@@ -132,12 +488,120 @@ bool Database::createTables()
 	if( rc != SQLITE_OK )
 		return false;
 
+	return true;
+}
+
+
+/**
+ Migration 2. Keys the samples of the games by the game and the number of the sample, and creates the
+ indexes of the queries of the application.
+
+ @return True if the tables were changed, false otherwise.
+*/
+bool Database::keyGameDataByFrame()
+{
+	return upgradeGameData() && createIndexes();
+}
+
+
+/**
+ Gets the version of the tables of the database, saved in the 'user_version' of the database file.
+
+ @param [out] version Version of the tables. 0 if the database is new or it was created by the first version of the application.
+
+ @return True if the version was read, false otherwise.
+*/
+bool Database::getSchemaVersion(int &version)
+{
+	sqlite3_stmt *stmt = NULL;
+
+	rc = sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	rc = sqlite3_step(stmt);
+
+	if( rc == SQLITE_ROW )
+		version = sqlite3_column_int(stmt, 0);
+
+	sqlite3_finalize(stmt);
+
+	if( rc != SQLITE_ROW )
+		return false;
+
+	return true;
+}
+
+
+/**
+ Saves the version of the tables in the 'user_version' of the database file.
+
+ @param [in] version Version of the tables.
+
+ @return True if the version was saved, false otherwise.
+*/
+bool Database::setSchemaVersion(int version)
+{
+	string statement = "PRAGMA user_version = " + itos(version) + ";";
+
+	rc = sqlite3_exec(db, statement.c_str(), 0, 0, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	return true;
+}
+
+
+/**
+ Creates the 'game_data' table keyed by the game and the number of the sample, and moves into it the samples
+ of the old table, which was keyed by the second of the game (so only one sample per second was saved). The
+ table has no rowid, so the samples of a game are stored together, in order, in the primary key. It must be
+ called inside a transaction.
+
+ @return True if the table was created and the samples were moved, false otherwise.
+*/
+bool Database::upgradeGameData()
+{
+	string statement;
+	sqlite3_stmt *stmt = NULL;
+	bool oldTable;
+
+	// Checks if there is a 'game_data' table of the first version
+	rc = sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM sqlite_master WHERE type = 'table' AND name = 'GAME_DATA';", -1, &stmt, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	rc = sqlite3_step(stmt);
+	oldTable = (rc == SQLITE_ROW && sqlite3_column_int(stmt, 0) > 0);
+	sqlite3_finalize(stmt);
+
+	if( rc != SQLITE_ROW )
+		return false;
+
+	// If the table already has the number of the sample, it is not changed
+	if( oldTable && sqlite3_prepare_v2(db, "SELECT FRAME_NO FROM GAME_DATA LIMIT 0;", -1, &stmt, NULL) == SQLITE_OK )
+	{
+		sqlite3_finalize(stmt);
+		return true;
+	}
+
+	if( oldTable )
+	{
+		rc = sqlite3_exec(db, "ALTER TABLE GAME_DATA RENAME TO GAME_DATA_OLD;", 0, 0, NULL);
+
+		if( rc != SQLITE_OK )
+			return false;
+	}
 
 	// SQL statement to create the 'game_data' table
-	statement = "CREATE TABLE IF NOT EXISTS GAME_DATA ("  \
-		"TIME                    CURRENT_TIMESTAMP PRIMARY KEY," \
-		"GAME_ID                 INT " \
-		"REFERENCES GAME(GAME_ID) ON DELETE CASCADE ON UPDATE CASCADE," \
+	statement = "CREATE TABLE GAME_DATA ("  \
+		"GAME_ID                 INT                NOT NULL " \
+		"REFERENCES GAMES(GAME_ID) ON DELETE CASCADE ON UPDATE CASCADE," \
+		"FRAME_NO                INT                NOT NULL," \
+		"TIME                    INT                NOT NULL," \
 		"JOINT_HEAD_X            REAL               NOT NULL," \
 		"JOINT_HEAD_Y            REAL               NOT NULL," \
 		"JOINT_NECK_X            REAL               NOT NULL," \
@@ -159,7 +623,68 @@ bool Database::createTables()
 		"JOINT_RIGHT_HIP_X       REAL               NOT NULL," \
 		"JOINT_RIGHT_HIP_Y       REAL               NOT NULL," \
 		"FRUIT_X                 REAL               NOT NULL," \
-		"FRUIT_Y                 REAL               NOT NULL);";
+		"FRUIT_Y                 REAL               NOT NULL," \
+		"PRIMARY KEY(GAME_ID, FRAME_NO))";
+
+	// The tables without rowid need SQLite 3.8.2. Older versions keep the rowid, with the same primary key
+	if( sqlite3_libversion_number() >= 3008002 )
+		statement += " WITHOUT ROWID";
+
+	statement += ";";
+
+	// Runs the previous SQL statement
+	rc = sqlite3_exec(db, statement.c_str(), 0, 0, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	if( oldTable )
+	{
+		// Index to find the first sample of every game, dropped with the old table
+		rc = sqlite3_exec(db, "CREATE INDEX GAME_DATA_OLD_BY_GAME ON GAME_DATA_OLD(GAME_ID);", 0, 0, NULL);
+
+		if( rc != SQLITE_OK )
+			return false;
+
+		// The samples were saved in order, so they are numbered from 0 in every game by their rowid
+		rc = sqlite3_exec(db, "INSERT INTO GAME_DATA SELECT IFNULL(GAME_ID, -1), " \
+			"ROWID - (SELECT MIN(ROWID) FROM GAME_DATA_OLD o WHERE o.GAME_ID IS GAME_DATA_OLD.GAME_ID), IFNULL(TIME, 0), JOINT_HEAD_X, JOINT_HEAD_Y, " \
+			"JOINT_NECK_X, JOINT_NECK_Y, JOINT_LEFT_SHOULDER_X, JOINT_LEFT_SHOULDER_Y, JOINT_RIGHT_SHOULDER_X, JOINT_RIGHT_SHOULDER_Y, " \
+			"JOINT_LEFT_ELBOW_X, JOINT_LEFT_ELBOW_Y, JOINT_RIGHT_ELBOW_X, JOINT_RIGHT_ELBOW_Y, JOINT_LEFT_HAND_X, JOINT_LEFT_HAND_Y, " \
+			"JOINT_RIGHT_HAND_X, JOINT_RIGHT_HAND_Y, JOINT_LEFT_HIP_X, JOINT_LEFT_HIP_Y, JOINT_RIGHT_HIP_X, JOINT_RIGHT_HIP_Y, " \
+			"FRUIT_X, FRUIT_Y FROM GAME_DATA_OLD ORDER BY ROWID;", 0, 0, NULL);
+
+		if( rc != SQLITE_OK )
+			return false;
+
+		rc = sqlite3_exec(db, "DROP TABLE GAME_DATA_OLD;", 0, 0, NULL);
+
+		if( rc != SQLITE_OK )
+			return false;
+	}
+
+	return true;
+}
+
+
+/**
+ Migration 3. Makes the end date of the games optional: a game is saved without it when it starts, to reserve
+ its ID, and it gets it when it finishes. The games quit before the end keep it empty and are not listed.
+ SQLite cannot change a column, so the table is created again with the same rows.
+
+ @return True if the table was changed, false otherwise.
+*/
+bool Database::allowUnfinishedGames()
+{
+	// SQL statement to create the new 'games' table
+	const char *statement = "CREATE TABLE GAMES_NEW ("  \
+		"GAME_ID                INT PRIMARY KEY," \
+		"USER_ID                TEXT " \
+		"REFERENCES USERS(ID) ON DELETE CASCADE ON UPDATE CASCADE," \
+		"START_DATE             TEXT                       NOT NULL," \
+		"END_DATE               TEXT," \
+		"SUCCESSES              INT                        NOT NULL," \
+		"FAILURES               INT                        NOT NULL);";
 
 	// Runs the previous SQL statement
 	rc = sqlite3_exec(db, statement, 0, 0, NULL);
@@ -167,11 +692,212 @@ bool Database::createTables()
 	if( rc != SQLITE_OK )
 		return false;
 
+	rc = sqlite3_exec(db, "INSERT INTO GAMES_NEW SELECT GAME_ID, USER_ID, START_DATE, END_DATE, SUCCESSES, FAILURES FROM GAMES;", 0, 0, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	// The index of the old table is dropped with it
+	rc = sqlite3_exec(db, "DROP TABLE GAMES; ALTER TABLE GAMES_NEW RENAME TO GAMES;", 0, 0, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	return createIndexes();
+}
+
+
+/**
+ Creates the indexes used by the queries of the application: the games of a user and the users of a
+ specialist. The samples of a game are already found by the primary key of 'game_data'.
+
+ @return True if the indexes were created, false otherwise.
+*/
+bool Database::createIndexes()
+{
+	// Index to list the games of a user, in the order of the games
+	rc = sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS GAMES_BY_USER ON GAMES(USER_ID, GAME_ID);", 0, 0, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	// Index to find the links of a specialist, used when the specialist is deleted or renamed
+	rc = sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS USER_SPECIALIST_BY_SPECIALIST ON USER_SPECIALIST(SPECIALIST_ID);", 0, 0, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	return true;
+}
+
+
+/**
+ Starts a transaction, so the next statements are saved together in the database file. The lock for writing
+ is taken at the beginning, so a statement of the transaction never finds the database busy.
+
+ @return True if the transaction was started, false otherwise.
+*/
+bool Database::beginTransaction()
+{
+	return execWithRetries("BEGIN IMMEDIATE TRANSACTION;");
+}
+
+
+/**
+ Commits the current transaction, saving all its statements in the database file at once.
+
+ @return True if the transaction was committed, false otherwise.
+*/
+bool Database::commitTransaction()
+{
+	return execWithRetries("COMMIT TRANSACTION;");
+}
+
+
+/**
+ Discards the statements of the current transaction.
+
+ @return True if the transaction was rolled back, false otherwise.
+*/
+bool Database::rollbackTransaction()
+{
+	rc = sqlite3_exec(db, "ROLLBACK TRANSACTION;", 0, 0, NULL);
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	return true;
+}
+
+
+/**
+ Gets the prepared statement for a SQL text. The statement is compiled the first time it is requested
+ and kept in a cache until the database is closed, so SQLite does not parse it again.
+
+ @param [in] sql SQL text of the statement, with '?' in place of the values.
+
+ @return The prepared statement, ready to bind its values, or NULL if it could not be compiled.
+*/
+sqlite3_stmt *Database::getStatement(const string &sql)
+{
+	sqlite3_stmt *stmt = NULL;
+	map<string, sqlite3_stmt*>::iterator it = statements.find(sql);
+
+	// If the statement was already compiled, it is reused
+	if( it != statements.end() )
+	{
+		stmt = it->second;
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+
+		return stmt;
+	}
+
+	// Compiles the statement and saves it in the cache
+	rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+
+	if( rc != SQLITE_OK )
+		return NULL;
+
+	statements[sql] = stmt;
+
+	return stmt;
+}
+
+
+/**
+ Runs a prepared statement which returns no rows, and resets it so it can be used again.
+
+ @param [in] stmt Prepared statement with its values already bound.
+
+ @return True if the statement was run successfully, false otherwise.
+*/
+bool Database::runStatement(sqlite3_stmt *stmt)
+{
+	if( stmt == NULL )
+		return false;
+
+	rc = stepWithRetries(stmt);
+	sqlite3_reset(stmt);
+
+	if( rc != SQLITE_DONE )
+		return false;
 
 	return true;
 }
 
 
+/**
+ Runs a step of a prepared statement. If the database is still busy after the busy timeout, the statement
+ is reset and run again, up to the number of retries of the settings.
+
+ @param [in] stmt Prepared statement with its values already bound.
+
+ @return The result of the last step.
+*/
+int Database::stepWithRetries(sqlite3_stmt *stmt)
+{
+	int result = sqlite3_step(stmt);
+
+	for(int retry = 0; (result == SQLITE_BUSY || result == SQLITE_LOCKED) && retry < config.busyRetries; retry++)
+	{
+		stats.retries++;
+		sqlite3_reset(stmt);
+		usleep(DATABASE_RETRY_WAIT * (retry + 1) * 1000);
+		result = sqlite3_step(stmt);
+	}
+
+	if( result == SQLITE_BUSY || result == SQLITE_LOCKED )
+		stats.busyFailures++;
+
+	return result;
+}
+
+
+/**
+ Runs a SQL statement without results. If the database is still busy after the busy timeout, the statement
+ is run again, up to the number of retries of the settings.
+
+ @param [in] statement SQL statement.
+
+ @return True if the statement was run, false otherwise.
+*/
+bool Database::execWithRetries(const char *statement)
+{
+	rc = sqlite3_exec(db, statement, 0, 0, NULL);
+
+	for(int retry = 0; (rc == SQLITE_BUSY || rc == SQLITE_LOCKED) && retry < config.busyRetries; retry++)
+	{
+		stats.retries++;
+		usleep(DATABASE_RETRY_WAIT * (retry + 1) * 1000);
+		rc = sqlite3_exec(db, statement, 0, 0, NULL);
+	}
+
+	if( rc == SQLITE_BUSY || rc == SQLITE_LOCKED )
+		stats.busyFailures++;
+
+	if( rc != SQLITE_OK )
+		return false;
+
+	return true;
+}
+
+
+/**
+ Binds a string to a value of a prepared statement.
+
+ @param [in] stmt Prepared statement.
+ @param [in] index Position of the value in the statement, starting at 1.
+ @param [in] value String to be bound.
+
+ @return Nothing.
+*/
+void Database::bindText(sqlite3_stmt *stmt, int index, const string &value)
+{
+	sqlite3_bind_text(stmt, index, value.c_str(), value.length(), SQLITE_TRANSIENT);
+}
+
+
 /**
  Inserts a new user in the database.
 
@@ -182,6 +908,8 @@ bool Database::createTables()
 */
 DatabaseMessage Database::insertUser(string id, string name)
 {
+	sqlite3_stmt *stmt;
+
 	name = upperFirstLetter(name);
 
 	if( id.empty() || name.empty() )
@@ -191,15 +919,19 @@ DatabaseMessage Database::insertUser(string id, string name)
 	else
 	{
 		// SQL statement to insert a user into the 'users' table
-		string statement = "INSERT INTO USERS (ID, NAME) VALUES ('"+id+"', '"+name+"');";
+		stmt = getStatement("INSERT INTO USERS (ID, NAME) VALUES (?, ?);");
+
+		if( stmt == NULL )
+			return ERROR;
+
+		bindText(stmt, 1, id);
+		bindText(stmt, 2, name);
 
 		// Runs the previous SQL statement
-		rc = sqlite3_exec(db, statement.c_str(), 0, 0, NULL);
+		if( !runStatement(stmt) )
+			return ERROR;
 	}
 
-	if( rc != SQLITE_OK )
-		return ERROR;
-
 	return OK;
 }
 
@@ -215,6 +947,8 @@ DatabaseMessage Database::insertUser(string id, string name)
 */
 DatabaseMessage Database::insertSpecialist(string id, string name, string specialty)
 {
+	sqlite3_stmt *stmt;
+
 	// Uppercases the first letter of every word
 	name = upperFirstLetter(name);
 	specialty = upperFirstLetter(specialty);
@@ -231,47 +965,102 @@ DatabaseMessage Database::insertSpecialist(string id, string name, string specia
 			specialty = "No especificado";
 
 		// SQL statement to insert a specialist into the 'specialists' table
-		string statement = "INSERT INTO SPECIALISTS (ID, NAME, SPECIALTY) VALUES ('"+id+"', '"+name+"', '"+specialty+"');";
+		stmt = getStatement("INSERT INTO SPECIALISTS (ID, NAME, SPECIALTY) VALUES (?, ?, ?);");
+
+		if( stmt == NULL )
+			return ERROR;
+
+		bindText(stmt, 1, id);
+		bindText(stmt, 2, name);
+		bindText(stmt, 3, specialty);
 
 		// Runs the previous SQL statement
-		rc = sqlite3_exec(db, statement.c_str(), 0, 0, NULL);
+		if( !runStatement(stmt) )
+			return ERROR;
 	}
 
-	if( rc != SQLITE_OK )
-		return ERROR;
-
 	return OK;
 }
 
 
 /**
- Inserts a new game in the database.
+ Inserts a new game in the database when it starts, so its ID is reserved before its samples are saved. The
+ game has no end date and its score is zero until @ref updateGame is called, and it is not listed until then.
 
- @param userId [in] Identification number of the game user.
+ @param userId [in] Identification number of the game user. Empty if the game has no user.
  @param startDate [in] Start date of the game.
- @param endDate [in] End date of the game.
- @param successes [in] Score of successes.
- @param failures [in] Score of failures.
+ @param gameId [out] ID number of the new game, one more than the highest ID in the 'games' and 'game_data' tables.
 
  @return True if game was inserted successfully, false otherwise.
 */
-bool Database::insertGame(string userId, string startDate, string endDate, int successes, int failures)
+bool Database::insertGame(string userId, string startDate, int &gameId)
 {
-	int gameID;
+	sqlite3_stmt *stmt;
 
-	// Gets the game ID. The game ID is selected according to the number of position in the 'games' table.
-	getGameTableSize(gameID);
+	// The highest ID is read and the game inserted in the same transaction, so no other program can take the ID
+	if( !beginTransaction() )
+		return false;
+
+	// The older versions saved samples of games that are not in the 'games' table, so their IDs are not used either
+	stmt = getStatement("SELECT MAX(IFNULL((SELECT MAX(GAME_ID) FROM GAMES), -1), IFNULL((SELECT MAX(GAME_ID) FROM GAME_DATA), -1)) + 1;");
+
+	if( !readCount(stmt, gameId) )
+	{
+		rollbackTransaction();
+		return false;
+	}
 
 	// SQL statement to insert a game into the 'games' table
-	string statement = "INSERT INTO GAMES (GAME_ID, USER_ID, START_DATE, END_DATE, SUCCESSES, FAILURES) VALUES ('"+itos(gameID)+"', '"+userId+"', '"+startDate+"', '"+endDate+"', '"+itos(successes)+"', '"+itos(failures)+"');";
+	stmt = getStatement("INSERT INTO GAMES (GAME_ID, USER_ID, START_DATE, END_DATE, SUCCESSES, FAILURES) VALUES (?, ?, ?, NULL, 0, 0);");
+
+	if( stmt == NULL )
+	{
+		rollbackTransaction();
+		return false;
+	}
+
+	sqlite3_bind_int(stmt, 1, gameId);
+	if( userId.empty() )
+		sqlite3_bind_null(stmt, 2);
+	else
+		bindText(stmt, 2, userId);
+	bindText(stmt, 3, startDate);
 
 	// Runs the previous SQL statement
-	rc = sqlite3_exec(db, statement.c_str(), 0, 0, NULL);
+	if( !runStatement(stmt) || !commitTransaction() )
+	{
+		rollbackTransaction();
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ Saves the end date and the score of a game inserted with @ref insertGame.
+
+ @param gameId [in] ID number of the game.
+ @param endDate [in] End date of the game.
+ @param successes [in] Score of successes.
+ @param failures [in] Score of failures.
+
+ @return True if game was updated successfully, false otherwise.
+*/
+bool Database::updateGame(int gameId, string endDate, int successes, int failures)
+{
+	sqlite3_stmt *stmt = getStatement("UPDATE GAMES SET END_DATE = ?, SUCCESSES = ?, FAILURES = ? WHERE GAME_ID = ?;");
 
-	if( rc != SQLITE_OK )
+	if( stmt == NULL )
 		return false;
 
-	return true;
+	bindText(stmt, 1, endDate);
+	sqlite3_bind_int(stmt, 2, successes);
+	sqlite3_bind_int(stmt, 3, failures);
+	sqlite3_bind_int(stmt, 4, gameId);
+
+	// Runs the previous SQL statement
+	return( runStatement(stmt) );
 }
 
 
@@ -281,6 +1070,7 @@ bool Database::insertGame(string userId, string startDate, string endDate, int s
 
  @param [in] time A particular time of the game in seconds.
  @param [in] gameId ID number of the game.
+ @param [in] frame Number of the sample in the game.
  @param [in] fruitX X coordinate of the fruit.
  @param [in] fruitY Y coordinate of the fruit.
  @param [in] headX X coordinate of the joint of the head.
@@ -306,18 +1096,86 @@ bool Database::insertGame(string userId, string startDate, string endDate, int s
 
  @return True if the record was inserted successfully, false otherwise.
 */
-bool Database::insertGameData(int time, int gameId, float fruitX, float fruitY, float headX, float headY, float neckX, float neckY, float leftShoulderX, float leftShoulderY, float rightShoulderX, float rightShoulderY, float leftElbowX, float leftElbowY, float rightElbowX, float rightElbowY, float leftHandX, float leftHandY, float rightHandX, float rightHandY, float leftHipX, float leftHipY, float rightHipX, float rightHipY)
+bool Database::insertGameData(int time, int gameId, int frame, float fruitX, float fruitY, float headX, float headY, float neckX, float neckY, float leftShoulderX, float leftShoulderY, float rightShoulderX, float rightShoulderY, float leftElbowX, float leftElbowY, float rightElbowX, float rightElbowY, float leftHandX, float leftHandY, float rightHandX, float rightHandY, float leftHipX, float leftHipY, float rightHipX, float rightHipY)
 {
-	// SQL statement to insert a new record into 'game_data' table
-	string statement = "INSERT INTO GAME_DATA (TIME, GAME_ID, JOINT_HEAD_X, JOINT_HEAD_Y, JOINT_NECK_X, JOINT_NECK_Y, JOINT_LEFT_SHOULDER_X, JOINT_LEFT_SHOULDER_Y, JOINT_RIGHT_SHOULDER_X, JOINT_RIGHT_SHOULDER_Y, JOINT_LEFT_ELBOW_X, JOINT_LEFT_ELBOW_Y, JOINT_RIGHT_ELBOW_X, JOINT_RIGHT_ELBOW_Y, JOINT_LEFT_HAND_X, JOINT_LEFT_HAND_Y, JOINT_RIGHT_HAND_X, JOINT_RIGHT_HAND_Y, JOINT_LEFT_HIP_X, JOINT_LEFT_HIP_Y, JOINT_RIGHT_HIP_X, JOINT_RIGHT_HIP_Y, FRUIT_X, FRUIT_Y) VALUES ('"+itos(time)+"', '"+itos(gameId)+"', '"+ftos(headX)+"', '"+ftos(headY)+"', '"+ftos(neckX)+"', '"+ftos(neckY)+"', '"+ftos(leftShoulderX)+"', '"+ftos(leftShoulderY)+"', '"+ftos(rightShoulderX)+"', '"+ftos(rightShoulderY)+"', '"+ftos(leftElbowX)+"', '"+ftos(leftElbowY)+"', '"+ftos(rightElbowX)+"', '"+ftos(rightElbowY)+"', '"+ftos(leftHandX)+"', '"+ftos(leftHandY)+"', '"+ftos(rightHandX)+"', '"+ftos(rightHandY)+"', '"+ftos(leftHipX)+"', '"+ftos(leftHipY)+"', '"+ftos(rightHipX)+"', '"+ftos(rightHipY)+"', '"+ftos(fruitX)+"', '"+ftos(fruitY)+"');";
+	GameSample sample;
+
+	sample.time = time;
+	sample.gameId = gameId;
+	sample.frame = frame;
+	sample.fruitX = fruitX;
+	sample.fruitY = fruitY;
+	sample.headX = headX;
+	sample.headY = headY;
+	sample.neckX = neckX;
+	sample.neckY = neckY;
+	sample.leftShoulderX = leftShoulderX;
+	sample.leftShoulderY = leftShoulderY;
+	sample.rightShoulderX = rightShoulderX;
+	sample.rightShoulderY = rightShoulderY;
+	sample.leftElbowX = leftElbowX;
+	sample.leftElbowY = leftElbowY;
+	sample.rightElbowX = rightElbowX;
+	sample.rightElbowY = rightElbowY;
+	sample.leftHandX = leftHandX;
+	sample.leftHandY = leftHandY;
+	sample.rightHandX = rightHandX;
+	sample.rightHandY = rightHandY;
+	sample.leftHipX = leftHipX;
+	sample.leftHipY = leftHipY;
+	sample.rightHipX = rightHipX;
+	sample.rightHipY = rightHipY;
+
+	return( insertGameData(sample) );
+}
 
-	// Runs the previous SQL statement
-	rc = sqlite3_exec(db, statement.c_str(), 0, 0, NULL);
 
-	if( rc != SQLITE_OK )
+/**
+ Inserts a new record with the data of a game in a particular time, using a prepared statement.
+ It does not open a transaction, so many samples can be saved together between @ref beginTransaction
+ and @ref commitTransaction.
+
+ @param [in] sample Skeleton sample to be saved.
+
+ @return True if the record was inserted successfully, false otherwise.
+*/
+bool Database::insertGameData(const GameSample &sample)
+{
+	// SQL statement to insert a new record into 'game_data' table
+	sqlite3_stmt *stmt = getStatement("INSERT INTO GAME_DATA (GAME_ID, FRAME_NO, TIME, JOINT_HEAD_X, JOINT_HEAD_Y, JOINT_NECK_X, JOINT_NECK_Y, JOINT_LEFT_SHOULDER_X, JOINT_LEFT_SHOULDER_Y, JOINT_RIGHT_SHOULDER_X, JOINT_RIGHT_SHOULDER_Y, JOINT_LEFT_ELBOW_X, JOINT_LEFT_ELBOW_Y, JOINT_RIGHT_ELBOW_X, JOINT_RIGHT_ELBOW_Y, JOINT_LEFT_HAND_X, JOINT_LEFT_HAND_Y, JOINT_RIGHT_HAND_X, JOINT_RIGHT_HAND_Y, JOINT_LEFT_HIP_X, JOINT_LEFT_HIP_Y, JOINT_RIGHT_HIP_X, JOINT_RIGHT_HIP_Y, FRUIT_X, FRUIT_Y) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);");
+
+	if( stmt == NULL )
 		return false;
 
-	return true;
+	// Binds the values of the sample, in the same order as the columns of the statement
+	sqlite3_bind_int(stmt, 1, sample.gameId);
+	sqlite3_bind_int(stmt, 2, sample.frame);
+	sqlite3_bind_int(stmt, 3, sample.time);
+	sqlite3_bind_double(stmt, 4, sample.headX);
+	sqlite3_bind_double(stmt, 5, sample.headY);
+	sqlite3_bind_double(stmt, 6, sample.neckX);
+	sqlite3_bind_double(stmt, 7, sample.neckY);
+	sqlite3_bind_double(stmt, 8, sample.leftShoulderX);
+	sqlite3_bind_double(stmt, 9, sample.leftShoulderY);
+	sqlite3_bind_double(stmt, 10, sample.rightShoulderX);
+	sqlite3_bind_double(stmt, 11, sample.rightShoulderY);
+	sqlite3_bind_double(stmt, 12, sample.leftElbowX);
+	sqlite3_bind_double(stmt, 13, sample.leftElbowY);
+	sqlite3_bind_double(stmt, 14, sample.rightElbowX);
+	sqlite3_bind_double(stmt, 15, sample.rightElbowY);
+	sqlite3_bind_double(stmt, 16, sample.leftHandX);
+	sqlite3_bind_double(stmt, 17, sample.leftHandY);
+	sqlite3_bind_double(stmt, 18, sample.rightHandX);
+	sqlite3_bind_double(stmt, 19, sample.rightHandY);
+	sqlite3_bind_double(stmt, 20, sample.leftHipX);
+	sqlite3_bind_double(stmt, 21, sample.leftHipY);
+	sqlite3_bind_double(stmt, 22, sample.rightHipX);
+	sqlite3_bind_double(stmt, 23, sample.rightHipY);
+	sqlite3_bind_double(stmt, 24, sample.fruitX);
+	sqlite3_bind_double(stmt, 25, sample.fruitY);
+
+	// Runs the previous SQL statement
+	return( runStatement(stmt) );
 }
 
 
@@ -331,6 +1189,8 @@ bool Database::insertGameData(int time, int gameId, float fruitX, float fruitY,
 */
 DatabaseMessage Database::insertLinkUserSpecialist(string userId, string specialistId)
 {
+	sqlite3_stmt *stmt;
+
 	// If the data are empty
 	if( userId.empty() || specialistId.empty() )
 	{
@@ -339,15 +1199,19 @@ DatabaseMessage Database::insertLinkUserSpecialist(string userId, string special
 	else
 	{
 		// SQL statement to insert in the 'user_specialist' table a link between an user and a specialist
-		string statement = "INSERT INTO USER_SPECIALIST (USER_ID, SPECIALIST_ID) VALUES ('"+userId+"', '"+specialistId+"');";
+		stmt = getStatement("INSERT INTO USER_SPECIALIST (USER_ID, SPECIALIST_ID) VALUES (?, ?);");
+
+		if( stmt == NULL )
+			return ERROR;
+
+		bindText(stmt, 1, userId);
+		bindText(stmt, 2, specialistId);
 
 		// Runs the previous SQL statement
-		rc = sqlite3_exec(db, statement.c_str(), 0, 0, NULL);
+		if( !runStatement(stmt) )
+			return ERROR;
 	}
 
-	if( rc != SQLITE_OK )
-		return ERROR;
-
 	return OK;
 }
 
@@ -361,6 +1225,8 @@ DatabaseMessage Database::insertLinkUserSpecialist(string userId, string special
 */
 DatabaseMessage Database::deleteUser(string id)
 {
+	sqlite3_stmt *stmt;
+
 	// If the data is empty
 	if( id.empty() )
 	{
@@ -369,15 +1235,18 @@ DatabaseMessage Database::deleteUser(string id)
 	else
 	{
 		// SQL statement to delete a user given its id
-		string statement = "DELETE FROM USERS WHERE ID='" + id + "';";
+		stmt = getStatement("DELETE FROM USERS WHERE ID = ?;");
+
+		if( stmt == NULL )
+			return ERROR;
+
+		bindText(stmt, 1, id);
 
 		// Runs the previous SQL statement
-		rc = sqlite3_exec(db, statement.c_str(), NULL, NULL, NULL);
+		if( !runStatement(stmt) )
+			return ERROR;
 	}
 
-	if( rc != SQLITE_OK )
-		return ERROR;
-
 	return OK;
 }
 
@@ -391,6 +1260,8 @@ DatabaseMessage Database::deleteUser(string id)
 */
 DatabaseMessage Database::deleteSpecialist(string id)
 {
+	sqlite3_stmt *stmt;
+
 	// If the data is empty
 	if( id.empty() )
 	{
@@ -399,15 +1270,18 @@ DatabaseMessage Database::deleteSpecialist(string id)
 	else
 	{
 		// SQL statement to delete a specialist given its id
-		string statement = "DELETE FROM SPECIALISTS WHERE ID='" + id + "';";
+		stmt = getStatement("DELETE FROM SPECIALISTS WHERE ID = ?;");
+
+		if( stmt == NULL )
+			return ERROR;
+
+		bindText(stmt, 1, id);
 
 		// Runs the previous SQL statement
-		rc = sqlite3_exec(db, statement.c_str(), NULL, NULL, NULL);
+		if( !runStatement(stmt) )
+			return ERROR;
 	}
 
-	if( rc != SQLITE_OK )
-		return ERROR;
-
 	return OK;
 }
 
@@ -422,7 +1296,7 @@ DatabaseMessage Database::deleteSpecialist(string id)
 */
 DatabaseMessage Database::deleteLinkUserSpecialist(string userId, string specialistId)
 {
-	int num;
+	sqlite3_stmt *stmt;
 
 	// If the data are empty
 	if( userId.empty() || specialistId.empty() )
@@ -431,29 +1305,23 @@ DatabaseMessage Database::deleteLinkUserSpecialist(string userId, string special
 	}
 	else
 	{
-		// SQL statement to count how many rows can be deleted
-		string statement = "SELECT count(*) FROM USER_SPECIALIST WHERE USER_ID='"+userId+"' AND SPECIALIST_ID='"+specialistId+"';";
+		// SQL statement to delete from the 'user_specialist' table a link between an user and a specialist
+		stmt = getStatement("DELETE FROM USER_SPECIALIST WHERE USER_ID = ? AND SPECIALIST_ID = ?;");
 
-		// Runs the previous SQL statement
-		rc = sqlite3_exec(db, statement.c_str(), callbackCountOperation, &num, NULL);
+		if( stmt == NULL )
+			return ERROR;
 
-		// If there is a row to delete
-		if( num > 0 )
-		{
-			// SQL statement to delete from the 'user_specialist' table a link between an user and a specialist
-			string statement = "DELETE FROM USER_SPECIALIST WHERE USER_ID='"+userId+"' AND SPECIALIST_ID='"+specialistId+"';";
+		bindText(stmt, 1, userId);
+		bindText(stmt, 2, specialistId);
 
-			// Runs the previous SQL statement
-			rc = sqlite3_exec(db, statement.c_str(), 0, 0, NULL);
-		}
-		else
-		{
+		// Runs the previous SQL statement
+		if( !runStatement(stmt) )
 			return ERROR;
-		}
-	}
 
-	if( rc != SQLITE_OK )
-		return ERROR;
+		// If there was no row to delete, the user and the specialist were not linked
+		if( sqlite3_changes(db) == 0 )
+			return ERROR;
+	}
 
 	return OK;
 }
@@ -470,6 +1338,8 @@ DatabaseMessage Database::deleteLinkUserSpecialist(string userId, string special
 */
 DatabaseMessage Database::updateUser(string id, string column, string value)
 {
+	sqlite3_stmt *stmt;
+
 	// If the data is empty
 	if( id.empty() || column.empty() || value.empty() )
 	{
@@ -477,16 +1347,21 @@ DatabaseMessage Database::updateUser(string id, string column, string value)
 	}
 	else
 	{
-		// SQL statement to update a user given the user ID, the column to update and the new value
-		string statement = "UPDATE USERS SET " + column + " = '" + value + "' WHERE ID='" + id + "';";
+		// SQL statement to update a user given the user ID, the column to update and the new value.
+		// There is a statement in the cache for every column.
+		stmt = getStatement("UPDATE USERS SET " + column + " = ? WHERE ID = ?;");
+
+		if( stmt == NULL )
+			return ERROR;
+
+		bindText(stmt, 1, value);
+		bindText(stmt, 2, id);
 
 		// Runs the previous SQL statement
-		rc = sqlite3_exec(db, statement.c_str(), NULL, NULL, NULL);
+		if( !runStatement(stmt) )
+			return ERROR;
 	}
 
-	if( rc != SQLITE_OK )
-		return ERROR;
-
 	return OK;
 }
 
@@ -531,14 +1406,18 @@ DatabaseMessage Database::updateUserId(string id, string newId)
 */
 void Database::updateUserTotalScore(string id, int successes, int failures)
 {
-	User user;
+	// SQL statement to sum the score of the game to the score of the user
+	sqlite3_stmt *stmt = getStatement("UPDATE USERS SET TOTAL_SUCCESSES = TOTAL_SUCCESSES + ?, TOTAL_FAILURES = TOTAL_FAILURES + ? WHERE ID = ?;");
 
-	// Gets the data of the user
-	getUserById(id, user);
+	if( stmt == NULL )
+		return;
 
-	// Sums the successes and failures in the user data
-	updateUser(id, "TOTAL_SUCCESSES", itos(user.successes + successes));
-	updateUser(id, "TOTAL_FAILURES", itos(user.failures + failures));
+	sqlite3_bind_int(stmt, 1, successes);
+	sqlite3_bind_int(stmt, 2, failures);
+	bindText(stmt, 3, id);
+
+	// Runs the previous SQL statement
+	runStatement(stmt);
 }
 
 
@@ -553,6 +1432,8 @@ void Database::updateUserTotalScore(string id, int successes, int failures)
 */
 DatabaseMessage Database::updateSpecialist(string id, string column, string value)
 {
+	sqlite3_stmt *stmt;
+
 	// If the data are empty
 	if( id.empty() || column.empty() || value.empty() )	
 	{
@@ -560,16 +1441,21 @@ DatabaseMessage Database::updateSpecialist(string id, string column, string valu
 	}
 	else
 	{
-		// SQL statement to update a specialist given the specialist ID, the column to update and the new value
-		string statement = "UPDATE SPECIALISTS SET " + column + " = '" + value + "' WHERE ID='" + id + "';";
+		// SQL statement to update a specialist given the specialist ID, the column to update and the new value.
+		// There is a statement in the cache for every column.
+		stmt = getStatement("UPDATE SPECIALISTS SET " + column + " = ? WHERE ID = ?;");
+
+		if( stmt == NULL )
+			return ERROR;
+
+		bindText(stmt, 1, value);
+		bindText(stmt, 2, id);
 
 		// Runs the previous SQL statement
-		rc = sqlite3_exec(db, statement.c_str(), NULL, NULL, NULL);
+		if( !runStatement(stmt) )
+			return ERROR;
 	}
 
-	if( rc != SQLITE_OK )
-		return ERROR;
-
 	return OK;
 }
 
@@ -631,15 +1517,13 @@ DatabaseMessage Database::updateSpecialistSpecialty(string id, string newSpecial
 bool Database::getTableSize(string tableName, int &tableSize)
 {
 	// SQL statement to count how many rows there are in a table, given the name of the table
-	string statement = "SELECT COUNT(*) FROM "+tableName+";";
-
-	// Runs the previous SQL statement
-	rc = sqlite3_exec(db, statement.c_str(), callbackCountOperation, &tableSize, NULL);
+	sqlite3_stmt *stmt = getStatement("SELECT COUNT(*) FROM " + tableName + ";");
 
-	if( rc != SQLITE_OK )
+	if( stmt == NULL )
 		return false;
 
-	return true;
+	// Runs the previous SQL statement
+	return( readCount(stmt, tableSize) );
 }
 
 
@@ -686,119 +1570,173 @@ bool Database::getGameTableSize(int &tableSize)
 
 
 /**
- Callback function for @ref getGameTableSize.
+ Runs a prepared statement which counts rows and gets the result.
 
- @param param [out] Value returned with the size of the table
- @param colNum [in] Number of arguments, it means number of columns of the table.
- @param colValue [in] Values of the arguments, it means values of the columns of the table.
- @param colName [in] Names of the columns sent.
+ @param stmt [in] Prepared statement with its values already bound.
+ @param count [out] Value of the first column of the result.
 
- @return The function return the value 0 meaning that all was fine.
+ @return True if the count was obtained, false otherwise.
 */
-int Database::callbackCountOperation(void *param, int colNum, char **colValue, char **colName)
+bool Database::readCount(sqlite3_stmt *stmt, int &count)
 {
-	int *count = (int*)param;
-	*count = atoi(colValue[0]);
-    
-    return 0;
+	rc = sqlite3_step(stmt);
+
+	if( rc == SQLITE_ROW )
+		count = sqlite3_column_int(stmt, 0);
+
+	sqlite3_reset(stmt);
+
+	if( rc != SQLITE_ROW )
+		return false;
+
+	return true;
 }
 
 
 /**
- Returns a user from the 'users' table given its position in the table.
+ Runs a prepared statement which selects users and gets the first one.
 
- @param row [in] Position of the user in the table.
- @param user [out] Stores the user data.
+ @param stmt [in] Prepared statement with its values already bound.
+ @param user [out] Stores the user data, if any user was selected.
 
- @return True if the user was obtained, false otherwise.
+ @return True if the statement was run successfully, false otherwise.
 */
-bool Database::getNUser(int row, User &user)
+bool Database::readUser(sqlite3_stmt *stmt, User &user)
 {
-	// SQL statement to select a user from the "users" table given its position.
-	string statement = "SELECT * FROM USERS LIMIT " + itos(row) + ",1;";
+	rc = sqlite3_step(stmt);
 
-	// Runs the previous SQL statement
-	rc = sqlite3_exec(db, statement.c_str(), callbackNUser, &user, NULL);
+	if( rc == SQLITE_ROW )
+		readUserRow(stmt, user);
 
-	if( rc != SQLITE_OK )
+	sqlite3_reset(stmt);
+
+	if( rc != SQLITE_ROW && rc != SQLITE_DONE )
 		return false;
-	else
-		return true;
+
+	return true;
+}
+
+
+/**
+ Runs a prepared statement which selects specialists and gets the first one.
+
+ @param stmt [in] Prepared statement with its values already bound.
+ @param specialist [out] Stores the specialist data, if any specialist was selected.
+
+ @return True if the statement was run successfully, false otherwise.
+*/
+bool Database::readSpecialist(sqlite3_stmt *stmt, Specialist &specialist)
+{
+	rc = sqlite3_step(stmt);
+
+	if( rc == SQLITE_ROW )
+		readSpecialistRow(stmt, specialist);
+
+	sqlite3_reset(stmt);
+
+	if( rc != SQLITE_ROW && rc != SQLITE_DONE )
+		return false;
+
+	return true;
 }
 
 
 /**
- Callback function for @ref getNUser.
+ Copies the columns of the current row of a statement which selects users.
 
- @param param [out] Return an @ref User structure with the data of the user.
- @param colNum [in] Number of arguments, it means number of columns of the table.
- @param colValue [in] Values of the arguments, it means values of the columns of the table.
- @param colName [in] Names of the columns sent.
+ @param stmt [in] Statement placed in a row of the 'users' table.
+ @param user [out] Stores the user data.
 
- @return The function return the value 0 meaning that all was fine.
+ @return Nothing.
 */
-int Database::callbackNUser(void *param, int colNum, char **colValue, char **colName)
+void Database::readUserRow(sqlite3_stmt *stmt, User &user)
 {
-    User *user = (User*)param;
-    
-	user->id = colValue[0];
-	user->name = colValue[1];
-	user->successes = atoi( colValue[2] );
-	user->failures = atoi( colValue[3] );
-    
-    return 0;
+	user.id = (const char*)sqlite3_column_text(stmt, 0);
+	user.name = (const char*)sqlite3_column_text(stmt, 1);
+	user.successes = sqlite3_column_int(stmt, 2);
+	user.failures = sqlite3_column_int(stmt, 3);
 }
 
 
+/**
+ Copies the columns of the current row of a statement which selects specialists.
+
+ @param stmt [in] Statement placed in a row of the 'specialists' table.
+ @param specialist [out] Stores the specialist data.
+
+ @return Nothing.
+*/
+void Database::readSpecialistRow(sqlite3_stmt *stmt, Specialist &specialist)
+{
+	specialist.id = (const char*)sqlite3_column_text(stmt, 0);
+	specialist.name = (const char*)sqlite3_column_text(stmt, 1);
+	specialist.specialty = (const char*)sqlite3_column_text(stmt, 2);
+}
+
 
 /**
- Returns a specialist from the 'specialists' table given its position in the table.
+ Copies the columns of the current row of a statement which selects games.
 
- @param row [in] Position of the specialist in the table.
- @param user [out] Stores the specialist data.
+ @param stmt [in] Statement placed in a row of the 'games' table.
+ @param game [out] Stores the game data.
 
- @return True if the specialist was obtained, false otherwise.
+ @return Nothing.
 */
-bool Database::getNSpecialist(int row, Specialist &specialist)
+void Database::readGameRow(sqlite3_stmt *stmt, Game &game)
 {
-	// SQL statement to select a specialist from the "specialist" table given its position.
-	string statement = "SELECT * FROM SPECIALISTS LIMIT " + itos(row) + ",1;";
+	game.gameId = (const char*)sqlite3_column_text(stmt, 0);
+	game.date = (const char*)sqlite3_column_text(stmt, 1);
+}
 
-	// Runs the previous SQL statement
-	rc = sqlite3_exec(db, statement.c_str(), callbackNSpecialist, &specialist, NULL);
 
-	if( rc != SQLITE_OK )
+/**
+ Returns a user from the 'users' table given its position in the table, in the order of the IDs.
+
+ @param row [in] Position of the user in the table.
+ @param user [out] Stores the user data.
+
+ @return True if the user was obtained, false otherwise.
+*/
+bool Database::getNUser(int row, User &user)
+{
+	// SQL statement to select a user from the "users" table given its position.
+	sqlite3_stmt *stmt = getStatement("SELECT ID, NAME, TOTAL_SUCCESSES, TOTAL_FAILURES FROM USERS ORDER BY ID LIMIT ?,1;");
+
+	if( stmt == NULL )
 		return false;
-	else
-		return true;
+
+	sqlite3_bind_int(stmt, 1, row);
+
+	// Runs the previous SQL statement
+	return( readUser(stmt, user) );
 }
 
 
 /**
- Callback function for @ref getNSpecialist.
+ Returns a specialist from the 'specialists' table given its position in the table, in the order of the IDs.
 
- @param param [out] Return an @ref Specialist structure with the data of the specialist.
- @param colNum [in] Number of arguments, it means number of columns of the table.
- @param colValue [in] Values of the arguments, it means values of the columns of the table.
- @param colName [in] Names of the columns sent.
+ @param row [in] Position of the specialist in the table.
+ @param user [out] Stores the specialist data.
 
- @return The function return the value 0 meaning that all was fine.
+ @return True if the specialist was obtained, false otherwise.
 */
-int Database::callbackNSpecialist(void *param, int colNum, char **colValue, char **colName)
+bool Database::getNSpecialist(int row, Specialist &specialist)
 {
-    Specialist *specialist = (Specialist*)param;
-    
-	specialist->id = colValue[0];
-	specialist->name = colValue[1];
-	specialist->specialty = colValue[2];
+	// SQL statement to select a specialist from the "specialist" table given its position.
+	sqlite3_stmt *stmt = getStatement("SELECT ID, NAME, SPECIALTY FROM SPECIALISTS ORDER BY ID LIMIT ?,1;");
+
+	if( stmt == NULL )
+		return false;
+
+	sqlite3_bind_int(stmt, 1, row);
 
-    
-    return 0;
+	// Runs the previous SQL statement
+	return( readSpecialist(stmt, specialist) );
 }
 
 
 /**
- Gets the 'n' game of a user. It is used to list the games of a specific user.
+ Gets the 'n' game of a user, in the order of the game IDs. It is used to list the games of a specific user.
 
  @param userId [in] ID of the user.
  @param row [in] Number of game among all the games of a user.
@@ -809,37 +1747,26 @@ int Database::callbackNSpecialist(void *param, int colNum, char **colValue, char
 bool Database::getNGamesbyUser(string userId, int row, Game &game)
 {
 	// SQL statement to select a specific game (given its position) of a specific user
-	string statement = "SELECT GAME_ID, START_DATE FROM GAMES WHERE USER_ID='"+userId+"' LIMIT " + itos(row) + ",1;";
-
-	// Runs the previous SQL statement
-	rc = sqlite3_exec(db, statement.c_str(), callbackNGamesByUser, &game, NULL);
+	sqlite3_stmt *stmt = getStatement("SELECT GAME_ID, START_DATE FROM GAMES WHERE USER_ID = ? AND END_DATE IS NOT NULL ORDER BY GAME_ID LIMIT ?,1;");
 
-	if( rc != SQLITE_OK )
+	if( stmt == NULL )
 		return false;
-	else
-		return true;
-}
 
+	bindText(stmt, 1, userId);
+	sqlite3_bind_int(stmt, 2, row);
 
-/**
- Callback function for @ref getNGamesByUser.
+	// Runs the previous SQL statement
+	rc = sqlite3_step(stmt);
 
- @param param [out] Return an @ref Game structure with the data of a game.
- @param colNum [in] Number of arguments, it means number of columns of the table.
- @param colValue [in] Values of the arguments, it means values of the columns of the table.
- @param colName [in] Names of the columns sent.
+	if( rc == SQLITE_ROW )
+		readGameRow(stmt, game);
 
- @return The function return the value 0 meaning that all was fine.
-*/
-int Database::callbackNGamesByUser(void *param, int colNum, char **colValue, char **colName)
-{
-    Game *game = (Game*)param;
-    
-	game->gameId = colValue[0];
-	game->date = colValue[1];
+	sqlite3_reset(stmt);
+
+	if( rc != SQLITE_ROW && rc != SQLITE_DONE )
+		return false;
 
-    
-    return 0;
+	return true;
 }
 
 
@@ -854,35 +1781,158 @@ int Database::callbackNGamesByUser(void *param, int colNum, char **colValue, cha
 bool Database::getUserById(string id, User &user)
 {
 	// SQL statement to select a user from the "users" table given its id.
-	string statement = "SELECT * FROM USERS WHERE ID = '" + id + "';";
+	sqlite3_stmt *stmt = getStatement("SELECT ID, NAME, TOTAL_SUCCESSES, TOTAL_FAILURES FROM USERS WHERE ID = ?;");
+
+	if( stmt == NULL )
+		return false;
+
+	bindText(stmt, 1, id);
 
 	// Runs the previous SQL statement
-	rc = sqlite3_exec(db, statement.c_str(), callbackNUser, &user, NULL);
+	return( readUser(stmt, user) );
+}
 
-	if( rc != SQLITE_OK )
+
+/**
+ Returns a specialist from the 'specialists' table given its id.
+
+ @param id [in] Identification number of the specialist.
+ @param specialist [out] Stores the specialist data.
+
+ @return True if the specialist was obtained, false otherwise.
+*/
+bool Database::getSpecialistById(string id, Specialist &specialist)
+{
+	// SQL statement to select a specialist from the "specialists" table given its id.
+	sqlite3_stmt *stmt = getStatement("SELECT ID, NAME, SPECIALTY FROM SPECIALISTS WHERE ID = ?;");
+
+	if( stmt == NULL )
 		return false;
-	else
-		return true;
+
+	bindText(stmt, 1, id);
+
+	// Runs the previous SQL statement
+	return( readSpecialist(stmt, specialist) );
 }
 
 
 /**
- Gets how many games of a specific user have been saved in the database. It is used to list the games of a specific user.
+ Lists all the users of the 'users' table with a single query. The users are listed in the same order
+ as the positions used by @ref getNUser. The visitor must not use this database object.
 
- @param userId [in] Identification number of the user
- @param gamesNum [out] Variable where is saved and returned the number of games.
+ @param visitor [in] Function called for every user. If it returns false, the listing is stopped.
+ @param param [in] Pointer sent to the visitor function.
 
- @return True if the number of games was obtained, false otherwise.
+ @return True if the users were listed, false otherwise.
 */
-bool Database::getUserGamesNum(string userId, int &gamesNum)
+bool Database::forEachUser(UserVisitor visitor, void *param)
 {
-	// SQL statement to count how many games there are saved from a specific user
-	string statement = "SELECT COUNT(*) FROM GAMES WHERE USER_ID='"+userId+"';";
+	User user;
 
-	// Runs the previous SQL statement
-	rc = sqlite3_exec(db, statement.c_str(), callbackUserGamesNum, &gamesNum, NULL);
+	// SQL statement to select all the users of the "users" table
+	sqlite3_stmt *stmt = getStatement("SELECT ID, NAME, TOTAL_SUCCESSES, TOTAL_FAILURES FROM USERS ORDER BY ID;");
 
-	if( rc != SQLITE_OK )
+	if( stmt == NULL )
+		return false;
+
+	// Reads every row of the result
+	while( (rc = sqlite3_step(stmt)) == SQLITE_ROW )
+	{
+		readUserRow(stmt, user);
+
+		if( !visitor(user, param) )
+		{
+			rc = SQLITE_DONE;
+			break;
+		}
+	}
+
+	sqlite3_reset(stmt);
+
+	if( rc != SQLITE_DONE )
+		return false;
+
+	return true;
+}
+
+
+/**
+ Lists all the specialists of the 'specialists' table with a single query. The specialists are listed in
+ the same order as the positions used by @ref getNSpecialist. The visitor must not use this database object.
+
+ @param visitor [in] Function called for every specialist. If it returns false, the listing is stopped.
+ @param param [in] Pointer sent to the visitor function.
+
+ @return True if the specialists were listed, false otherwise.
+*/
+bool Database::forEachSpecialist(SpecialistVisitor visitor, void *param)
+{
+	Specialist specialist;
+
+	// SQL statement to select all the specialists of the "specialists" table
+	sqlite3_stmt *stmt = getStatement("SELECT ID, NAME, SPECIALTY FROM SPECIALISTS ORDER BY ID;");
+
+	if( stmt == NULL )
+		return false;
+
+	// Reads every row of the result
+	while( (rc = sqlite3_step(stmt)) == SQLITE_ROW )
+	{
+		readSpecialistRow(stmt, specialist);
+
+		if( !visitor(specialist, param) )
+		{
+			rc = SQLITE_DONE;
+			break;
+		}
+	}
+
+	sqlite3_reset(stmt);
+
+	if( rc != SQLITE_DONE )
+		return false;
+
+	return true;
+}
+
+
+/**
+ Lists all the games of a user with a single query. The games are listed in the same order as the
+ positions used by @ref getNGamesbyUser. The visitor must not use this database object.
+
+ @param userId [in] Identification number of the user.
+ @param visitor [in] Function called for every game. If it returns false, the listing is stopped.
+ @param param [in] Pointer sent to the visitor function.
+
+ @return True if the games were listed, false otherwise.
+*/
+bool Database::forEachGameByUser(string userId, GameVisitor visitor, void *param)
+{
+	Game game;
+
+	// SQL statement to select all the games of a specific user
+	sqlite3_stmt *stmt = getStatement("SELECT GAME_ID, START_DATE FROM GAMES WHERE USER_ID = ? AND END_DATE IS NOT NULL ORDER BY GAME_ID;");
+
+	if( stmt == NULL )
+		return false;
+
+	bindText(stmt, 1, userId);
+
+	// Reads every row of the result
+	while( (rc = sqlite3_step(stmt)) == SQLITE_ROW )
+	{
+		readGameRow(stmt, game);
+
+		if( !visitor(game, param) )
+		{
+			rc = SQLITE_DONE;
+			break;
+		}
+	}
+
+	sqlite3_reset(stmt);
+
+	if( rc != SQLITE_DONE )
 		return false;
 
 	return true;
@@ -890,21 +1940,25 @@ bool Database::getUserGamesNum(string userId, int &gamesNum)
 
 
 /**
- Callback function for @ref getUserGamesNum.
+ Gets how many games of a specific user have been saved in the database. It is used to list the games of a specific user.
 
- @param param [out] Return the value of the first column, it means the result of count rows.
- @param colNum [in] Number of arguments, it means number of columns of the table.
- @param colValue [in] Values of the arguments, it means values of the columns of the table.
- @param colName [in] Names of the columns sent.
+ @param userId [in] Identification number of the user
+ @param gamesNum [out] Variable where is saved and returned the number of games.
 
- @return The function return the value 0 meaning that all was fine.
+ @return True if the number of games was obtained, false otherwise.
 */
-int Database::callbackUserGamesNum(void *param, int colNum, char **colValue, char **colName)
+bool Database::getUserGamesNum(string userId, int &gamesNum)
 {
-	int *gamesNum = (int*)param;
-	*gamesNum = atoi(colValue[0]);
-    
-    return 0;
+	// SQL statement to count how many games there are saved from a specific user
+	sqlite3_stmt *stmt = getStatement("SELECT COUNT(*) FROM GAMES WHERE USER_ID = ? AND END_DATE IS NOT NULL;");
+
+	if( stmt == NULL )
+		return false;
+
+	bindText(stmt, 1, userId);
+
+	// Runs the previous SQL statement
+	return( readCount(stmt, gamesNum) );
 }
 
 
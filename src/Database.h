@@ -10,6 +10,18 @@
 
 #include <sqlite3.h> // Include for SQLite
 #include <sstream> // Include for string type
+#include <map> // Include for the cache of prepared statements
+#include <set> // Include for the cache of current databases
+#include <pthread.h> // Include for the mutex of the cache of current databases
+
+//Macros
+#define DATABASE_FILE	"database.db"
+#define DATABASE_SYNCHRONOUS	"NORMAL" // Synchronous level. With the write-ahead log, NORMAL only loses the last transactions if the system crashes
+#define DATABASE_CHECKPOINT_PAGES	1000 // Pages written in the write-ahead log before they are copied to the database file
+#define DATABASE_BUSY_TIMEOUT	2000 // Time that a statement waits for the lock of another connection, in milliseconds
+#define DATABASE_BUSY_RETRIES	3 // Times that a statement is run again if the database is still busy after the wait
+#define DATABASE_RETRY_WAIT	10 // Time between two retries of a statement, in milliseconds. It grows with every retry
+#define DATABASE_SCHEMA_VERSION	3 // Version of the tables, saved in the 'user_version' of the database file. It is the version of the last migration
 
 
 using namespace std;
@@ -51,20 +63,97 @@ struct Game
 	string date;
 };
 
+/** Holds a sample of the skeleton of a user in a particular time of a game. */
+struct GameSample
+{
+	/* A particular time of the game in seconds. */
+	int time;
+	/* ID number of the game. */
+	int gameId;
+	/* Number of the sample in the game, from 0. With the ID of the game, it identifies the sample. */
+	int frame;
+	/* Coordinates of the fruit. */
+	float fruitX, fruitY;
+	/* Coordinates of the joint of the head. */
+	float headX, headY;
+	/* Coordinates of the joint of the neck. */
+	float neckX, neckY;
+	/* Coordinates of the joint of the left shoulder. */
+	float leftShoulderX, leftShoulderY;
+	/* Coordinates of the joint of the right shoulder. */
+	float rightShoulderX, rightShoulderY;
+	/* Coordinates of the joint of the left elbow. */
+	float leftElbowX, leftElbowY;
+	/* Coordinates of the joint of the right elbow. */
+	float rightElbowX, rightElbowY;
+	/* Coordinates of the joint of the left hand. */
+	float leftHandX, leftHandY;
+	/* Coordinates of the joint of the right hand. */
+	float rightHandX, rightHandY;
+	/* Coordinates of the joint of the left hip. */
+	float leftHipX, leftHipY;
+	/* Coordinates of the joint of the right hip. */
+	float rightHipX, rightHipY;
+};
+
+/** Settings of the connections to the database. */
+struct DatabaseConfig
+{
+	/* Synchronous level of the file: 'OFF', 'NORMAL' or 'FULL'. */
+	string synchronous;
+	/* Pages of the write-ahead log that start a checkpoint. 0 disables the automatic checkpoints. */
+	int checkpointPages;
+	/* Time that a statement waits for the lock of another connection, in milliseconds. */
+	int busyTimeout;
+	/* Times that a statement is run again if the database is still busy after the wait. */
+	int busyRetries;
+};
+
+/** Counters of the waits of a connection for the locks of other connections. */
+struct DatabaseStats
+{
+	/* Number of times the database was locked by another connection and the statement waited. */
+	unsigned long busyWaits;
+	/* Total time waited for the locks, in milliseconds. */
+	unsigned long busyWaitMs;
+	/* Number of times a statement was run again because the database was still busy. */
+	unsigned long retries;
+	/* Number of statements that failed because the database was still busy after all the retries. */
+	unsigned long busyFailures;
+};
+
+/** Functions called for every row of a listing. If they return false, the listing is stopped. */
+typedef bool (*UserVisitor)(const User &user, void *param);
+typedef bool (*SpecialistVisitor)(const Specialist &specialist, void *param);
+typedef bool (*GameVisitor)(const Game &game, void *param);
+
 
 class Database
 {
 	public:
-		Database();
+		Database(string path = DATABASE_FILE);
 		~Database();
 		bool openDatabase();
 		void closeDatabase();
 		bool createTables();
+		bool enableWriteAheadLog();
+		bool setBusyTimeout(int milliseconds);
+
+		static DatabaseConfig defaultConfig();
+		static bool parseConfig(string text, DatabaseConfig &config);
+		static void setConfig(const DatabaseConfig &config);
+		DatabaseStats getStats();
+
+		bool beginTransaction();
+		bool commitTransaction();
+		bool rollbackTransaction();
 
 		DatabaseMessage insertUser(string id, string name);
 		DatabaseMessage insertSpecialist(string id, string name, string specialty);
-		bool insertGame(string userId, string startDate, string endDate, int successes, int failures);
-		bool insertGameData(int time, int gameId, float fruitX, float fruitY, float headX, float headY, float neckX, float neckY, float leftShoulderX, float leftShoulderY, float rightShoulderX, float rightShoulderY, float leftElbowX, float leftElbowY, float rightElbowX, float rightElbowY, float leftHandX, float leftHandY, float rightHandX, float rightHandY, float leftHipX, float leftHipY, float rightHipX, float rightHipY);
+		bool insertGame(string userId, string startDate, int &gameId);
+		bool updateGame(int gameId, string endDate, int successes, int failures);
+		bool insertGameData(int time, int gameId, int frame, float fruitX, float fruitY, float headX, float headY, float neckX, float neckY, float leftShoulderX, float leftShoulderY, float rightShoulderX, float rightShoulderY, float leftElbowX, float leftElbowY, float rightElbowX, float rightElbowY, float leftHandX, float leftHandY, float rightHandX, float rightHandY, float leftHipX, float leftHipY, float rightHipX, float rightHipY);
+		bool insertGameData(const GameSample &sample);
 		DatabaseMessage insertLinkUserSpecialist(string userId, string specialistId);
 
 		DatabaseMessage deleteUser(string id);
@@ -84,26 +173,72 @@ class Database
 		bool getUsersTableSize(int &tableSize);
 		bool getSpecialistsTableSize(int &tableSize);
 		bool getGameTableSize(int &tableSize);
-		static int callbackCountOperation(void *param, int colNum, char **colValue, char **colName);
 
 		bool getNUser(int row, User &user);
-		static int callbackNUser(void *param, int colNum, char **colValue, char **colName);
 		bool getNSpecialist(int row, Specialist &specialist);
-		static int callbackNSpecialist(void *param, int colNum, char **colValue, char **colName);
 		bool getUserById(string id, User &user);
+		bool getSpecialistById(string id, Specialist &specialist);
+
+		bool forEachUser(UserVisitor visitor, void *param);
+		bool forEachSpecialist(SpecialistVisitor visitor, void *param);
+		bool forEachGameByUser(string userId, GameVisitor visitor, void *param);
 
 		bool getNGamesbyUser(string userId, int row, Game &game);
-		static int callbackNGamesByUser(void *param, int colNum, char **colValue, char **colName);
 		bool getUserGamesNum(string userId, int &gamesNum);
-		static int callbackUserGamesNum(void *param, int colNum, char **colValue, char **colName);
 
 		static string itos(int num);
 		static string ftos(float num);
 		string upperFirstLetter(string text);
 
 	private:
+		/** Function of a migration, run inside its transaction */
+		typedef bool (Database::*MigrationFunction)();
+
+		/** Step that brings the tables from the version before it to its version */
+		struct Migration
+		{
+			/* Version of the tables after the migration */
+			int version;
+			/* Description of the changes, shown if the migration fails */
+			const char *description;
+			/* Function that changes the tables */
+			MigrationFunction apply;
+		};
+
+		sqlite3_stmt *getStatement(const string &sql);
+		bool runStatement(sqlite3_stmt *stmt);
+		int stepWithRetries(sqlite3_stmt *stmt);
+		bool execWithRetries(const char *statement);
+		static int busyHandler(void *data, int count);
+		void bindText(sqlite3_stmt *stmt, int index, const string &value);
+		bool readCount(sqlite3_stmt *stmt, int &count);
+		bool readUser(sqlite3_stmt *stmt, User &user);
+		bool readSpecialist(sqlite3_stmt *stmt, Specialist &specialist);
+		static void readUserRow(sqlite3_stmt *stmt, User &user);
+		static void readSpecialistRow(sqlite3_stmt *stmt, Specialist &specialist);
+		static void readGameRow(sqlite3_stmt *stmt, Game &game);
+		bool runMigrations();
+		bool applyMigration(const Migration &migration);
+		bool getSchemaVersion(int &version);
+		bool setSchemaVersion(int version);
+		bool createBaseTables();
+		bool keyGameDataByFrame();
+		bool allowUnfinishedGames();
+		bool upgradeGameData();
+		bool createIndexes();
+
+		static DatabaseConfig config; /** Settings of the connections opened from now on */
+		static const Migration migrations[]; /** Migrations of the tables, in order of version */
+		static set<string> currentSchemas; /** Full paths of the database files already in the last version */
+		static pthread_mutex_t schemasMutex; /** Mutex of 'currentSchemas' */
+
+		string path; /** Path of the database file */
 		sqlite3 *db; /** Variable for the SQLite database */
 		int rc;	/** Return code for sqlite functions */
+		map<string, sqlite3_stmt*> statements; /** Cache of prepared statements, one for every SQL text */
+		DatabaseStats stats; /** Waits of this connection for the locks of other connections */
+		int busyTimeout; /** Time that a statement waits for a lock, in milliseconds */
+		int busyWaitedMs; /** Time waited for the current lock, in milliseconds */
 };
 
 
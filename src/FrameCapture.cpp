@@ -0,0 +1,355 @@
+/**
+ @file   FrameCapture.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Class to read the frames of a frame source from a dedicated thread.
+*/
+
+#include "FrameCapture.h"
+
+#include <unistd.h> // Include for usleep() function
+#include <sys/time.h> // Include for gettimeofday() function
+
+using namespace std;
+using namespace cv;
+
+
+/**
+ Constructor. The thread is not created until @ref start is called.
+
+ @param [in] source Source the frames are read from. It must be ready to give frames.
+*/
+FrameCapture::FrameCapture(FrameSource *source)
+{
+	this->source = source;
+	chromaEnabled = false;
+	singlePass = true;
+	profiler = NULL;
+	stageSource = -1;
+	stageCompose = -1;
+
+	running = false;
+	started = false;
+
+	published = 0;
+	consumed = 0;
+	holding = false;
+
+	captured = 0;
+	overruns = 0;
+	failed = 0;
+	dropped = 0;
+}
+
+
+/**
+ Destructor. Stops the thread.
+*/
+FrameCapture::~FrameCapture()
+{
+	stop();
+}
+
+
+/**
+ Sets the image inserted in the background of the frames. It must be called before @ref start.
+
+ @param [in] frameImageLoaded Image to show in the background.
+
+ @return Nothing.
+*/
+void FrameCapture::setBackground(const cv::Mat &frameImageLoaded)
+{
+	chroma.setBackground(frameImageLoaded);
+	chromaEnabled = !frameImageLoaded.empty();
+}
+
+
+/**
+ Chooses how the RGB image is made. In a single pass, each pixel of the source is converted to BGR, replaced
+ by the background if there is no user, and written in its mirrored position. Otherwise, the image is
+ converted and keyed in separate steps, and it is not mirrored. It must be called before @ref start.
+
+ @param [in] enabled True to make the image in a single pass, false to use the separate steps.
+
+ @return Nothing.
+*/
+void FrameCapture::setSinglePass(bool enabled)
+{
+	singlePass = enabled;
+}
+
+
+/**
+ Sets the profiler where the times of the capture thread are recorded. It adds the stages 'source'
+ (tracker and camera) and 'compose' (conversion, background and mirror). It must be called before @ref start.
+
+ @param [in] profiler Profiler to be used.
+
+ @return Nothing.
+*/
+void FrameCapture::setProfiler(Profiler *profiler)
+{
+	this->profiler = profiler;
+	stageSource = profiler->addStage("source");
+	stageCompose = profiler->addStage("compose");
+}
+
+
+/**
+ Creates the thread that reads the frames.
+
+ @return True if the thread was created, false otherwise.
+*/
+bool FrameCapture::start()
+{
+	if(started)
+		return true;
+
+	running = true;
+
+	if( pthread_create(&thread, NULL, captureThread, this) != 0 )
+	{
+		running = false;
+		return false;
+	}
+
+	started = true;
+
+	return true;
+}
+
+
+/**
+ Waits until the thread finishes.
+
+ @return Nothing.
+*/
+void FrameCapture::stop()
+{
+	if(!started)
+		return;
+
+	running = false;
+	pthread_join(thread, NULL);
+
+	started = false;
+}
+
+
+/**
+ Takes the newest frame published by the capture thread. The frames published before it are skipped.
+ The frame belongs to the caller until @ref releaseFrame or the next call to this function.
+
+ @param [in] timeoutMs Maximum time to wait for a new frame, in milliseconds.
+
+ @return The newest frame, or NULL if no new frame was published before the timeout.
+*/
+CapturedFrame *FrameCapture::acquireLatestFrame(int timeoutMs)
+{
+	timeval now, deadline;
+	unsigned long newest;
+
+	// The previous frame is given back to the capture thread
+	releaseFrame();
+
+	gettimeofday(&deadline, NULL);
+	deadline.tv_sec += timeoutMs / 1000;
+	deadline.tv_usec += (timeoutMs % 1000) * 1000;
+	if(deadline.tv_usec >= 1000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_usec -= 1000000;
+	}
+
+	while(true)
+	{
+		newest = published;
+		// The frame must be read after the counter that publishes it
+		__sync_synchronize();
+
+		// If there is a frame that the consumer has not taken yet
+		if(newest > consumed)
+		{
+			// The frames older than the newest one are skipped
+			dropped += (newest - 1) - consumed;
+			consumed = newest - 1;
+			__sync_synchronize();
+
+			holding = true;
+
+			return &slots[(newest - 1) % CAPTURE_SLOTS];
+		}
+
+		gettimeofday(&now, NULL);
+		if( now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_usec >= deadline.tv_usec) )
+			return NULL;
+
+		usleep(1000);
+	}
+}
+
+
+/**
+ Gives the frame taken with @ref acquireLatestFrame back to the capture thread, so its slot can be reused.
+
+ @return Nothing.
+*/
+void FrameCapture::releaseFrame()
+{
+	if(!holding)
+		return;
+
+	// The frame must be read completely before its slot is given back
+	__sync_synchronize();
+	consumed = consumed + 1;
+
+	holding = false;
+}
+
+
+/**
+ Gets a copy of the counters of the capture.
+
+ @return A @ref CaptureStats structure with the counters.
+*/
+CaptureStats FrameCapture::getStats()
+{
+	CaptureStats stats;
+
+	stats.captured = captured;
+	stats.published = published;
+	stats.dropped = dropped;
+	stats.overruns = overruns;
+	stats.failed = failed;
+
+	return stats;
+}
+
+
+/**
+ Entry point of the thread.
+
+ @param [in] param Pointer to the @ref FrameCapture object.
+
+ @return Nothing.
+*/
+void *FrameCapture::captureThread(void *param)
+{
+	FrameCapture *capture = (FrameCapture*)param;
+
+	capture->captureFrames();
+
+	return NULL;
+}
+
+
+/**
+ Loop of the thread. Reads the next frame of the source, inserts the background and publishes the frame
+ in the next free slot of the ring. If the ring is full, the frame is discarded.
+
+ @return Nothing.
+*/
+void FrameCapture::captureFrames()
+{
+	unsigned long next;
+	bool isRgb;
+
+	while(running)
+	{
+		// If the consumer has not released enough slots, the frame is read anyway and discarded
+		next = published;
+		if(next - consumed >= CAPTURE_SLOTS)
+		{
+			if( source->readRawSnapshot(discarded, sensorColor, isRgb) )
+			{
+				captured++;
+				overruns++;
+			}
+			else
+			{
+				failed++;
+				usleep(1000);
+			}
+
+			continue;
+		}
+
+		CapturedFrame &slot = slots[next % CAPTURE_SLOTS];
+
+		// Reads the RGB image, the user map and the joints. The buffers of the slot are only allocated the first time
+		if( !readFrame(slot) )
+		{
+			failed++;
+			usleep(1000);
+			continue;
+		}
+
+		captured++;
+
+		slot.sequence = next;
+
+		// The slot must be written completely before it is published
+		__sync_synchronize();
+		published = next + 1;
+	}
+}
+
+
+/**
+ Reads the next frame of the source in a slot, and makes its RGB image with the background inserted.
+
+ @param [out] slot Slot of the ring where the frame is read.
+
+ @return True if the frame was read, false otherwise.
+*/
+bool FrameCapture::readFrame(CapturedFrame &slot)
+{
+	bool isRgb;
+
+	ProfileScope sourceScope(profiler, stageSource);
+
+	if(!singlePass)
+	{
+		if( !source->readSnapshot(slot) )
+			return false;
+
+		sourceScope.stop();
+		ProfileScope composeScope(profiler, stageCompose);
+
+		// Inserts a background image, as if it were a chroma
+		if(chromaEnabled)
+			chroma.apply(slot.frameColor, (const unsigned short*)slot.userMap.data, slot.userMap.cols, slot.userMap.rows, (int)slot.userMap.step);
+
+		slot.mirrored = false;
+
+		return true;
+	}
+
+	// Reads the image of the source without converting it
+	if( !source->readRawSnapshot(slot, sensorColor, isRgb) )
+		return false;
+
+	sourceScope.stop();
+	ProfileScope composeScope(profiler, stageCompose);
+
+	// Converts, keys and mirrors the image in a single pass
+	if( chroma.applyMirrored(sensorColor, isRgb, (const unsigned short*)slot.userMap.data, slot.userMap.cols, slot.userMap.rows, (int)slot.userMap.step, slot.frameColor) )
+	{
+		slot.mirrored = true;
+		return true;
+	}
+
+	// If the user map does not cover the image, the separate steps are used
+	if(isRgb)
+		cvtColor(sensorColor, slot.frameColor, CV_RGB2BGR);
+	else
+		sensorColor.copyTo(slot.frameColor);
+
+	if(chromaEnabled)
+		chroma.apply(slot.frameColor, (const unsigned short*)slot.userMap.data, slot.userMap.cols, slot.userMap.rows, (int)slot.userMap.step);
+
+	slot.mirrored = false;
+
+	return true;
+}
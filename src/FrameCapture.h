@@ -0,0 +1,94 @@
+/**
+ @file   FrameCapture.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Class to read the frames of a frame source from a dedicated thread.
+*/
+
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <pthread.h> // Include for POSIX threads
+
+#include "FrameSource.h"
+#include "ChromaKey.h"
+#include "Profiler.h"
+
+//Macros
+#define CAPTURE_SLOTS		4
+#define CAPTURE_TIMEOUT_MS	100
+
+
+using namespace std;
+
+/** Frame published by the capture thread, with the background already inserted in the RGB image. Its buffers are allocated once and reused */
+struct CapturedFrame : public SourceFrame
+{
+	/* Number of the frame since the capture started */
+	unsigned long sequence;
+	/* True if the RGB image is already flipped, so it looks like a mirror */
+	bool mirrored;
+};
+
+/** Counters of the capture thread */
+struct CaptureStats
+{
+	/* Number of frames read from the source. */
+	unsigned long captured;
+	/* Number of frames published in the ring. */
+	unsigned long published;
+	/* Number of published frames that the consumer skipped, because a newer one was available. */
+	unsigned long dropped;
+	/* Number of frames that could not be published, because the ring was full. */
+	unsigned long overruns;
+	/* Number of failed reads of the source. */
+	unsigned long failed;
+};
+
+
+class FrameCapture
+{
+	public:
+		FrameCapture(FrameSource *source);
+		~FrameCapture();
+
+		void setBackground(const cv::Mat &frameImageLoaded);
+		void setSinglePass(bool enabled);
+		void setProfiler(Profiler *profiler);
+		bool start();
+		void stop();
+
+		CapturedFrame *acquireLatestFrame(int timeoutMs = CAPTURE_TIMEOUT_MS);
+		void releaseFrame();
+		CaptureStats getStats();
+
+	private:
+		static void *captureThread(void *param);
+		void captureFrames();
+		bool readFrame(CapturedFrame &slot);
+
+		FrameSource *source; /** Source the frames are read from. Only the capture thread uses it while it is running */
+		ChromaKey chroma; /** Inserts the background image in the frames */
+		bool chromaEnabled; /** True if a background image was set */
+		bool singlePass; /** True if the RGB image is converted, keyed and mirrored in a single pass */
+		Profiler *profiler; /** Profiler where the times of the capture thread are recorded, or NULL */
+		int stageSource, stageCompose; /** Stages of the profiler: reading the source and making the RGB image */
+		cv::Mat sensorColor; /** RGB image of the source, before it is converted */
+		SourceFrame discarded; /** Frame read when the ring is full, so the source does not fall behind */
+
+		pthread_t thread; /** Thread where the frames are read */
+		volatile bool running; /** False when the thread must finish */
+		bool started; /** True if the thread was created */
+
+		CapturedFrame slots[CAPTURE_SLOTS]; /** Ring of frames. Slot 'n % CAPTURE_SLOTS' holds the frame number 'n' */
+		volatile unsigned long published; /** Number of frames published. Only written by the capture thread */
+		volatile unsigned long consumed; /** Number of the oldest frame still in use by the consumer. Only written by the consumer */
+		bool holding; /** True if the consumer holds a frame */
+
+		volatile unsigned long captured; /** Counters written by the capture thread */
+		volatile unsigned long overruns;
+		volatile unsigned long failed;
+		unsigned long dropped; /** Counter written by the consumer */
+};
+
+#endif
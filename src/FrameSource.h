@@ -0,0 +1,134 @@
+/**
+ @file   FrameSource.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Interface of the sources of frames: the Kinect sensor, a recorded *.oni file or a synthetic generator.
+*/
+
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <algorithm> // Include for std::swap
+#include "cvaux.h" // Include for OpenCV
+
+#include "Skeleton.h"
+
+
+//Macros
+#define WIN_SIZE_X	640
+#define WIN_SIZE_Y	480
+
+#define MAX_USERS	10
+
+
+using namespace std;
+
+/** State of a user */
+enum UserState {USER_NOT_FOUND, USER_FOUND, CALIBRATING, TRACKING, STOPPED};
+
+/** Holds the coordinates and user state of an user */
+struct userInfo
+{
+	/* X-coordinate of the right hand */
+	float rightHandX;
+	/* Y-coordinate of the right hand */
+	float rightHandY;
+	/* X-coordinate of the left hand */
+	float leftHandX;
+	/* Y-coordinate of the left hand */
+	float leftHandY;
+	/* X-coordinate of the head */
+	float headX;
+	/* Y-coordinate of the head */
+	float headY;
+	/* X-coordinate of the neck */
+	float neckX;
+	/* Y-coordinate of the neck */
+	float neckY;
+	/* X-coordinate of the left shoulder */
+	float leftShoulderX;
+	/* Y-coordinate of the left shoulder */
+	float leftShoulderY;
+	/* X-coordinate of the right shoulder */
+	float rightShoulderX;
+	/* Y-coordinate of the right shoulder */
+	float rightShoulderY;
+	/* X-coordinate of the left elbow */
+	float leftElbowX;
+	/* Y-coordinate of the left elbow */
+	float leftElbowY;
+	/* X-coordinate of the right elbow */
+	float rightElbowX;
+	/* Y-coordinate of the right elbow */
+	float rightElbowY;
+	/* X-coordinate of the left hip */
+	float leftHipX;
+	/* Y-coordinate of the left hip */
+	float leftHipY;
+	/* X-coordinate of the right hip */
+	float rightHipX;
+	/* Y-coordinate of the right hip */
+	float rightHipY;
+	/* State of the user */
+	UserState userState;
+};
+
+
+/** Data of a frame given by a source. The buffers belong to the caller, and they are reused between frames */
+struct SourceFrame
+{
+	/* Image of the RGB camera in BGR */
+	cv::Mat frameColor;
+	/* User map (CV_16U). 0 means there is no user in that pixel */
+	cv::Mat userMap;
+	/* Coordinates and state of every user */
+	userInfo usersInfo[MAX_USERS];
+	/* All the joints of every user. Only valid for the users being tracked */
+	UserSkeleton skeletons[MAX_USERS];
+	/* Number of users detected */
+	int usersNumber;
+	/* Timestamp of the frame, in microseconds */
+	unsigned long long timestamp;
+	/* Index of the frame */
+	int frameIndex;
+};
+
+
+class FrameSource
+{
+	public:
+		virtual ~FrameSource() {}
+
+		/**
+		 Reads the next frame: RGB image, user map and joints, all of them from the same moment.
+
+		 @param [out] frame Frame where the data is copied.
+
+		 @return True if the frame was read, false otherwise.
+		*/
+		virtual bool readSnapshot(SourceFrame &frame) = 0;
+
+		/**
+		 Reads the next frame, but gives the RGB image as the source has it, without converting it. By default,
+		 the frame is read with @ref readSnapshot and its BGR image is moved to 'sensorColor'.
+
+		 @param [out] frame Frame where the user map and the joints are copied. Its RGB image is not valid.
+		 @param [out] sensorColor Image of the RGB camera. It may be a header over a buffer of the source, valid until the next read.
+		 @param [out] isRgb True if the image is in RGB, false if it is in BGR.
+
+		 @return True if the frame was read, false otherwise.
+		*/
+		virtual bool readRawSnapshot(SourceFrame &frame, cv::Mat &sensorColor, bool &isRgb)
+		{
+			if ( !readSnapshot(frame) )
+				return false;
+
+			// The buffers are exchanged, so none of them is allocated again
+			std::swap(frame.frameColor, sensorColor);
+			isRgb = false;
+
+			return true;
+		}
+};
+
+#endif
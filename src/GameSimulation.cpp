@@ -0,0 +1,424 @@
+/**
+ @file   GameSimulation.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Rules of the game (fruits, score, pauses and duration), advanced with a fixed tick of a monotonic clock.
+*/
+
+#include "GameSimulation.h"
+
+#include <ctime> // Include for clock_gettime() function
+
+using namespace std;
+
+
+/**
+ Constructor. The game does not start until @ref start is called.
+
+ @param [in] graphics Graphics of the game. The simulation moves their fruit and checks the hands against it.
+ @param [in] maxDuration Duration of the game, in seconds.
+ @param [in] fruitDuration Duration of a fruit before it is counted as a failure, in seconds.
+*/
+GameSimulation::GameSimulation(Graphics *graphics, int maxDuration, int fruitDuration)
+{
+	this->graphics = graphics;
+	this->maxDuration = maxDuration;
+	this->fruitDuration = fruitDuration;
+
+	state = SIMULATION_STOPPED;
+	simulatedUsec = 0;
+	gameTicks = 0;
+	fruitTicks = 0;
+	successes = 0;
+	failures = 0;
+	swept = 1;
+	interpolation = true;
+	handsUsec = 0;
+
+	for (int i = 0; i < 2 * MAX_USERS; i++)
+		hands[i].valid = false;
+
+	// Initial position of the fruit in the graphics
+	fruitX = 460;
+	fruitY = 40;
+}
+
+
+/**
+ Destructor.
+*/
+GameSimulation::~GameSimulation()
+{
+}
+
+
+/**
+ Gets the time of the monotonic clock, which is not changed when the date of the system is changed.
+
+ @return Time of the clock, in microseconds.
+*/
+long long GameSimulation::monotonicUsec()
+{
+	timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+/**
+ Starts a new game with the score at zero. The first fruit is the one currently in the graphics.
+
+ @param [in] nowUsec Current time of the monotonic clock, in microseconds.
+
+ @return Nothing.
+*/
+void GameSimulation::start(long long nowUsec)
+{
+	state = SIMULATION_PLAYING;
+	simulatedUsec = nowUsec;
+	gameTicks = 0;
+	fruitTicks = 0;
+	successes = 0;
+	failures = 0;
+}
+
+
+/**
+ Pauses the game. The ticks run while it is paused do not count for the game nor for the fruit.
+
+ @return Nothing.
+*/
+void GameSimulation::pause()
+{
+	if (state == SIMULATION_PLAYING)
+		state = SIMULATION_PAUSED;
+}
+
+
+/**
+ Resumes a paused game.
+
+ @return Nothing.
+*/
+void GameSimulation::resume()
+{
+	if (state == SIMULATION_PAUSED)
+		state = SIMULATION_PLAYING;
+}
+
+
+/**
+ Sets the hands of a new frame. The next ticks check the path of every hand from its position in the
+ previous frame to its position in this one, so a fast hand that goes through the fruit between two
+ frames also catches it. If no tick was run since the previous frame, the part of the previous path not
+ checked yet is checked too.
+
+ @param [in] usersInfo Coordinates and state of the users.
+ @param [in] usersNumber Number of users.
+ @param [in] nowUsec Time of the clock of the frame, in microseconds. It limits how far a hand can move since
+ 	the previous frame.
+
+ @return Nothing.
+*/
+void GameSimulation::setHands(const userInfo *usersInfo, int usersNumber, long long nowUsec)
+{
+	long long elapsedUsec = nowUsec - handsUsec;
+	float maxDistance;
+
+	// Longest path of a hand since the previous frame. At least a tick, so frames closer than a tick or a clock
+	// that goes back do not drop the paths
+	if (elapsedUsec < SIMULATION_TICK_US)
+		elapsedUsec = SIMULATION_TICK_US;
+
+	maxDistance = (float)SIMULATION_MAX_HAND_SPEED * elapsedUsec / 1000000;
+	handsUsec = nowUsec;
+
+	for (int i = 0; i < MAX_USERS; i++)
+	{
+		// The hands of the users not tracked in this frame are not available
+		if (i >= usersNumber || usersInfo[i].userState != TRACKING)
+		{
+			setHand(2 * i, false, -1, -1, maxDistance);
+			setHand(2 * i + 1, false, -1, -1, maxDistance);
+			continue;
+		}
+
+		setHand(2 * i, usersInfo[i].rightHandX != -1, usersInfo[i].rightHandX, usersInfo[i].rightHandY, maxDistance);
+		setHand(2 * i + 1, usersInfo[i].leftHandX != -1, usersInfo[i].leftHandX, usersInfo[i].leftHandY, maxDistance);
+	}
+
+	swept = 0;
+}
+
+
+/**
+ Chooses how the paths of the hands are checked. With interpolation, the path is split between the ticks
+ run until the next frame, as if the hand moved at a constant speed, so the fruit is caught in the tick
+ when the hand really reached it. Without interpolation, the whole path is checked in the first tick.
+
+ @param [in] enabled True to split the paths between the ticks, false otherwise.
+
+ @return Nothing.
+*/
+void GameSimulation::setInterpolation(bool enabled)
+{
+	interpolation = enabled;
+}
+
+
+/**
+ Runs all the ticks between the last one and a moment of the clock. If frames were dropped, several ticks
+ are run at once, so the fruits and the duration of the game follow the clock and not the frames shown.
+
+ @param [in] nowUsec Current time of the clock, in microseconds. It can be a simulated time, to run the game
+ 	faster than real time.
+
+ @return Number of ticks run.
+*/
+int GameSimulation::advance(long long nowUsec)
+{
+	int ticks;
+	int ticksNum;
+	float sweepFrom, sweepTo;
+
+	if (state == SIMULATION_STOPPED || state == SIMULATION_OVER)
+		return 0;
+
+	ticksNum = (int)((nowUsec - simulatedUsec) / SIMULATION_TICK_US);
+
+	for (ticks = 0; ticks < ticksNum; ticks++)
+	{
+		// Part of the paths of the hands checked in this tick. Once the paths are checked, only the last positions are
+		sweepFrom = swept;
+		sweepTo = (interpolation) ? swept + (1 - swept) / (ticksNum - ticks) : 1;
+		swept = sweepTo;
+
+		tick(sweepFrom, sweepTo);
+		simulatedUsec += SIMULATION_TICK_US;
+	}
+
+	return ticks;
+}
+
+
+/**
+ Runs a single tick of the game: ends the game when its time is over, and counts the fruit as a success
+ when a hand touches it or as a failure when its time is over. In both cases, a new fruit is shown.
+
+ @param [in] sweepFrom Start of the part of the paths of the hands checked in this tick, from 0 to 1.
+ @param [in] sweepTo End of the part of the paths checked in this tick, from 0 to 1.
+
+ @return Nothing.
+*/
+void GameSimulation::tick(float sweepFrom, float sweepTo)
+{
+	if (state != SIMULATION_PLAYING)
+		return;
+
+	gameTicks++;
+	fruitTicks++;
+
+	if (gameTicks > (unsigned long)maxDuration * SIMULATION_HZ)
+	{
+		state = SIMULATION_OVER;
+	}
+	else if (handsOnFruit(sweepFrom, sweepTo))
+	{
+		successes++;
+		graphics->changeFruit(fruitX, fruitY);
+		fruitTicks = 0;
+
+		// The rest of the paths cannot catch the new fruit, only the last positions of the hands
+		swept = 1;
+	}
+	else if (fruitTicks >= (unsigned long)fruitDuration * SIMULATION_HZ)
+	{
+		failures++;
+		graphics->changeFruit(fruitX, fruitY);
+		fruitTicks = 0;
+	}
+}
+
+
+/**
+ Gets the state of the game.
+
+ @return The state of the game.
+*/
+SimulationState GameSimulation::getState()
+{
+	return state;
+}
+
+
+/**
+ Gets the number of fruits caught.
+
+ @return Number of successes.
+*/
+int GameSimulation::getSuccesses()
+{
+	return successes;
+}
+
+
+/**
+ Gets the number of fruits not caught in time.
+
+ @return Number of failures.
+*/
+int GameSimulation::getFailures()
+{
+	return failures;
+}
+
+
+/**
+ Gets the X-coordinate of the current fruit.
+
+ @return X-coordinate of the fruit.
+*/
+float GameSimulation::getFruitX()
+{
+	return fruitX;
+}
+
+
+/**
+ Gets the Y-coordinate of the current fruit.
+
+ @return Y-coordinate of the fruit.
+*/
+float GameSimulation::getFruitY()
+{
+	return fruitY;
+}
+
+
+/**
+ Gets the time played since the game started, without the pauses.
+
+ @return Time played, in whole seconds.
+*/
+int GameSimulation::getElapsedSeconds()
+{
+	return gameTicks / SIMULATION_HZ;
+}
+
+
+/**
+ Gets the time played since the game started, without the pauses, with the resolution of a tick.
+
+ @return Time played, in microseconds.
+*/
+unsigned long long GameSimulation::getElapsedUsec()
+{
+	return (unsigned long long)gameTicks * SIMULATION_TICK_US;
+}
+
+
+/**
+ Gets the time left before the game is over.
+
+ @return Time left, in whole seconds.
+*/
+int GameSimulation::getRemainingSeconds()
+{
+	int remaining = maxDuration - getElapsedSeconds();
+
+	return (remaining > 0) ? remaining : 0;
+}
+
+
+/**
+ Gets the time the current fruit has been shown, to draw its clock. The time between the last tick and
+ the moment of the frame is interpolated, so the clock moves smoothly even if the frames are not aligned
+ with the ticks.
+
+ @param [in] nowUsec Moment of the frame, in microseconds of the clock.
+
+ @return Time of the fruit, in microseconds.
+*/
+unsigned long long GameSimulation::getFruitProgress(long long nowUsec)
+{
+	unsigned long long progress = (unsigned long long)fruitTicks * SIMULATION_TICK_US;
+	long long partial = nowUsec - simulatedUsec;
+
+	if (state == SIMULATION_PLAYING && partial > 0)
+		progress += (partial < SIMULATION_TICK_US) ? partial : SIMULATION_TICK_US;
+
+	return progress;
+}
+
+
+/**
+ Sets the position of a hand in a new frame. Its path starts at its position in the previous frame, or at
+ the new position if the hand was not available or it jumped farther than a hand can move. If the previous path was not checked
+ completely by the ticks, the new path starts at the first point not checked, so no part of it is missed.
+
+ @param [in] hand Index of the hand: 2 * user for the right hand, 2 * user + 1 for the left one.
+ @param [in] available True if the hand is available in the new frame.
+ @param [in] x X-coordinate of the hand.
+ @param [in] y Y-coordinate of the hand.
+ @param [in] maxDistance Longest path of a hand since the previous frame, in pixels.
+
+ @return Nothing.
+*/
+void GameSimulation::setHand(int hand, bool available, float x, float y, float maxDistance)
+{
+	HandPath &path = hands[hand];
+
+	if (!available)
+	{
+		path.valid = false;
+		return;
+	}
+
+	if (path.valid && (x - path.toX) * (x - path.toX) + (y - path.toY) * (y - path.toY) <= maxDistance * maxDistance)
+	{
+		// With 'swept' at 1 (the whole path was checked), the new path starts at the previous position
+		path.fromX += (path.toX - path.fromX) * swept;
+		path.fromY += (path.toY - path.fromY) * swept;
+	}
+	else
+	{
+		path.fromX = x;
+		path.fromY = y;
+	}
+
+	path.toX = x;
+	path.toY = y;
+	path.valid = true;
+}
+
+
+/**
+ Checks if any of the hands touches the fruit in a part of its path.
+
+ @param [in] sweepFrom Start of the part of the path, from 0 (previous frame) to 1 (last frame).
+ @param [in] sweepTo End of the part of the path.
+
+ @return True if a hand touches the fruit, false otherwise.
+*/
+bool GameSimulation::handsOnFruit(float sweepFrom, float sweepTo)
+{
+	float dx, dy;
+
+	for (int i = 0; i < 2 * MAX_USERS; i++)
+	{
+		const HandPath &path = hands[i];
+
+		if (!path.valid)
+			continue;
+
+		dx = path.toX - path.fromX;
+		dy = path.toY - path.fromY;
+
+		if ( graphics->intersectionFruit(path.fromX + dx * sweepFrom, path.fromY + dy * sweepFrom, path.fromX + dx * sweepTo, path.fromY + dy * sweepTo) )
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,84 @@
+/**
+ @file   GameSimulation.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Rules of the game (fruits, score, pauses and duration), advanced with a fixed tick of a monotonic clock.
+*/
+
+#ifndef GAMESIMULATION_H
+#define GAMESIMULATION_H
+
+#include "FrameSource.h"
+#include "Graphics.h"
+
+//Macros
+#define SIMULATION_HZ		100 // Ticks of the simulation per second
+#define SIMULATION_TICK_US	(1000000 / SIMULATION_HZ)
+#define SIMULATION_MAX_HAND_SPEED	6000 // Fastest movement of a hand, in pixels per second. Faster jumps between two frames are errors of the tracker
+
+
+using namespace std;
+
+/** State of a game in the simulation */
+enum SimulationState {SIMULATION_STOPPED, SIMULATION_PLAYING, SIMULATION_PAUSED, SIMULATION_OVER};
+
+/** Path of a hand between the previous frame and the last one */
+struct HandPath
+{
+	/* Position in the previous frame */
+	float fromX, fromY;
+	/* Position in the last frame */
+	float toX, toY;
+	/* True if the hand is available in the last frame */
+	bool valid;
+};
+
+
+class GameSimulation
+{
+	public:
+		GameSimulation(Graphics *graphics, int maxDuration, int fruitDuration);
+		~GameSimulation();
+
+		static long long monotonicUsec();
+
+		void start(long long nowUsec);
+		void pause();
+		void resume();
+		void setHands(const userInfo *usersInfo, int usersNumber, long long nowUsec);
+		void setInterpolation(bool enabled);
+		int advance(long long nowUsec);
+
+		SimulationState getState();
+		int getSuccesses();
+		int getFailures();
+		float getFruitX();
+		float getFruitY();
+		int getElapsedSeconds();
+		unsigned long long getElapsedUsec();
+		int getRemainingSeconds();
+		unsigned long long getFruitProgress(long long nowUsec);
+
+	private:
+		void tick(float sweepFrom, float sweepTo);
+		void setHand(int hand, bool available, float x, float y, float maxDistance);
+		bool handsOnFruit(float sweepFrom, float sweepTo);
+
+		Graphics *graphics; /** Graphics of the game, which hold the position and size of the fruit */
+		int maxDuration; /** Duration of the game, in seconds */
+		int fruitDuration; /** Duration of a fruit, in seconds */
+
+		SimulationState state;
+		long long simulatedUsec; /** Moment of the monotonic clock until which the ticks have been run */
+		unsigned long gameTicks; /** Ticks played since the game started, without the pauses */
+		unsigned long fruitTicks; /** Ticks played since the current fruit was shown, without the pauses */
+		int successes, failures;
+		float fruitX, fruitY; /** Position of the current fruit */
+
+		HandPath hands[2 * MAX_USERS]; /** Right and left hands of every user, in the last frame and in the previous one */
+		long long handsUsec; /** Moment of the clock of the last frame whose hands were set */
+		float swept; /** Part of the paths of the hands already checked by the ticks, from 0 to 1 */
+		bool interpolation; /** True if the paths are split between the ticks until the next frame */
+};
+
+#endif
@@ -9,10 +9,14 @@
 #include "cvaux.h" // Include for OpenCV
 #include "highgui.h" // Include for imread() function of OpenCV
 #include <cairo/cairo.h> // Include of Cairo Graphic Library
+#include <iostream> // Include for cout
 
 using namespace std;
 using namespace cv;
 
+/** Center points of the texts of the score bar: successes, failures and timer */
+static const Point2d scoreBarPositions[3] = {Point2d(130, 440), Point2d(55, 440), Point2d(220, 455)};
+
 
 /**
  Constructor.
@@ -23,47 +27,47 @@ Graphics::Graphics()
 	srand(time(NULL));
 
 	//Loads keyboard images
-	frameA = imread("./img/keyboard/A.png", CV_LOAD_IMAGE_COLOR);
-	frameB = imread("./img/keyboard/B.png", CV_LOAD_IMAGE_COLOR);
-	frameC = imread("./img/keyboard/C.png", CV_LOAD_IMAGE_COLOR);
-	frameD = imread("./img/keyboard/D.png", CV_LOAD_IMAGE_COLOR);
-	frameE = imread("./img/keyboard/E.png", CV_LOAD_IMAGE_COLOR);
-	frameF = imread("./img/keyboard/F.png", CV_LOAD_IMAGE_COLOR);
-	frameG = imread("./img/keyboard/G.png", CV_LOAD_IMAGE_COLOR);
-	frameH = imread("./img/keyboard/H.png", CV_LOAD_IMAGE_COLOR);
-	frameI = imread("./img/keyboard/I.png", CV_LOAD_IMAGE_COLOR);
-	frameJ = imread("./img/keyboard/J.png", CV_LOAD_IMAGE_COLOR);
-	frameK = imread("./img/keyboard/K.png", CV_LOAD_IMAGE_COLOR);
-	frameL = imread("./img/keyboard/L.png", CV_LOAD_IMAGE_COLOR);
-	frameM = imread("./img/keyboard/M.png", CV_LOAD_IMAGE_COLOR);
-	frameN = imread("./img/keyboard/N.png", CV_LOAD_IMAGE_COLOR);
-	frameNN = imread("./img/keyboard/NN.png", CV_LOAD_IMAGE_COLOR);
-	frameO = imread("./img/keyboard/O.png", CV_LOAD_IMAGE_COLOR);
-	frameP = imread("./img/keyboard/P.png", CV_LOAD_IMAGE_COLOR);
-	frameQ = imread("./img/keyboard/Q.png", CV_LOAD_IMAGE_COLOR);
-	frameR = imread("./img/keyboard/R.png", CV_LOAD_IMAGE_COLOR);
-	frameS = imread("./img/keyboard/S.png", CV_LOAD_IMAGE_COLOR);
-	frameT = imread("./img/keyboard/T.png", CV_LOAD_IMAGE_COLOR);
-	frameU = imread("./img/keyboard/U.png", CV_LOAD_IMAGE_COLOR);
-	frameV = imread("./img/keyboard/V.png", CV_LOAD_IMAGE_COLOR);
-	frameW = imread("./img/keyboard/W.png", CV_LOAD_IMAGE_COLOR);
-	frameX = imread("./img/keyboard/X.png", CV_LOAD_IMAGE_COLOR);
-	frameY = imread("./img/keyboard/Y.png", CV_LOAD_IMAGE_COLOR);
-	frameZ = imread("./img/keyboard/Z.png", CV_LOAD_IMAGE_COLOR);
-	frame0 = imread("./img/keyboard/0.png", CV_LOAD_IMAGE_COLOR);
-	frame1 = imread("./img/keyboard/1.png", CV_LOAD_IMAGE_COLOR);
-	frame2 = imread("./img/keyboard/2.png", CV_LOAD_IMAGE_COLOR);
-	frame3 = imread("./img/keyboard/3.png", CV_LOAD_IMAGE_COLOR);
-	frame4 = imread("./img/keyboard/4.png", CV_LOAD_IMAGE_COLOR);
-	frame5 = imread("./img/keyboard/5.png", CV_LOAD_IMAGE_COLOR);
-	frame6 = imread("./img/keyboard/6.png", CV_LOAD_IMAGE_COLOR);
-	frame7 = imread("./img/keyboard/7.png", CV_LOAD_IMAGE_COLOR);
-	frame8 = imread("./img/keyboard/8.png", CV_LOAD_IMAGE_COLOR);
-	frame9 = imread("./img/keyboard/9.png", CV_LOAD_IMAGE_COLOR);
-	frameSpace = imread("./img/keyboard/space.png", CV_LOAD_IMAGE_COLOR);
-	frameDelete = imread("./img/keyboard/delete.png", CV_LOAD_IMAGE_COLOR);
-	frameEnterKey = imread("./img/keyboard/enter.png", CV_LOAD_IMAGE_COLOR);
-	frameKeyboardBackground = imread("./img/keyboard/keyboardInputBackground.png", CV_LOAD_IMAGE_COLOR);
+	loadSprite(frameA, "./img/keyboard/A.png");
+	loadSprite(frameB, "./img/keyboard/B.png");
+	loadSprite(frameC, "./img/keyboard/C.png");
+	loadSprite(frameD, "./img/keyboard/D.png");
+	loadSprite(frameE, "./img/keyboard/E.png");
+	loadSprite(frameF, "./img/keyboard/F.png");
+	loadSprite(frameG, "./img/keyboard/G.png");
+	loadSprite(frameH, "./img/keyboard/H.png");
+	loadSprite(frameI, "./img/keyboard/I.png");
+	loadSprite(frameJ, "./img/keyboard/J.png");
+	loadSprite(frameK, "./img/keyboard/K.png");
+	loadSprite(frameL, "./img/keyboard/L.png");
+	loadSprite(frameM, "./img/keyboard/M.png");
+	loadSprite(frameN, "./img/keyboard/N.png");
+	loadSprite(frameNN, "./img/keyboard/NN.png");
+	loadSprite(frameO, "./img/keyboard/O.png");
+	loadSprite(frameP, "./img/keyboard/P.png");
+	loadSprite(frameQ, "./img/keyboard/Q.png");
+	loadSprite(frameR, "./img/keyboard/R.png");
+	loadSprite(frameS, "./img/keyboard/S.png");
+	loadSprite(frameT, "./img/keyboard/T.png");
+	loadSprite(frameU, "./img/keyboard/U.png");
+	loadSprite(frameV, "./img/keyboard/V.png");
+	loadSprite(frameW, "./img/keyboard/W.png");
+	loadSprite(frameX, "./img/keyboard/X.png");
+	loadSprite(frameY, "./img/keyboard/Y.png");
+	loadSprite(frameZ, "./img/keyboard/Z.png");
+	loadSprite(frame0, "./img/keyboard/0.png");
+	loadSprite(frame1, "./img/keyboard/1.png");
+	loadSprite(frame2, "./img/keyboard/2.png");
+	loadSprite(frame3, "./img/keyboard/3.png");
+	loadSprite(frame4, "./img/keyboard/4.png");
+	loadSprite(frame5, "./img/keyboard/5.png");
+	loadSprite(frame6, "./img/keyboard/6.png");
+	loadSprite(frame7, "./img/keyboard/7.png");
+	loadSprite(frame8, "./img/keyboard/8.png");
+	loadSprite(frame9, "./img/keyboard/9.png");
+	loadSprite(frameSpace, "./img/keyboard/space.png");
+	loadSprite(frameDelete, "./img/keyboard/delete.png");
+	loadSprite(frameEnterKey, "./img/keyboard/enter.png");
+	loadSprite(frameKeyboardBackground, "./img/keyboard/keyboardInputBackground.png");
 
 	keySize = 46;
 	keySeparation = 51; //Separation between x coordinate of a key and the x coordinate of the key beside
@@ -81,8 +85,8 @@ Graphics::Graphics()
 	keyboardBackground.y = 340;
 
 
-	frameYesButton = imread("./img/yesButton.png", CV_LOAD_IMAGE_COLOR);
-	frameNoButton = imread("./img/noButton.png", CV_LOAD_IMAGE_COLOR);
+	loadSprite(frameYesButton, "./img/yesButton.png");
+	loadSprite(frameNoButton, "./img/noButton.png");
 	yesButton.width = 245;
 	noButton.width = 245;
 	yesButton.height = 46;
@@ -94,8 +98,8 @@ Graphics::Graphics()
 	yesButton.x = 337;
 
 
-	frameNewGameButton = imread("./img/newGameButton.png", CV_LOAD_IMAGE_COLOR);
-	frameExitButton = imread("./img/exitButton.png", CV_LOAD_IMAGE_COLOR);
+	loadSprite(frameNewGameButton, "./img/newGameButton.png");
+	loadSprite(frameExitButton, "./img/exitButton.png");
 	newGameButton.width = 150;
 	exitButton.width = 150;
 	newGameButton.height = 90;
@@ -106,11 +110,11 @@ Graphics::Graphics()
 	newGameButton.x = 370;
 	exitButton.x = 105;
 
-	frameApple = imread("./img/fruits/apple80.png", CV_LOAD_IMAGE_COLOR);
-	frameCherry = imread("./img/fruits/cherry80.png", CV_LOAD_IMAGE_COLOR);
-	frameOrange = imread("./img/fruits/orange80.png", CV_LOAD_IMAGE_COLOR);
-	frameTomato = imread("./img/fruits/tomato80.png", CV_LOAD_IMAGE_COLOR);
-	frameWatermelon = imread("./img/fruits/watermelon80.png", CV_LOAD_IMAGE_COLOR);
+	loadSprite(frameApple, "./img/fruits/apple80.png");
+	loadSprite(frameCherry, "./img/fruits/cherry80.png");
+	loadSprite(frameOrange, "./img/fruits/orange80.png");
+	loadSprite(frameTomato, "./img/fruits/tomato80.png");
+	loadSprite(frameWatermelon, "./img/fruits/watermelon80.png");
 	frameFruit = frameApple;
 
 	fruit.x = 460;
@@ -123,8 +127,8 @@ Graphics::Graphics()
 	keyboardInitialX = 540;
 	keyboardInitialY = 120;//90
 
-	frameGameJoint = imread("./img/handjoint.png", CV_LOAD_IMAGE_COLOR);
-	frameSelectJoint = imread("./img/keyboard/keyButton60.png", CV_LOAD_IMAGE_COLOR);
+	loadSprite(frameGameJoint, "./img/handjoint.png");
+	loadSprite(frameSelectJoint, "./img/keyboard/keyButton60.png");
 
 	gameJoint.width = 100;
 	gameJoint.height = 100;
@@ -132,7 +136,7 @@ Graphics::Graphics()
 	selectJoint.height = 60;
 
 	
-	frameBottomBar = imread("./img/bottomBar.png", CV_LOAD_IMAGE_COLOR);
+	loadSprite(frameBottomBar, "./img/bottomBar.png");
 
 	bottomBar.width = 640;
 	bottomBar.height = 76;
@@ -140,6 +144,17 @@ Graphics::Graphics()
 	bottomBar.y = 404;
 
 	chosenImage = 0;
+
+	profiler = NULL;
+	stageText = -1;
+
+	// The layers are composed the first time they are shown
+	invalidateLayers();
+
+	frameDamage.frames = 0;
+	frameDamage.rects = 0;
+	frameDamage.pixels = 0;
+	totalDamage = frameDamage;
 }
 
 
@@ -194,49 +209,144 @@ void Graphics::showFruitClock(Mat &frameColor, unsigned long long int time, int
 {
 	unsigned long long int angle = 360 * time / (fruitDuration*1000000);
 
+	Point center(flipXCoordinate(fruit.x, fruit.width) + fruit.width/2, fruit.y + fruit.height/2);
+
 	if(angle > 0)
-		cv::ellipse(frameColor, Point(flipXCoordinate(fruit.x, fruit.width) + fruit.width/2, fruit.y + fruit.height/2), cvSize(50,50), 90., /*startAngle*/0, /*endAngle*/angle, RED, 7, 8, 0);
+	{
+		cv::ellipse(frameColor, center, cvSize(50,50), 90., /*startAngle*/0, /*endAngle*/angle, RED, 7, 8, 0);
+
+		// The arc is inside the square of the circle, widened by the thickness of the line
+		markDamage(Rect(center.x - 54, center.y - 54, 109, 109), frameColor.size());
+	}
 }
 
 
 /**
- Shows the bottom bar of the game interface.
+ Shows the bottom bar of the game interface, with the score and the timer. The bar and its texts are kept
+ in a layer, and only the texts that changed since the previous frame are drawn again in the layer.
 
  @param [out] frameColor Frame containing the image of the RGB sensor.
+ @param [in] successes Score of successes of the game.
+ @param [in] failures Score of failures of the game.
+ @param [in] duration Current duration of the game.
 
  @return Nothing.
 */
-void Graphics::showBottomBar(Mat &frameColor)
+void Graphics::showScoreBar(Mat &frameColor, string successes, string failures, int duration)
 {
-	insertImage(frameColor, frameBottomBar, bottomBar.x, bottomBar.y, bottomBar.width, bottomBar.height);
+	Rect damage(0, 0, 0, 0);
+
+	// Composes the bar without texts, which is restored under the texts that change
+	if( !bottomBarLayer.valid || !scoreBarLayer.valid || bottomBarLayer.color.size() != frameColor.size() )
+	{
+		clearLayer(bottomBarLayer, frameColor.size());
+		composeBottomBar(bottomBarLayer);
+
+		clearLayer(scoreBarLayer, frameColor.size());
+		bottomBarLayer.color.copyTo(scoreBarLayer.color);
+		bottomBarLayer.mask.copyTo(scoreBarLayer.mask);
+		scoreBarLayer.bounds = bottomBarLayer.bounds;
+
+		for(int i = 0; i < 3; i++)
+		{
+			scoreBarTexts[i] = "";
+			scoreBarAreas[i] = Rect(0, 0, 0, 0);
+		}
+	}
+
+	// Gets the rectangles of the texts that changed
+	updateScoreBarText(0, successes, damage);
+	updateScoreBarText(1, failures, damage);
+	updateScoreBarText(2, timerText(duration), damage);
+
+	if( damage.area() > 0 )
+		recomposeScoreBar(damage);
+
+	applyLayer(frameColor, scoreBarLayer);
 }
 
 
 /**
- Shows a scoring marker.
+ Composes the bottom bar of the game interface in a layer.
 
- @param [out] frameColor Frame containing the image of the RGB sensor.
- @param [in] successes Score of successes of the game.
- @param [in] failures Score of failures of the game.
+ @param [out] layer Layer where the images are inserted.
 
  @return Nothing.
 */
-void Graphics::showScore(Mat &frameColor, string successes, string failures)
+void Graphics::composeBottomBar(OverlayLayer &layer)
 {
-	putTextCairo(frameColor, successes, cv::Point2d(130, 440), "arial", 40, WHITE, true);
-	putTextCairo(frameColor, failures, cv::Point2d(55, 440), "arial", 40, WHITE, true);
+	insertImage(layer, frameBottomBar, bottomBar.x, bottomBar.y, bottomBar.width, bottomBar.height);
 }
 
 
 /**
- Shows a timer.
+ Changes a text of the score bar. If it is different from the text in the layer, the rectangles of the
+ previous text and of the new one are added to the damaged area.
 
- @param [out] frameColor Frame containing the image of the RGB sensor.
- @param [in] duration Current duration of the game.
+ @param [in] index Number of the text: 0 for the successes, 1 for the failures and 2 for the timer.
+ @param [in] text New text.
+ @param [in,out] damage Area of the layer that must be composed again.
 
  @return Nothing.
 */
-void Graphics::showTimer(Mat &frameColor, int duration)
+void Graphics::updateScoreBarText(int index, string text, Rect &damage)
+{
+	if( text == scoreBarTexts[index] )
+		return;
+
+	if( scoreBarAreas[index].area() > 0 )
+		damage = (damage.area() > 0) ? (damage | scoreBarAreas[index]) : scoreBarAreas[index];
+
+	scoreBarTexts[index] = text;
+	scoreBarAreas[index] = layoutText(text, scoreBarPositions[index], "arial", 40, WHITE, true) & Rect(0, 0, scoreBarLayer.color.cols, scoreBarLayer.color.rows);
+
+	if( scoreBarAreas[index].area() > 0 )
+		damage = (damage.area() > 0) ? (damage | scoreBarAreas[index]) : scoreBarAreas[index];
+}
+
+
+/**
+ Composes again an area of the score bar: the bar is restored, and the texts that touch the area are
+ drawn again inside it.
+
+ @param [in] damage Area of the layer that must be composed again.
+
+ @return Nothing.
+*/
+void Graphics::recomposeScoreBar(Rect damage)
+{
+	damage &= Rect(0, 0, scoreBarLayer.color.cols, scoreBarLayer.color.rows);
+
+	Mat roiColor(scoreBarLayer.color, damage);
+	Mat roiMask(scoreBarLayer.mask, damage);
+
+	// Restores the bar under the texts
+	bottomBarLayer.color(damage).copyTo(roiColor);
+	bottomBarLayer.mask(damage).copyTo(roiMask);
+
+	for(int i = 0; i < 3; i++)
+	{
+		if( (scoreBarAreas[i] & damage).area() == 0 )
+			continue;
+
+		layoutText(scoreBarTexts[i], scoreBarPositions[i], "arial", 40, WHITE, true);
+
+		for(unsigned int j = 0; j < textLayout.size(); j++)
+			blendText(scoreBarLayer.color, &scoreBarLayer.mask, *textLayout[j].bitmap, textLayout[j].x, textLayout[j].y, damage);
+
+		scoreBarLayer.bounds |= scoreBarAreas[i];
+	}
+}
+
+
+/**
+ Makes the text of the timer.
+
+ @param [in] duration Current duration of the game, in seconds.
+
+ @return The duration as minutes and seconds.
+*/
+string Graphics::timerText(int duration)
 {
 	int minutes, seconds;
 	string timer;
@@ -257,7 +367,7 @@ void Graphics::showTimer(Mat &frameColor, int duration)
 	else
 		timer = itos(minutes) + ":0" + itos(seconds);
 
-	putTextCairo(frameColor, timer, cv::Point2d(220, 455), "arial", 40, WHITE, true);
+	return timer;
 }
 
 
@@ -321,6 +431,22 @@ bool Graphics::intersectionFruit(float x, float y)
 }
 
 
+/**
+ Calculates if a joint touched a fruit while it moved from one position to another. A fast hand can go
+ through the fruit between two frames without being inside it in any of them.
+
+ @param [in] fromX Coordinate in x-axis of the joint in the previous sample.
+ @param [in] fromY Coordinate in y-axis of the joint in the previous sample.
+ @param [in] toX Coordinate in x-axis of the joint in the current sample.
+ @param [in] toY Coordinate in y-axis of the joint in the current sample.
+ @return True if the path of the joint intersects with the fruit, false otherwise.
+*/
+bool Graphics::intersectionFruit(float fromX, float fromY, float toX, float toY)
+{
+	return( intersectionPath(fruit.width, fruit.height, fruit.x, fruit.y, fromX, fromY, toX, toY) );
+}
+
+
 /**
  Calculates the intersection between the 'new game' button and a joint (a hand).
 
@@ -414,66 +540,86 @@ void Graphics::showSelectJoint(Mat &frameColor, float x, float y)
 
 
 /**
- Inserts the keys of the keyboard.
+ Inserts the keys of the keyboard. They are composed in a layer the first time, and the whole layer
+ is inserted in every frame.
 
  @param [out] frameColor Frame containing the image of the RGB sensor.
 
  @return Nothing.
 */
 void Graphics::showKeyboard(Mat &frameColor)
+{
+	if( !keyboardLayer.valid || keyboardLayer.color.size() != frameColor.size() )
+	{
+		clearLayer(keyboardLayer, frameColor.size());
+		composeKeyboard(keyboardLayer);
+	}
+
+	applyLayer(frameColor, keyboardLayer);
+}
+
+
+/**
+ Composes the keys of the keyboard in a layer.
+
+ @param [out] layer Layer where the images are inserted.
+
+ @return Nothing.
+*/
+void Graphics::composeKeyboard(OverlayLayer &layer)
 {
 			// Inserts the enter key
-			insertImage(frameColor, frameEnterKey, enterKey.x, enterKey.y, enterKey.width, enterKey.height);
+			insertImage(layer, frameEnterKey, enterKey.x, enterKey.y, enterKey.width, enterKey.height);
 
 			// Inserts the keys of the first row of the keyboard
-			insertImage(frameColor, frameQ, keyboardInitialX, keyboardInitialY, keySize, keySize);
-			insertImage(frameColor, frameW, keyboardInitialX-1*keySeparation, keyboardInitialY, keySize, keySize);
-			insertImage(frameColor, frameE, keyboardInitialX-2*keySeparation, keyboardInitialY, keySize, keySize);
-			insertImage(frameColor, frameR, keyboardInitialX-3*keySeparation, keyboardInitialY, keySize, keySize);
-			insertImage(frameColor, frameT, keyboardInitialX-4*keySeparation, keyboardInitialY, keySize, keySize);
-			insertImage(frameColor, frameY, keyboardInitialX-5*keySeparation, keyboardInitialY, keySize, keySize);
-			insertImage(frameColor, frameU, keyboardInitialX-6*keySeparation, keyboardInitialY, keySize, keySize);
-			insertImage(frameColor, frameI, keyboardInitialX-7*keySeparation, keyboardInitialY, keySize, keySize);
-			insertImage(frameColor, frameO, keyboardInitialX-8*keySeparation, keyboardInitialY, keySize, keySize);
-			insertImage(frameColor, frameP, keyboardInitialX-9*keySeparation, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameQ, keyboardInitialX, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameW, keyboardInitialX-1*keySeparation, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameE, keyboardInitialX-2*keySeparation, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameR, keyboardInitialX-3*keySeparation, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameT, keyboardInitialX-4*keySeparation, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameY, keyboardInitialX-5*keySeparation, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameU, keyboardInitialX-6*keySeparation, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameI, keyboardInitialX-7*keySeparation, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameO, keyboardInitialX-8*keySeparation, keyboardInitialY, keySize, keySize);
+			insertImage(layer, frameP, keyboardInitialX-9*keySeparation, keyboardInitialY, keySize, keySize);
 
 			// Inserts the keys of the second row of the keyboard
-			insertImage(frameColor, frameA, keyboardInitialX, keyboardInitialY+1*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameS, keyboardInitialX-1*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameD, keyboardInitialX-2*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameF, keyboardInitialX-3*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameG, keyboardInitialX-4*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameH, keyboardInitialX-5*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameJ, keyboardInitialX-6*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameK, keyboardInitialX-7*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameL, keyboardInitialX-8*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameNN, keyboardInitialX-9*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameA, keyboardInitialX, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameS, keyboardInitialX-1*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameD, keyboardInitialX-2*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameF, keyboardInitialX-3*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameG, keyboardInitialX-4*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameH, keyboardInitialX-5*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameJ, keyboardInitialX-6*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameK, keyboardInitialX-7*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameL, keyboardInitialX-8*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
+			insertImage(layer, frameNN, keyboardInitialX-9*keySeparation, keyboardInitialY+1*keySeparation, keySize, keySize);
 
 			// Inserts the keys of the third row of the keyboard
-			insertImage(frameColor, frameZ, keyboardInitialX, keyboardInitialY+2*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameX, keyboardInitialX-1*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameC, keyboardInitialX-2*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameV, keyboardInitialX-3*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameB, keyboardInitialX-4*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameN, keyboardInitialX-5*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameM, keyboardInitialX-6*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
-			insertImage(frameColor, frameSpace, keyboardInitialX-8*keySeparation, keyboardInitialY+2*keySeparation, keySize*2+4/*(keySeparation-keySize)*/, keySize);
-			insertImage(frameColor, frameDelete, keyboardInitialX-9*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
+			insertImage(layer, frameZ, keyboardInitialX, keyboardInitialY+2*keySeparation, keySize, keySize);
+			insertImage(layer, frameX, keyboardInitialX-1*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
+			insertImage(layer, frameC, keyboardInitialX-2*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
+			insertImage(layer, frameV, keyboardInitialX-3*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
+			insertImage(layer, frameB, keyboardInitialX-4*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
+			insertImage(layer, frameN, keyboardInitialX-5*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
+			insertImage(layer, frameM, keyboardInitialX-6*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
+			insertImage(layer, frameSpace, keyboardInitialX-8*keySeparation, keyboardInitialY+2*keySeparation, keySize*2+4/*(keySeparation-keySize)*/, keySize);
+			insertImage(layer, frameDelete, keyboardInitialX-9*keySeparation, keyboardInitialY+2*keySeparation, keySize, keySize);
 
 			// Inserts the numbers keys of the keyboard
-			insertImage(frameColor, frame1, keyboardInitialX, keyboardInitialY+3*keySeparation, keySize, keySize);
-			insertImage(frameColor, frame2, keyboardInitialX-1*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
-			insertImage(frameColor, frame3, keyboardInitialX-2*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
-			insertImage(frameColor, frame4, keyboardInitialX-3*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
-			insertImage(frameColor, frame5, keyboardInitialX-4*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
-			insertImage(frameColor, frame6, keyboardInitialX-5*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
-			insertImage(frameColor, frame7, keyboardInitialX-6*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
-			insertImage(frameColor, frame8, keyboardInitialX-7*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
-			insertImage(frameColor, frame9, keyboardInitialX-8*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
-			insertImage(frameColor, frame0, keyboardInitialX-9*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame1, keyboardInitialX, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame2, keyboardInitialX-1*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame3, keyboardInitialX-2*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame4, keyboardInitialX-3*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame5, keyboardInitialX-4*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame6, keyboardInitialX-5*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame7, keyboardInitialX-6*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame8, keyboardInitialX-7*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame9, keyboardInitialX-8*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
+			insertImage(layer, frame0, keyboardInitialX-9*keySeparation, keyboardInitialY+3*keySeparation, keySize, keySize);
 
 			// Inserts the keyboard text input background
-			insertImage(frameColor, frameKeyboardBackground, keyboardBackground.x, keyboardBackground.y, keyboardBackground.width, keyboardBackground.height);
+			insertImage(layer, frameKeyboardBackground, keyboardBackground.x, keyboardBackground.y, keyboardBackground.width, keyboardBackground.height);
 }
 
 
@@ -487,17 +633,36 @@ void Graphics::showKeyboard(Mat &frameColor)
 */
 void Graphics::showDialog(Mat &frameColor, string query)
 {
-	insertImage(frameColor, frameYesButton, yesButton.x, yesButton.y, yesButton.width, yesButton.height);
-	insertImage(frameColor, frameNoButton, noButton.x, noButton.y, noButton.width, noButton.height);
+	if( !dialogLayer.valid || dialogLayer.color.size() != frameColor.size() )
+	{
+		clearLayer(dialogLayer, frameColor.size());
+		composeDialog(dialogLayer);
+	}
 
-	// Inserts the keyboard text input background
-	insertImage(frameColor, frameKeyboardBackground, keyboardBackground.x, keyboardBackground.y, keyboardBackground.width, keyboardBackground.height);
+	applyLayer(frameColor, dialogLayer);
 
 	putTextCairo(frameColor, query, cv::Point2d(WIN_SIZE_X/2, 360), "arial", 30, Scalar(255,255,255), true);
 	putTextCairo(frameColor, "¿Es correcto?", cv::Point2d(WIN_SIZE_X/2, 400), "arial", 30, Scalar(255,255,255), true);
 }
 
 
+/**
+ Composes the buttons of the dialog in a layer.
+
+ @param [out] layer Layer where the images are inserted.
+
+ @return Nothing.
+*/
+void Graphics::composeDialog(OverlayLayer &layer)
+{
+	insertImage(layer, frameYesButton, yesButton.x, yesButton.y, yesButton.width, yesButton.height);
+	insertImage(layer, frameNoButton, noButton.x, noButton.y, noButton.width, noButton.height);
+
+	// Inserts the keyboard text input background
+	insertImage(layer, frameKeyboardBackground, keyboardBackground.x, keyboardBackground.y, keyboardBackground.width, keyboardBackground.height);
+}
+
+
 /**
  Calculates if a joint intersects with a key of the keyboard.
 
@@ -598,10 +763,72 @@ bool Graphics::intersection(int imageWidth, int imageHeight, float imageCoordX,
 
 
 /**
- Inserts a image in the RGB frame.
+ Calculates if the straight path of a joint between two positions intersects with an area. The segment
+ is clipped against the four sides of the area (Liang-Barsky): it intersects if some part of it is left.
+ If both positions are the same, it is the same test as @ref intersection.
+
+ @param [in] imageWidth Width of the area.
+ @param [in] imageHeight Height of the area.
+ @param [in] imageCoordX Coordinate in x-axis of the area.
+ @param [in] imageCoordY Coordinate in y-axis of the area.
+ @param [in] fromX Coordinate in x-axis of the first position of the joint.
+ @param [in] fromY Coordinate in y-axis of the first position of the joint.
+ @param [in] toX Coordinate in x-axis of the second position of the joint.
+ @param [in] toY Coordinate in y-axis of the second position of the joint.
+
+ @return True if the path of the joint intersects with the area, false otherwise.
+*/
+bool Graphics::intersectionPath(int imageWidth, int imageHeight, float imageCoordX, float imageCoordY, float fromX, float fromY, float toX, float toY)
+{
+	float dx = toX - fromX;
+	float dy = toY - fromY;
+	// Each side of the area: the direction of the path towards outside and the distance from the first position to the side
+	float p[4] = {-dx, dx, -dy, dy};
+	float q[4] = {fromX - imageCoordX, imageCoordX + imageWidth - fromX, fromY - imageCoordY, imageCoordY + imageHeight - fromY};
+	float t0 = 0, t1 = 1; // Part of the path inside the area
+	float t;
+
+	for(int i = 0; i < 4; i++)
+	{
+		// The path is parallel to the side, so it is inside or outside of it along all its length
+		if(p[i] == 0)
+		{
+			if(q[i] < 0)
+				return false;
+
+			continue;
+		}
+
+		t = q[i] / p[i];
+
+		if(p[i] < 0)
+		{
+			// The path enters through this side
+			if(t > t1)
+				return false;
+			if(t > t0)
+				t0 = t;
+		}
+		else
+		{
+			// The path leaves through this side
+			if(t < t0)
+				return false;
+			if(t < t1)
+				t1 = t;
+		}
+	}
+
+	return true;
+}
+
+
+/**
+ Inserts a image in the RGB frame. Only the pixels of the mask of the image are copied, so its black
+ background is not drawn. The ROI is a header over the frame, so nothing is allocated.
 
  @param [out] frameColor Frame containing the image of the RGB sensor.
- @param [out] frameImagen Frame containing the image to insert.
+ @param [in] sprite Image to insert, with its mask.
  @param [in] coordX Coordinate in x-axis of the destination of the image.
  @param [in] coordY Coordinate in y-axis of the destination of the image.
  @param [in] imageWidth Width of the area.
@@ -609,39 +836,239 @@ bool Graphics::intersection(int imageWidth, int imageHeight, float imageCoordX,
 
  @return Nothing.
 */
-void Graphics::insertImage(cv::Mat &frameColor, cv::Mat &frameImagen, float coordX, float coordY, int imageWidth, int imageHeight)
+void Graphics::insertImage(cv::Mat &frameColor, const Sprite &sprite, float coordX, float coordY, int imageWidth, int imageHeight)
 {
-	Mat dst, img2gray, mask, mask_inv, img1_bg, img2_fg;
-
 	coordX = flipXCoordinate(coordX, imageWidth);
 
+	// The image is not inserted if it could not be loaded
+	if ( sprite.image.cols != imageWidth || sprite.image.rows != imageHeight )
+		return;
+
 	if ( !(coordX + imageWidth > WIN_SIZE_X || coordY + imageHeight > WIN_SIZE_Y || coordX < 0 || coordY < 0) )
 	{
 		// Selects a region of interest (ROI)
 		Mat roi(frameColor, Rect(coordX, coordY, imageWidth, imageHeight));
 
-		// Makes the image mask and the image inverse
-		//// Gets the image mask in greyscale
-		cvtColor(frameImagen, img2gray, COLOR_BGR2GRAY, 0);
-		//// Makes the image mask
-		threshold(img2gray, mask, 10, 255, THRESH_BINARY);
-		//// Inverts the bits of the image mask to gets the inverse
-		bitwise_not(mask, mask_inv);
+		// Inserts the pixels of the image in the ROI
+		sprite.image.copyTo(roi, sprite.mask);
 
-		Mat aux = mask;
+		markDamage(Rect(coordX, coordY, imageWidth, imageHeight), frameColor.size());
+	}
+}
 
-		// Black colour in the ROI
-		bitwise_and(roi, roi, img1_bg, mask = mask_inv);
 
-		// Gets the image area
-		bitwise_and(frameImagen, frameImagen, img2_fg, mask = aux);
+/**
+ Inserts a image in a layer. The image is drawn over the images already in the layer, as it would be
+ drawn over the frame, and its mask is added to the coverage of the layer.
 
-		// Inserts the image in the ROI
-		add(img1_bg, img2_fg, dst);
-	
+ @param [out] layer Layer where the image is inserted.
+ @param [in] sprite Image to insert, with its mask.
+ @param [in] coordX Coordinate in x-axis of the destination of the image.
+ @param [in] coordY Coordinate in y-axis of the destination of the image.
+ @param [in] imageWidth Width of the area.
+ @param [in] imageHeight Height of the area.
+
+ @return Nothing.
+*/
+void Graphics::insertImage(OverlayLayer &layer, const Sprite &sprite, float coordX, float coordY, int imageWidth, int imageHeight)
+{
+	coordX = flipXCoordinate(coordX, imageWidth);
+
+	// The image is not inserted if it could not be loaded
+	if ( sprite.image.cols != imageWidth || sprite.image.rows != imageHeight )
+		return;
+
+	if ( !(coordX + imageWidth > layer.color.cols || coordY + imageHeight > layer.color.rows || coordX < 0 || coordY < 0) )
+	{
+		Rect area(coordX, coordY, imageWidth, imageHeight);
+		Mat roiColor(layer.color, area);
+		Mat roiMask(layer.mask, area);
+
+		// Inserts the pixels of the image and adds them to the coverage
+		sprite.image.copyTo(roiColor, sprite.mask);
+		bitwise_or(roiMask, sprite.mask, roiMask);
+
+		if ( layer.bounds.area() == 0 )
+			layer.bounds = area;
+		else
+			layer.bounds |= area;
+	}
+}
+
+
+/**
+ Empties a layer, so it can be composed again.
+
+ @param [out] layer Layer to be emptied.
+ @param [in] size Size of the frames where the layer is inserted.
+
+ @return Nothing.
+*/
+void Graphics::clearLayer(OverlayLayer &layer, Size size)
+{
+	layer.color.create(size, CV_8UC3);
+	layer.mask.create(size, CV_8U);
+	layer.color.setTo( Scalar::all(0) );
+	layer.mask.setTo( Scalar(0) );
+	layer.bounds = Rect(0, 0, 0, 0);
+	layer.valid = true;
+}
+
+
+/**
+ Inserts all the images of a layer in the RGB frame at once. Only the rectangle that contains the
+ images is drawn: the pixels covered by an image are copied, and the edges of the texts are blended.
+
+ @param [out] frameColor Frame containing the image of the RGB sensor.
+ @param [in] layer Layer to be inserted.
+
+ @return Nothing.
+*/
+void Graphics::applyLayer(cv::Mat &frameColor, const OverlayLayer &layer)
+{
+	Rect visible = layer.bounds & Rect(0, 0, frameColor.cols, frameColor.rows);
+
+	for (int y = visible.y; y < visible.y + visible.height; y++)
+	{
+		const unsigned char *coverage = layer.mask.ptr<unsigned char>(y) + visible.x;
+		const unsigned char *color = layer.color.ptr<unsigned char>(y) + 3 * visible.x;
+		unsigned char *pixel = frameColor.ptr<unsigned char>(y) + 3 * visible.x;
+
+		for (int x = 0; x < visible.width; x++, coverage++, color += 3, pixel += 3)
+		{
+			if (*coverage == 255)
+			{
+				pixel[0] = color[0];
+				pixel[1] = color[1];
+				pixel[2] = color[2];
+			}
+			else if (*coverage != 0)
+			{
+				// The color of the layer is already multiplied by its coverage
+				pixel[0] = (unsigned char)((pixel[0] * (255 - *coverage) + 127) / 255 + color[0]);
+				pixel[1] = (unsigned char)((pixel[1] * (255 - *coverage) + 127) / 255 + color[1]);
+				pixel[2] = (unsigned char)((pixel[2] * (255 - *coverage) + 127) / 255 + color[2]);
+			}
+		}
+	}
+
+	markDamage(visible, frameColor.size());
+}
+
+
+/**
+ Marks the layers to be composed again. It must be called when the layout of the images changes.
+
+ @return Nothing.
+*/
+void Graphics::invalidateLayers()
+{
+	keyboardLayer.valid = false;
+	dialogLayer.valid = false;
+	bottomBarLayer.valid = false;
+	scoreBarLayer.valid = false;
+}
+
+
+/**
+ Starts a new frame: the counters of the areas drawn in the previous frame are reset.
+
+ @return Nothing.
+*/
+void Graphics::beginFrame()
+{
+	frameDamage.frames = 1;
+	frameDamage.rects = 0;
+	frameDamage.pixels = 0;
+
+	totalDamage.frames++;
+}
+
+
+/**
+ Sets the profiler where the time spent drawing texts is recorded. It adds the stage 'text'.
+
+ @param [in] profiler Profiler to be used.
+
+ @return Nothing.
+*/
+void Graphics::setProfiler(Profiler *profiler)
+{
+	this->profiler = profiler;
+	stageText = profiler->addStage("text");
+}
+
+
+/**
+ Gets the areas drawn in the current frame.
+
+ @return A @ref FrameDamage structure with the counters of the frame.
+*/
+FrameDamage Graphics::getFrameDamage()
+{
+	return frameDamage;
+}
+
+
+/**
+ Gets the areas drawn since the graphics were created.
+
+ @return A @ref FrameDamage structure with the counters of all the frames.
+*/
+FrameDamage Graphics::getTotalDamage()
+{
+	return totalDamage;
+}
+
+
+/**
+ Adds a rectangle drawn in the frame to the counters.
+
+ @param [in] area Rectangle drawn.
+ @param [in] frameSize Size of the frame, so only the visible part of the rectangle is counted.
+
+ @return Nothing.
+*/
+void Graphics::markDamage(Rect area, Size frameSize)
+{
+	area &= Rect(0, 0, frameSize.width, frameSize.height);
+
+	if( area.area() <= 0 )
+		return;
 
-		dst.copyTo(roi);
+	frameDamage.rects++;
+	frameDamage.pixels += area.area();
+	totalDamage.rects++;
+	totalDamage.pixels += area.area();
+}
+
+
+/**
+ Loads an image and makes its mask. The mask holds the pixels brighter than the black background
+ of the image, so it is made only once instead of every time the image is inserted.
+
+ @param [out] sprite Image and mask loaded.
+ @param [in] path Path of the image file.
+
+ @return True if the image was loaded, false otherwise.
+*/
+bool Graphics::loadSprite(Sprite &sprite, string path)
+{
+	Mat imageGray;
+
+	sprite.image = imread(path, CV_LOAD_IMAGE_COLOR);
+	if ( sprite.image.empty() )
+	{
+		cout << "ERROR: Couldn't load the image " << path << endl;
+		sprite.mask.release();
+		return false;
 	}
+
+	// Gets the image in greyscale and makes the mask
+	cvtColor(sprite.image, imageGray, COLOR_BGR2GRAY, 0);
+	threshold(imageGray, sprite.mask, 10, 255, THRESH_BINARY);
+
+	return true;
 }
 
 
@@ -666,7 +1093,9 @@ void Graphics::showText(string text, int x, int y, cv::Mat &frameColor) // ya no
 
 
 /**
- Inserts a text in the RGB frame.
+ Inserts a text in the RGB frame. Each text is rendered by Cairo only once and kept in a cache, so
+ only the rectangle of the text is blended in the frame. The scores and timers are made of glyphs
+ of DIGIT_GLYPHS, so they are drawn glyph by glyph and a new value does not need Cairo.
 
  @param [out] frameColor Frame containing the image of the RGB sensor.
  @param [in] text Text to be inserted.
@@ -680,65 +1109,266 @@ void Graphics::showText(string text, int x, int y, cv::Mat &frameColor) // ya no
 */
 void Graphics::putTextCairo(cv::Mat &frameColor, string const& text, Point2d centerPoint, string const& fontFace, double fontSize, Scalar textColor, bool centered)
 {
-    // Create Cairo
-    cairo_surface_t* surface =
-            cairo_image_surface_create(
-                CAIRO_FORMAT_ARGB32,
-                frameColor.cols,
-                frameColor.rows);
+	ProfileScope scope(profiler, stageText);
+	Rect area = layoutText(text, centerPoint, fontFace, fontSize, textColor, centered);
+
+	for(unsigned int i = 0; i < textLayout.size(); i++)
+		blendText(frameColor, NULL, *textLayout[i].bitmap, textLayout[i].x, textLayout[i].y, area);
+
+	markDamage(area, frameColor.size());
+}
 
-    cairo_t* cairo = cairo_create(surface);
 
-    // Wrap Cairo with a Mat
-    cv::Mat cairoTarget(
-                cairo_image_surface_get_height(surface),
-                cairo_image_surface_get_width(surface),
-                CV_8UC4,
-                cairo_image_surface_get_data(surface),
-                cairo_image_surface_get_stride(surface));
+/**
+ Places the glyphs of a text in the frame, as Cairo would draw them. The glyphs are left in 'textLayout'.
+
+ @param [in] text Text to be placed.
+ @param [in] centerPoint Coordinate of the center point of the text.
+ @param [in] fontFace Text font for the text.
+ @param [in] fontSize Size of the text.
+ @param [in] textColor Color of the text.
+ @param [in] centered Sets if the text must be centered in the coordinate or begin from there.
+
+ @return The rectangle covered by the bitmaps of the glyphs.
+*/
+Rect Graphics::layoutText(string const& text, Point2d centerPoint, string const& fontFace, double fontSize, Scalar textColor, bool centered)
+{
+	double originX, originY;
+	double penX = 0, minX = 0, maxX = 0, minY = 0, maxY = 0;
+	Rect area;
 
-    // Put image onto Cairo
-    cv::cvtColor(frameColor, cairoTarget, cv::COLOR_BGR2BGRA);
+	textLayout.clear();
 
-    // Set font and write text
-    cairo_select_font_face (
-                cairo,
-                fontFace.c_str(),
-                CAIRO_FONT_SLANT_NORMAL,
-                CAIRO_FONT_WEIGHT_NORMAL);
+	if( isDigitText(text) && !text.empty() )
+	{
+		// Places the glyphs as Cairo does, one after the other, and calculates the extents of the whole text
+		for(unsigned int i = 0; i < text.size(); i++)
+		{
+			PlacedText glyph;
+
+			glyph.bitmap = &getText(text.substr(i, 1), fontFace, fontSize, textColor);
+			glyph.x = penX;
+			glyph.y = 0;
+
+			if( i == 0 || penX + glyph.bitmap->xBearing < minX )
+				minX = penX + glyph.bitmap->xBearing;
+			if( i == 0 || penX + glyph.bitmap->xBearing + glyph.bitmap->width > maxX )
+				maxX = penX + glyph.bitmap->xBearing + glyph.bitmap->width;
+			if( i == 0 || glyph.bitmap->yBearing < minY )
+				minY = glyph.bitmap->yBearing;
+			if( i == 0 || glyph.bitmap->yBearing + glyph.bitmap->height > maxY )
+				maxY = glyph.bitmap->yBearing + glyph.bitmap->height;
+
+			penX += glyph.bitmap->xAdvance;
+			textLayout.push_back(glyph);
+		}
+	}
+	else
+	{
+		PlacedText whole;
 
-    cairo_set_font_size(cairo, fontSize);
-    cairo_set_source_rgb(cairo, textColor[2], textColor[1], textColor[0]);
+		whole.bitmap = &getText(text, fontFace, fontSize, textColor);
+		whole.x = 0;
+		whole.y = 0;
 
-    cairo_text_extents_t extents;
-    cairo_text_extents(cairo, text.c_str(), &extents);
+		minX = whole.bitmap->xBearing;
+		maxX = whole.bitmap->xBearing + whole.bitmap->width;
+		minY = whole.bitmap->yBearing;
+		maxY = whole.bitmap->yBearing + whole.bitmap->height;
+
+		textLayout.push_back(whole);
+	}
 
 	// If option 'centered' was set
 	if(centered)
 	{
-		cairo_move_to(
-		            cairo,
-		            flipXCoordinate(centerPoint.x, 0) - extents.width/2 - extents.x_bearing,
-		            centerPoint.y - extents.height/2- extents.y_bearing);
+		originX = flipXCoordinate(centerPoint.x, 0) - (maxX - minX)/2 - minX;
+		originY = centerPoint.y - (maxY - minY)/2 - minY;
 	}
 	else
 	{
-		cairo_move_to(
-		            cairo,
-		            flipXCoordinate(centerPoint.x, 0),
-		            centerPoint.y);		
+		originX = flipXCoordinate(centerPoint.x, 0);
+		originY = centerPoint.y;
+	}
+
+	// Moves the glyphs to the origin and gets the rectangle of their bitmaps
+	for(unsigned int i = 0; i < textLayout.size(); i++)
+	{
+		const TextBitmap *bitmap = textLayout[i].bitmap;
+
+		textLayout[i].x += originX;
+		textLayout[i].y += originY;
+
+		Rect glyphArea(cvRound(textLayout[i].x) + bitmap->offsetX, cvRound(textLayout[i].y) + bitmap->offsetY, bitmap->alpha.cols, bitmap->alpha.rows);
+
+		if( i == 0 )
+			area = glyphArea;
+		else
+			area |= glyphArea;
+	}
+
+	return area;
+}
+
+
+/**
+ Gets a text from the cache, rendering it if it is not there yet. The first time a glyph of DIGIT_GLYPHS
+ is needed, all of them are rendered with the same font, size and color.
+
+ @param [in] text Text to be rendered.
+ @param [in] fontFace Text font for the text.
+ @param [in] fontSize Size of the text.
+ @param [in] textColor Color of the text.
+
+ @return The text rendered. It is valid until the cache is cleared.
+*/
+const TextBitmap &Graphics::getText(string const& text, string const& fontFace, double fontSize, Scalar textColor)
+{
+	ostringstream style;
+	std::map<string, TextBitmap>::iterator it;
+	string glyphs = DIGIT_GLYPHS;
+
+	// The style is part of the key, after the text
+	style << '\n' << fontFace << '\n' << fontSize << '\n' << textColor[0] << ',' << textColor[1] << ',' << textColor[2];
+
+	it = textCache.find(text + style.str());
+	if( it != textCache.end() )
+		return it->second;
+
+	// The texts typed by the user are different each time, so the cache is emptied instead of growing forever
+	if( textCache.size() >= TEXT_CACHE_MAX )
+		textCache.clear();
+
+	// A glyph of the digits brings all the others, so the scores and timers never render again
+	if( text.size() == 1 && glyphs.find(text[0]) != string::npos )
+	{
+		for(unsigned int i = 0; i < glyphs.size(); i++)
+			renderText(textCache[glyphs.substr(i, 1) + style.str()], glyphs.substr(i, 1), fontFace, fontSize, textColor);
+
+		return textCache[text + style.str()];
 	}
 
+	TextBitmap &bitmap = textCache[text + style.str()];
+	renderText(bitmap, text, fontFace, fontSize, textColor);
+
+	return bitmap;
+}
+
 
+/**
+ Renders a text with Cairo in a bitmap of the size of the text.
 
+ @param [out] bitmap Text rendered.
+ @param [in] text Text to be rendered.
+ @param [in] fontFace Text font for the text.
+ @param [in] fontSize Size of the text.
+ @param [in] textColor Color of the text.
 
-    cairo_show_text(cairo, text.c_str());
+ @return Nothing.
+*/
+void Graphics::renderText(TextBitmap &bitmap, string const& text, string const& fontFace, double fontSize, Scalar textColor)
+{
+	cairo_text_extents_t extents;
+	cairo_surface_t *surface;
+	cairo_t *cairo;
+
+	// Measures the text in an empty surface
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+	cairo = cairo_create(surface);
+	cairo_select_font_face(cairo, fontFace.c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+	cairo_set_font_size(cairo, fontSize);
+	cairo_text_extents(cairo, text.c_str(), &extents);
+	cairo_destroy(cairo);
+	cairo_surface_destroy(surface);
+
+	bitmap.xBearing = extents.x_bearing;
+	bitmap.yBearing = extents.y_bearing;
+	bitmap.width = extents.width;
+	bitmap.height = extents.height;
+	bitmap.xAdvance = extents.x_advance;
+
+	// The bitmap covers the ink of the text, with a margin
+	bitmap.offsetX = cvFloor(extents.x_bearing) - TEXT_PADDING;
+	bitmap.offsetY = cvFloor(extents.y_bearing) - TEXT_PADDING;
+
+	// Renders the text in a transparent surface
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, cvCeil(extents.width) + 2*TEXT_PADDING + 1, cvCeil(extents.height) + 2*TEXT_PADDING + 1);
+	cairo = cairo_create(surface);
+	cairo_select_font_face(cairo, fontFace.c_str(), CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
+	cairo_set_font_size(cairo, fontSize);
+	cairo_set_source_rgb(cairo, textColor[2], textColor[1], textColor[0]);
+	cairo_move_to(cairo, -bitmap.offsetX, -bitmap.offsetY);
+	cairo_show_text(cairo, text.c_str());
+	cairo_surface_flush(surface);
+
+	// Cairo gives the pixels premultiplied, in BGRA
+	Mat cairoTarget(
+				cairo_image_surface_get_height(surface),
+				cairo_image_surface_get_width(surface),
+				CV_8UC4,
+				cairo_image_surface_get_data(surface),
+				cairo_image_surface_get_stride(surface));
+
+	cvtColor(cairoTarget, bitmap.color, COLOR_BGRA2BGR);
+	extractChannel(cairoTarget, bitmap.alpha, 3);
+
+	cairo_destroy(cairo);
+	cairo_surface_destroy(surface);
+}
 
-    // Copy the data to the output image
-    cv::cvtColor(cairoTarget, frameColor, cv::COLOR_BGRA2BGR);
 
-    cairo_destroy(cairo);
-    cairo_surface_destroy(surface);
+/**
+ Blends a rendered text in an image. If the image is a layer, the alpha of the text is also added to its
+ coverage. Only the part of the text inside the clipping rectangle and the image is drawn.
+
+ @param [out] color Image where the text is blended, in BGR premultiplied by its coverage.
+ @param [out] coverage Coverage of the image, or NULL if the image is opaque (e.g. the RGB frame).
+ @param [in] bitmap Text to be blended.
+ @param [in] originX X-coordinate of the origin of the text, as in cairo_move_to().
+ @param [in] originY Y-coordinate of the origin of the text, as in cairo_move_to().
+ @param [in] clip Rectangle of the image that can be drawn.
+
+ @return Nothing.
+*/
+void Graphics::blendText(cv::Mat &color, cv::Mat *coverage, const TextBitmap &bitmap, double originX, double originY, Rect clip)
+{
+	Rect area(cvRound(originX) + bitmap.offsetX, cvRound(originY) + bitmap.offsetY, bitmap.alpha.cols, bitmap.alpha.rows);
+	Rect visible = area & clip & Rect(0, 0, color.cols, color.rows);
+
+	for (int y = visible.y; y < visible.y + visible.height; y++)
+	{
+		const unsigned char *alpha = bitmap.alpha.ptr<unsigned char>(y - area.y) + (visible.x - area.x);
+		const unsigned char *textColor = bitmap.color.ptr<unsigned char>(y - area.y) + 3 * (visible.x - area.x);
+		unsigned char *pixel = color.ptr<unsigned char>(y) + 3 * visible.x;
+		unsigned char *pixelCoverage = (coverage != NULL) ? coverage->ptr<unsigned char>(y) + visible.x : NULL;
+
+		for (int x = 0; x < visible.width; x++, alpha++, textColor += 3, pixel += 3)
+		{
+			// Same as the OVER operator of Cairo: the color is already multiplied by the alpha
+			if (*alpha == 0)
+				continue;
+
+			pixel[0] = (unsigned char)((pixel[0] * (255 - *alpha) + 127) / 255 + textColor[0]);
+			pixel[1] = (unsigned char)((pixel[1] * (255 - *alpha) + 127) / 255 + textColor[1]);
+			pixel[2] = (unsigned char)((pixel[2] * (255 - *alpha) + 127) / 255 + textColor[2]);
+
+			if (pixelCoverage != NULL)
+				pixelCoverage[x] = (unsigned char)((pixelCoverage[x] * (255 - *alpha) + 127) / 255 + *alpha);
+		}
+	}
+}
+
+
+/**
+ Checks if a text is made only of glyphs of DIGIT_GLYPHS, as the scores and timers are.
+
+ @param [in] text Text to be checked.
+
+ @return True if every character of the text is in DIGIT_GLYPHS, false otherwise.
+*/
+bool Graphics::isDigitText(string const& text)
+{
+	return( text.find_first_not_of(DIGIT_GLYPHS) == string::npos );
 }
 
 
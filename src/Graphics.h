@@ -9,6 +9,9 @@
 #define GRAPHICS_H
 
 #include "cvaux.h" // Include for OpenCV
+#include <map> // Include for the cache of texts
+#include <vector>
+#include "Profiler.h"
 
 //Macros
 #define WIN_SIZE_X	640
@@ -20,12 +23,75 @@
 #define GREEN	Scalar(0, 255, 0)
 #define RED		Scalar(0, 0, 255)
 
+#define TEXT_CACHE_MAX	64 // Maximum number of texts kept in the cache
+#define TEXT_PADDING	2 // Margin around the text in its bitmap, for the antialiasing
+#define DIGIT_GLYPHS	"0123456789:" // Characters of the scores and timers, drawn glyph by glyph
+
 
 using namespace cv;
 
 /** Hold the values and positions of the keys of the keyboard */
 const string qwertyKeyboard[4][10] = {{"Q", "W", "E", "R", "T", "Y", "U", "I", "O", "P"}, {"A", "S", "D", "F", "G", "H", "J", "K", "L", "Ñ"}, {"Z", "X", "C", "V", "B", "N", "M", " ", " ", "delete"}, {"1", "2", "3", "4", "5", "6", "7", "8", "9", "0"}};
 
+/** Image loaded once, with the mask of the pixels that are drawn */
+struct Sprite
+{
+	/* Image in BGR */
+	Mat image;
+	/* Mask of the image: 255 in the pixels of the image, 0 in its black background */
+	Mat mask;
+};
+
+/** Text rendered once by Cairo, with the same extents that Cairo gives for it */
+struct TextBitmap
+{
+	/* Color of the text premultiplied by its alpha, in BGR */
+	Mat color;
+	/* Alpha of the text */
+	Mat alpha;
+	/* X-coordinate of the bitmap, relative to the origin of the text */
+	int offsetX;
+	/* Y-coordinate of the bitmap, relative to the origin of the text */
+	int offsetY;
+	/* Extents of the text, as given by cairo_text_extents() */
+	double xBearing, yBearing, width, height, xAdvance;
+};
+
+/** Images composed once and inserted together in every frame */
+struct OverlayLayer
+{
+	/* Images of the layer, in BGR, premultiplied by the coverage */
+	Mat color;
+	/* Coverage of the layer: 255 in the pixels of the images, 0 where the layer is transparent, and the alpha of the texts in their edges */
+	Mat mask;
+	/* Rectangle that contains all the images of the layer */
+	Rect bounds;
+	/* False if the layer must be composed again */
+	bool valid;
+};
+
+/** Glyph of a text placed in the frame */
+struct PlacedText
+{
+	/* Glyph, or whole text, rendered */
+	const TextBitmap *bitmap;
+	/* X-coordinate of the origin of the glyph, as in cairo_move_to() */
+	double x;
+	/* Y-coordinate of the origin of the glyph, as in cairo_move_to() */
+	double y;
+};
+
+/** Counters of the areas of the frame drawn by the graphics */
+struct FrameDamage
+{
+	/* Number of frames */
+	unsigned long frames;
+	/* Number of rectangles drawn */
+	unsigned long rects;
+	/* Number of pixels drawn */
+	unsigned long long pixels;
+};
+
 /** Hold the value of a image */
 struct ImageInfo
 {
@@ -54,15 +120,14 @@ class Graphics
 		void showGameJoint(Mat &frameColor, float x, float y);
 		void showFruit(Mat &frameColor);
 		void showFruitClock(Mat &frameColor, unsigned long long int time, int fruitDuration);
-		void showBottomBar(Mat &frameColor);
-		void showScore(Mat &frameColor, string successes, string failures);
-		void showTimer(Mat &frameColor, int duration);
+		void showScoreBar(Mat &frameColor, string successes, string failures, int duration);
 		void showUserState(Mat &frameColor, string userState);
 		void showScoreScreen(Mat &frameColor, string successes, string failures);
 		void showPauseScreen(Mat &frameColor);
 
 		// Functions to calculate the intersection with graphics of the game
 		bool intersectionFruit(float x, float y);
+		bool intersectionFruit(float fromX, float fromY, float toX, float toY);
 		bool intersectionNewGameButton(float x, float y);
 		bool intersectionExitButton(float x, float y);
 
@@ -90,8 +155,15 @@ class Graphics
 		/// Auxiliary functions ///
 		///////////////////////////
 		bool intersection(int imageWidth, int imageHeight, float imageCoordX, float imageCoordY, float jointCoordX, float jointCoordY);
-
-		void insertImage(cv::Mat &frameColor, cv::Mat &frameImagen, float coordX, float coordY, int imageSizeX, int imageSizeY);
+		bool intersectionPath(int imageWidth, int imageHeight, float imageCoordX, float imageCoordY, float fromX, float fromY, float toX, float toY);
+
+		void insertImage(cv::Mat &frameColor, const Sprite &sprite, float coordX, float coordY, int imageSizeX, int imageSizeY);
+		void insertImage(OverlayLayer &layer, const Sprite &sprite, float coordX, float coordY, int imageSizeX, int imageSizeY);
+		void invalidateLayers();
+		void beginFrame();
+		void setProfiler(Profiler *profiler);
+		FrameDamage getFrameDamage();
+		FrameDamage getTotalDamage();
 		void showText(string text, int x, int y, cv::Mat &frameColor);
 		void putTextCairo(cv::Mat &targetImage, string const& text, Point2d centerPoint, string const& fontFace, double fontSize, Scalar textColor, bool centered);
 		string itos(int number);
@@ -103,22 +175,40 @@ class Graphics
 
 
 	private:
+		bool loadSprite(Sprite &sprite, string path);
+
+		void composeKeyboard(OverlayLayer &layer);
+		void composeDialog(OverlayLayer &layer);
+		void composeBottomBar(OverlayLayer &layer);
+		void updateScoreBarText(int index, string text, Rect &damage);
+		void recomposeScoreBar(Rect damage);
+		string timerText(int duration);
+		void markDamage(Rect area, Size frameSize);
+		void clearLayer(OverlayLayer &layer, Size size);
+		void applyLayer(cv::Mat &frameColor, const OverlayLayer &layer);
+
+		const TextBitmap &getText(string const& text, string const& fontFace, double fontSize, Scalar textColor);
+		void renderText(TextBitmap &bitmap, string const& text, string const& fontFace, double fontSize, Scalar textColor);
+		Rect layoutText(string const& text, Point2d centerPoint, string const& fontFace, double fontSize, Scalar textColor, bool centered);
+		void blendText(cv::Mat &color, cv::Mat *coverage, const TextBitmap &bitmap, double originX, double originY, Rect clip);
+		bool isDigitText(string const& text);
+
 		// Keys of the keyboard
-		Mat frameA, frameB, frameC, frameD, frameE, frameF, frameG, frameH, frameI, frameJ, frameK, frameL, frameM, frameN, frameNN, frameO, frameP, frameQ, frameR, frameS, frameT, frameU, frameV, frameW, frameX, frameY, frameZ;
-		Mat frame1, frame2, frame3, frame4, frame5, frame6, frame7, frame8, frame9, frame0;
-		Mat frameSpace;
-		Mat frameDelete;
-		Mat frameEnterKey;
-		Mat frameKeyboardBackground;
-		Mat frameYesButton, frameNoButton;
-		Mat frameNewGameButton, frameExitButton; // Buttons of the score screen
-
-		Mat frameApple, frameCherry, frameOrange, frameTomato, frameWatermelon; // Fruit images
-		Mat frameFruit; // Fruit to be shown
-
-		Mat frameGameJoint; // Round marker of joints in the game
-		Mat frameSelectJoint; // Round marker of joints in the keyboard
-		Mat frameBottomBar; // Bottom bar of the game interface
+		Sprite frameA, frameB, frameC, frameD, frameE, frameF, frameG, frameH, frameI, frameJ, frameK, frameL, frameM, frameN, frameNN, frameO, frameP, frameQ, frameR, frameS, frameT, frameU, frameV, frameW, frameX, frameY, frameZ;
+		Sprite frame1, frame2, frame3, frame4, frame5, frame6, frame7, frame8, frame9, frame0;
+		Sprite frameSpace;
+		Sprite frameDelete;
+		Sprite frameEnterKey;
+		Sprite frameKeyboardBackground;
+		Sprite frameYesButton, frameNoButton;
+		Sprite frameNewGameButton, frameExitButton; // Buttons of the score screen
+
+		Sprite frameApple, frameCherry, frameOrange, frameTomato, frameWatermelon; // Fruit images
+		Sprite frameFruit; // Fruit to be shown
+
+		Sprite frameGameJoint; // Round marker of joints in the game
+		Sprite frameSelectJoint; // Round marker of joints in the keyboard
+		Sprite frameBottomBar; // Bottom bar of the game interface
 
 		ImageInfo fruit; // Size and position of the fruit
 		ImageInfo yesButton, noButton; // Size and position of the yes/no buttons
@@ -127,11 +217,27 @@ class Graphics
 		ImageInfo bottomBar;  // Size and position of the bottom bar of the game interface
 		ImageInfo keyboardBackground;
 
+		OverlayLayer keyboardLayer; // Keys, enter key and input background of the keyboard
+		OverlayLayer dialogLayer; // Yes/no buttons and input background of the dialog
+		OverlayLayer bottomBarLayer; // Bottom bar of the game interface, without texts
+		OverlayLayer scoreBarLayer; // Bottom bar of the game interface, with the score and the timer
+		string scoreBarTexts[3]; // Texts of the score bar: successes, failures and timer
+		Rect scoreBarAreas[3]; // Rectangles of the texts in the score bar
+
+		Profiler *profiler; // Profiler where the time of the texts is recorded, or NULL
+		int stageText; // Stage of the profiler for the texts
+
+		FrameDamage frameDamage; // Areas drawn in the current frame
+		FrameDamage totalDamage; // Areas drawn since the graphics were created
+
 		int keySize;
 		int keySeparation; //Separation between x coordinate of a key and the x coordinate of the key beside
 		int keyboardInitialX;
 		int keyboardInitialY;
 		int chosenImage; // Number of fruit chosen
+
+		std::map<string, TextBitmap> textCache; // Texts already rendered, by text, font, size and color
+		std::vector<PlacedText> textLayout; // Glyphs of the text being drawn, kept to avoid allocations
 };
 
 
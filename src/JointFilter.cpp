@@ -0,0 +1,369 @@
+/**
+ @file   JointFilter.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Filter of the coordinates of the joints: smooths the jitter of the tracker and predicts the position
+ 	a few milliseconds ahead, to compensate the latency of the pipeline.
+*/
+
+#include "JointFilter.h"
+
+#include <cmath>
+#include <cfloat> // Include for FLT_MAX
+#include <cstdlib> // Include for strtod() function
+#include <cstring>
+#include <sstream>
+
+using namespace std;
+
+
+/**
+ Gets the smoothing factor of a low-pass filter.
+
+ @param [in] cutoff Cutoff frequency, in Hz.
+ @param [in] dt Time since the previous sample, in seconds.
+
+ @return Weight of the new sample, from 0 to 1.
+*/
+static float smoothingFactor(float cutoff, float dt)
+{
+	float r = 2 * (float)M_PI * cutoff * dt;
+
+	return r / (r + 1);
+}
+
+
+/**
+ Constructor. By default, the joints are not filtered, so they keep the coordinates of the tracker until a
+ filter is chosen with @ref setConfig.
+*/
+JointFilter::JointFilter()
+{
+	config = defaultConfig(FILTER_NONE);
+	reset();
+}
+
+
+/**
+ Destructor.
+*/
+JointFilter::~JointFilter()
+{
+}
+
+
+/**
+ Gets the default parameters of a type of filter. The coordinates are in pixels of the window.
+
+ @param [in] type Type of filter.
+
+ @return The parameters of the filter.
+*/
+JointFilterConfig JointFilter::defaultConfig(JointFilterType type)
+{
+	JointFilterConfig config;
+
+	config.type = type;
+	config.minCutoff = 1.0f;
+	config.beta = 0.01f;
+	config.derivativeCutoff = 1.0f;
+	config.processNoise = 250000.0f; // Acceleration of 500 pixels/second^2
+	config.measurementNoise = 9.0f; // Error of 3 pixels
+	config.leadMs = 0;
+
+	return config;
+}
+
+
+/**
+ Reads the parameters of a filter from a text: 'none', 'oneeuro[:minCutoff[:beta[:leadMs]]]' or
+ 'kalman[:processNoise[:measurementNoise[:leadMs]]]'. The parameters not given keep their default value. The
+ cutoff and the noises must be greater than 0, and the other parameters cannot be negative.
+
+ @param [in] text Text with the type and the parameters.
+ @param [out] config Parameters of the filter.
+
+ @return True if the text is valid, false otherwise.
+*/
+bool JointFilter::parseConfig(string text, JointFilterConfig &config)
+{
+	istringstream stream(text);
+	string field;
+	float *parameters[3];
+	bool positive[3]; // True if the parameter must be greater than 0, false if it can also be 0
+	int parametersNum = 0;
+	char *end;
+	double value;
+
+	getline(stream, field, ':');
+
+	if (field == "none")
+	{
+		config = defaultConfig(FILTER_NONE);
+	}
+	else if (field == "oneeuro")
+	{
+		config = defaultConfig(FILTER_ONE_EURO);
+		parameters[0] = &config.minCutoff;
+		parameters[1] = &config.beta;
+		parameters[2] = &config.leadMs;
+		positive[0] = true;
+		positive[1] = false;
+		positive[2] = false;
+		parametersNum = 3;
+	}
+	else if (field == "kalman")
+	{
+		config = defaultConfig(FILTER_KALMAN);
+		parameters[0] = &config.processNoise;
+		parameters[1] = &config.measurementNoise;
+		parameters[2] = &config.leadMs;
+		positive[0] = true;
+		positive[1] = true;
+		positive[2] = false;
+		parametersNum = 3;
+	}
+	else
+	{
+		return false;
+	}
+
+	for (int i = 0; getline(stream, field, ':'); i++)
+	{
+		if (i >= parametersNum || field.empty())
+			return false;
+
+		// The whole field must be a number. A cutoff of 0, for example, would freeze the joints that stand still
+		value = strtod(field.c_str(), &end);
+		if (*end != '\0' || !(value >= 0 && value <= FLT_MAX) || (positive[i] && value == 0))
+			return false;
+
+		*parameters[i] = (float)value;
+	}
+
+	return true;
+}
+
+
+/**
+ Sets the parameters of the filter. The state of the filter is reset.
+
+ @param [in] config Parameters of the filter.
+
+ @return Nothing.
+*/
+void JointFilter::setConfig(const JointFilterConfig &config)
+{
+	this->config = config;
+	reset();
+}
+
+
+/**
+ Forgets the previous frames, so the next frame is given without changes.
+
+ @return Nothing.
+*/
+void JointFilter::reset()
+{
+	started = false;
+	lastTimestamp = 0;
+	memset(initialized, 0, sizeof(initialized));
+}
+
+
+/**
+ Filters the window coordinates of the joints of all the users of a frame. The X and Y-coordinates of every
+ skeleton are already in contiguous arrays, so they are copied in a single batch, filtered and copied back.
+ The joints that are not available and the users that are not tracked (whose skeletons are cleared) are not
+ changed, and their filter starts again when they are available.
+
+ @param [in,out] skeletons Skeletons of the users. It must have MAX_USERS elements.
+ @param [in] usersNumber Number of users.
+ @param [in] timestamp Timestamp of the frame, in microseconds.
+
+ @return Nothing.
+*/
+void JointFilter::apply(UserSkeleton *skeletons, int usersNumber, unsigned long long timestamp)
+{
+	float dt = 0;
+	unsigned int mask;
+	float *userValues;
+	unsigned char *userValid;
+
+	if (config.type == FILTER_NONE)
+		return;
+
+	// If the frames are not consecutive (a recorded file starts again, or many frames were lost), the filter starts again
+	if (started && timestamp > lastTimestamp && timestamp - lastTimestamp <= FILTER_MAX_GAP_US)
+		dt = (timestamp - lastTimestamp) / 1000000.0f;
+	else
+		reset();
+
+	started = true;
+	lastTimestamp = timestamp;
+
+	// Channels 'user * SKELETON_JOINTS * 2 + joint' are the X-coordinates, and the next SKELETON_JOINTS are the Y-coordinates
+	for (int user = 0; user < MAX_USERS; user++)
+	{
+		userValues = values + user * SKELETON_JOINTS * 2;
+		userValid = valid + user * SKELETON_JOINTS * 2;
+		mask = (user < usersNumber) ? skeletons[user].valid : 0;
+
+		memcpy(userValues, skeletons[user].windowX, sizeof(skeletons[user].windowX));
+		memcpy(userValues + SKELETON_JOINTS, skeletons[user].windowY, sizeof(skeletons[user].windowY));
+
+		for (int j = 0; j < SKELETON_JOINTS; j++)
+			userValid[j] = userValid[SKELETON_JOINTS + j] = (mask >> j) & 1;
+	}
+
+	filter(values, valid, FILTER_CHANNELS, dt);
+
+	// Copies the filtered coordinates back. The joints not available were not changed by the filter
+	for (int user = 0; user < usersNumber && user < MAX_USERS; user++)
+	{
+		userValues = values + user * SKELETON_JOINTS * 2;
+
+		memcpy(skeletons[user].windowX, userValues, sizeof(skeletons[user].windowX));
+		memcpy(skeletons[user].windowY, userValues + SKELETON_JOINTS, sizeof(skeletons[user].windowY));
+	}
+}
+
+
+/**
+ Filters a batch of channels, all of them sampled at the same moment. The channels that are not valid
+ are reset. The channels without a previous value, and all of them if 'dt' is 0, are only stored.
+
+ @param [in,out] values Value of every channel. The filtered values are written in the same array.
+ @param [in] valid 1 if the value of the channel is available, 0 otherwise.
+ @param [in] channels Number of channels. It cannot be greater than FILTER_CHANNELS.
+ @param [in] dt Time since the previous sample, in seconds.
+
+ @return Nothing.
+*/
+void JointFilter::filter(float *values, const unsigned char *valid, int channels, float dt)
+{
+	if (channels > FILTER_CHANNELS)
+		channels = FILTER_CHANNELS;
+
+	if (dt <= 0)
+	{
+		for (int c = 0; c < channels; c++)
+			initialized[c] = 0;
+	}
+
+	if (config.type == FILTER_ONE_EURO)
+		filterOneEuro(values, valid, channels, dt);
+	else if (config.type == FILTER_KALMAN)
+		filterKalman(values, valid, channels, dt);
+}
+
+
+/**
+ One-Euro filter: a low-pass filter whose cutoff frequency grows with the speed of the joint, so a still
+ joint is smoothed a lot and a fast one has little lag.
+
+ @param [in,out] values Value of every channel.
+ @param [in] valid 1 if the value of the channel is available, 0 otherwise.
+ @param [in] channels Number of channels.
+ @param [in] dt Time since the previous sample, in seconds.
+
+ @return Nothing.
+*/
+void JointFilter::filterOneEuro(float *values, const unsigned char *valid, int channels, float dt)
+{
+	float derivativeFactor = smoothingFactor(config.derivativeCutoff, dt);
+	float lead = config.leadMs / 1000;
+	float speed, cutoff;
+
+	for (int c = 0; c < channels; c++)
+	{
+		if (!valid[c])
+		{
+			initialized[c] = 0;
+			continue;
+		}
+
+		if (!initialized[c])
+		{
+			position[c] = values[c];
+			velocity[c] = 0;
+			initialized[c] = 1;
+			continue;
+		}
+
+		// Smooths the speed, and uses it to choose the cutoff frequency of the position
+		speed = (values[c] - position[c]) / dt;
+		velocity[c] += derivativeFactor * (speed - velocity[c]);
+		cutoff = config.minCutoff + config.beta * fabsf(velocity[c]);
+
+		position[c] += smoothingFactor(cutoff, dt) * (values[c] - position[c]);
+
+		values[c] = position[c] + velocity[c] * lead;
+	}
+}
+
+
+/**
+ Kalman filter with a model of constant speed. The position and the speed of every channel are estimated
+ from the positions given by the tracker, weighting the model and the tracker by their noise.
+
+ @param [in,out] values Value of every channel.
+ @param [in] valid 1 if the value of the channel is available, 0 otherwise.
+ @param [in] channels Number of channels.
+ @param [in] dt Time since the previous sample, in seconds.
+
+ @return Nothing.
+*/
+void JointFilter::filterKalman(float *values, const unsigned char *valid, int channels, float dt)
+{
+	float lead = config.leadMs / 1000;
+	float r = config.measurementNoise;
+	// Noise added by an unknown acceleration during 'dt'
+	float q00 = config.processNoise * dt * dt * dt * dt / 4;
+	float q01 = config.processNoise * dt * dt * dt / 2;
+	float q11 = config.processNoise * dt * dt;
+	float p00, p01, p11;
+	float s, k0, k1, error;
+
+	for (int c = 0; c < channels; c++)
+	{
+		if (!valid[c])
+		{
+			initialized[c] = 0;
+			continue;
+		}
+
+		// The speed of a new joint is unknown, so its error is large
+		if (!initialized[c])
+		{
+			position[c] = values[c];
+			velocity[c] = 0;
+			covariance00[c] = r;
+			covariance01[c] = 0;
+			covariance11[c] = 1000000.0f;
+			initialized[c] = 1;
+			continue;
+		}
+
+		// Predicts the position with the speed
+		position[c] += velocity[c] * dt;
+		p00 = covariance00[c] + dt * (2 * covariance01[c] + dt * covariance11[c]) + q00;
+		p01 = covariance01[c] + dt * covariance11[c] + q01;
+		p11 = covariance11[c] + q11;
+
+		// Corrects the prediction with the position given by the tracker
+		s = p00 + r;
+		k0 = p00 / s;
+		k1 = p01 / s;
+		error = values[c] - position[c];
+
+		position[c] += k0 * error;
+		velocity[c] += k1 * error;
+		covariance00[c] = (1 - k0) * p00;
+		covariance01[c] = (1 - k0) * p01;
+		covariance11[c] = p11 - k1 * p01;
+
+		values[c] = position[c] + velocity[c] * lead;
+	}
+}
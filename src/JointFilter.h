@@ -0,0 +1,81 @@
+/**
+ @file   JointFilter.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Filter of the coordinates of the joints: smooths the jitter of the tracker and predicts the position
+ 	a few milliseconds ahead, to compensate the latency of the pipeline.
+*/
+
+#ifndef JOINTFILTER_H
+#define JOINTFILTER_H
+
+#include <string>
+
+#include "FrameSource.h"
+
+//Macros
+#define FILTER_CHANNELS		(MAX_USERS * SKELETON_JOINTS * 2) // One channel for each coordinate of each joint of each user
+#define FILTER_MAX_GAP_US	500000 // Longest time between two frames. After a longer gap, the filter starts again
+
+
+using namespace std;
+
+/** Types of filter */
+enum JointFilterType {FILTER_NONE, FILTER_ONE_EURO, FILTER_KALMAN};
+
+/** Parameters of the filter */
+struct JointFilterConfig
+{
+	/* Type of filter */
+	JointFilterType type;
+	/* One-Euro: cutoff frequency of a still joint, in Hz. Lower values smooth more */
+	float minCutoff;
+	/* One-Euro: increase of the cutoff frequency with the speed, in Hz per pixel/second. Higher values lag less */
+	float beta;
+	/* One-Euro: cutoff frequency used to smooth the speed, in Hz */
+	float derivativeCutoff;
+	/* Kalman: variance of the acceleration of the joints, in (pixels/second^2)^2. Higher values lag less */
+	float processNoise;
+	/* Kalman: variance of the error of the tracker, in pixels^2. Higher values smooth more */
+	float measurementNoise;
+	/* Time the position is predicted ahead, in milliseconds. 0 gives the filtered position */
+	float leadMs;
+};
+
+
+class JointFilter
+{
+	public:
+		JointFilter();
+		~JointFilter();
+
+		static JointFilterConfig defaultConfig(JointFilterType type);
+		static bool parseConfig(string text, JointFilterConfig &config);
+
+		void setConfig(const JointFilterConfig &config);
+		void reset();
+		void apply(UserSkeleton *skeletons, int usersNumber, unsigned long long timestamp);
+		void filter(float *values, const unsigned char *valid, int channels, float dt);
+
+	private:
+		void filterOneEuro(float *values, const unsigned char *valid, int channels, float dt);
+		void filterKalman(float *values, const unsigned char *valid, int channels, float dt);
+
+		JointFilterConfig config;
+		unsigned long long lastTimestamp; /** Timestamp of the last frame filtered, in microseconds */
+		bool started; /** False until the first frame is filtered */
+
+		// Contiguous arrays with the coordinates of a frame, so all the channels are filtered in a single loop
+		float values[FILTER_CHANNELS]; /** Coordinates of all the joints of all the users */
+		unsigned char valid[FILTER_CHANNELS]; /** 1 if the coordinate is available, 0 otherwise */
+
+		// State of every channel
+		unsigned char initialized[FILTER_CHANNELS]; /** 1 if the channel has a previous value */
+		float position[FILTER_CHANNELS]; /** Filtered position */
+		float velocity[FILTER_CHANNELS]; /** Filtered speed, in pixels/second */
+		float covariance00[FILTER_CHANNELS]; /** Kalman: covariance of the error of the position */
+		float covariance01[FILTER_CHANNELS]; /** Kalman: covariance between the errors of the position and the speed */
+		float covariance11[FILTER_CHANNELS]; /** Kalman: covariance of the error of the speed */
+};
+
+#endif
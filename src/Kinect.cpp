@@ -20,6 +20,17 @@ using namespace cv;
 Kinect::Kinect()
 {
 	usersNumber = 0;
+
+	snapshot.usersNumber = 0;
+	snapshot.timestamp = 0;
+	snapshot.frameIndex = -1;
+
+	// The projection is measured with the first depth frame
+	projectionResX = 0;
+	projectionResY = 0;
+
+	for (int i = 0; i < MAX_USERS; i++)
+		clearSkeleton(snapshot.skeletons[i]);
 }
 
 /**
@@ -295,32 +306,51 @@ void Kinect::stopRecordStream()
 
 
 /**
- Reads a frame.
+ Reads a frame and copies it in a new image. The RGB frame is converted to BGR and the depth frame to 8 bits.
+
+ @param [out] frame Image where the frame is stored.
+ @param [in] camMode Stream to be read.
 
  @return If no frame can be read or the frame read is not valid returns false, otherwise returns true.
 */
 bool Kinect::readFrame(cv::Mat &frame, CameraMode camMode)
 {
-	VideoFrameRef irf;
-	int hIr, wIr;
+	KinectFrame kinectFrame;
+
+	if ( !readFrame(kinectFrame, camMode) )
+		return false;
+
+	// The conversion reads the OpenNI buffer directly, so the frame is copied only once
+	if (camMode == NI_SENSOR_COLOR)
+		cvtColor(kinectFrame.image, frame, CV_RGB2BGR);
+	else
+		kinectFrame.image.convertTo(frame, CV_8U);
 
-	VideoFrameRef colorf; 
-	int hColor, wColor;
+	return true;
+}
+
+
+/**
+ Reads a frame without copying it. The image of the frame points at the buffer of OpenNI, so any colour
+ or depth conversion must be done by the caller, in its own pass over the pixels.
+
+ @param [out] frame Frame where the header of the image is stored. The previous frame is released.
+ @param [in] camMode Stream to be read.
 
+ @return If no frame can be read or the frame read is not valid returns false, otherwise returns true.
+*/
+bool Kinect::readFrame(KinectFrame &frame, CameraMode camMode)
+{
+	frame.release();
 
 	switch (camMode)
 	{
 		case (NI_SENSOR_DEPTH):
 
-			rc = depth.readFrame(&irf);
-			if (irf.isValid())
+			rc = depth.readFrame(&frame.frameRef);
+			if (frame.frameRef.isValid())
 			{
-				const uint16_t* imgBufIr = (const uint16_t*)irf.getData();
-				hIr = irf.getHeight();
-        		wIr = irf.getWidth();
-        		frame.create(hIr, wIr, CV_16U);
-        		memcpy(frame.data, imgBufIr, hIr * wIr * sizeof(uint16_t));
-        		frame.convertTo(frame, CV_8U);
+				frame.image = cv::Mat(frame.frameRef.getHeight(), frame.frameRef.getWidth(), CV_16U, (void*)frame.frameRef.getData(), frame.frameRef.getStrideInBytes());
 				return true;
 			}
 			else
@@ -331,16 +361,11 @@ bool Kinect::readFrame(cv::Mat &frame, CameraMode camMode)
 
 		case (NI_SENSOR_COLOR):
 
-			rc = color.readFrame(&colorf);
-			if(colorf.isValid())
+			rc = color.readFrame(&frame.frameRef);
+			if (frame.frameRef.isValid())
 			{
-				const openni::RGB888Pixel* imgBufColor = (const openni::RGB888Pixel*)colorf.getData();
-				hColor = colorf.getHeight();
-        		wColor = colorf.getWidth();
-        		frame.create(hColor, wColor, CV_8UC3);
-        		memcpy(frame.data, imgBufColor,  3 * hColor * wColor * sizeof(uint8_t));
-        		cvtColor(frame, frame, CV_BGR2RGB);
-        		return true;
+				frame.image = cv::Mat(frame.frameRef.getHeight(), frame.frameRef.getWidth(), CV_8UC3, (void*)frame.frameRef.getData(), frame.frameRef.getStrideInBytes());
+				return true;
 			}
 			else
 			{
@@ -355,6 +380,43 @@ bool Kinect::readFrame(cv::Mat &frame, CameraMode camMode)
 }
 
 
+/**
+ Configures the playback of a recorded *.oni file. It only works if the device opened is a file.
+
+ @param [in] speed Speed of the playback. 1.0 plays the file in real time, 2.0 twice as fast, and so on.
+ @param [in] repeat If true, the file is played again from the beginning when it ends.
+
+ @return True if the playback was configured, false if the device is not a file or the configuration failed.
+*/
+bool Kinect::setPlayback(float speed, bool repeat)
+{
+	openni::PlaybackControl *playback = device.getPlaybackControl();
+
+	// Only the recorded files have a playback control
+	if (playback == NULL)
+	{
+		cout << "ERROR: The device is not a recorded file." << endl;
+		return false;
+	}
+
+	rc = playback->setSpeed(speed);
+	if (rc != openni::STATUS_OK)
+	{
+		cout << "ERROR: Couldn't set the playback speed: " << endl << openni::OpenNI::getExtendedError() << endl;
+		return false;
+	}
+
+	rc = playback->setRepeatEnabled(repeat);
+	if (rc != openni::STATUS_OK)
+	{
+		cout << "ERROR: Couldn't set the playback repetition: " << endl << openni::OpenNI::getExtendedError() << endl;
+		return false;
+	}
+
+	return true;
+}
+
+
 /////////////////////////////////////////////////////////////////////
 /////////////// NITE FUNCTIONS //////////////////////////////////////
 /////////////////////////////////////////////////////////////////////
@@ -380,15 +442,25 @@ bool Kinect::startUserTracking()
 }
 
 /**
- Gets the next snapshot of the skeleton tracking algorithm.
+ Gets the next snapshot of the skeleton tracking algorithm. The tracker frame is read only once per frame,
+ and all the stages of the frame (chroma, users management...) use the same snapshot.
 
  @return True if the frame was readed, false if it failed.
 */
 bool Kinect::readTrackerFrame()
 {
-	niteRc = userTracker.readFrame(&userTrackerFrame);
+	niteRc = userTracker.readFrame(&snapshot.userTrackerFrame);
 	if (niteRc == nite::STATUS_OK)
 	{
+		const nite::UserMap& userMap = snapshot.userTrackerFrame.getUserMap();
+
+		// Keeps the depth frame and the user map of this tracker frame
+		snapshot.depthFrame = snapshot.userTrackerFrame.getDepthFrame();
+		snapshot.userMap = cv::Mat(userMap.getHeight(), userMap.getWidth(), CV_16U, (void*)userMap.getPixels(), userMap.getStride());
+
+		snapshot.timestamp = snapshot.userTrackerFrame.getTimestamp();
+		snapshot.frameIndex = snapshot.userTrackerFrame.getFrameIndex();
+
 		return true;
 	}
 	else
@@ -398,6 +470,52 @@ bool Kinect::readTrackerFrame()
 }
 
 
+/**
+ Updates the projection of the real world coordinates to the window when the video mode of the depth frame
+ changes. The centre and the focal lengths are measured by converting two points with NiTE, so the cached
+ projection gives the same coordinates as the tracker, and they are scaled from the depth frame to the window.
+
+ @return True if the projection is valid, false otherwise.
+*/
+bool Kinect::updateProjection()
+{
+	float centreX, centreY, pointX, pointY;
+
+	// Gets the resolution of the frame
+	int g_nXRes = snapshot.depthFrame.getVideoMode().getResolutionX();
+	int g_nYRes = snapshot.depthFrame.getVideoMode().getResolutionY();
+
+	// The projection only changes with the video mode
+	if (g_nXRes == projectionResX && g_nYRes == projectionResY)
+		return true;
+
+	if (g_nXRes <= 0 || g_nYRes <= 0)
+		return false;
+
+	// A point in the axis of the camera gives the centre, and a point at 45 degrees gives the focal lengths
+	niteRc = userTracker.convertJointCoordinatesToDepth(0, 0, 1000, &centreX, &centreY);
+	if (niteRc == nite::STATUS_OK)
+		niteRc = userTracker.convertJointCoordinatesToDepth(1000, 1000, 1000, &pointX, &pointY);
+
+	if (niteRc != nite::STATUS_OK)
+	{
+		cout << "ERROR: Coordinates convertion failed." << endl;
+		return false;
+	}
+
+	// Adjusts the projection to the window size
+	projection.offsetX = centreX * WIN_SIZE_X / (float)g_nXRes;
+	projection.offsetY = centreY * WIN_SIZE_Y / (float)g_nYRes;
+	projection.scaleX = (pointX - centreX) * WIN_SIZE_X / (float)g_nXRes;
+	projection.scaleY = (centreY - pointY) * WIN_SIZE_Y / (float)g_nYRes;
+
+	projectionResX = g_nXRes;
+	projectionResY = g_nYRes;
+
+	return true;
+}
+
+
 /**
  Gets the coordinates of a given joint and stores it in a User structure
 
@@ -412,26 +530,14 @@ int Kinect::getJointCoordinates(const nite::UserData& user, nite::JointType join
 {
 	// Gets the requested joint
 	const nite::SkeletonJoint& joint = user.getSkeleton().getJoint(jointType);
+	const nite::Point3f& position = joint.getPosition();
 
 	// If there is enough confidence in the coordinates
-	if (joint.getPositionConfidence() > 0.5)
+	if (joint.getPositionConfidence() > SKELETON_MIN_CONFIDENCE && position.z > 0 && updateProjection())
 	{
-		// Gets the depth frame
-		depthFrame = userTrackerFrame.getDepthFrame();
-
-		// Converts the coordinates from the 'Real World' system to the 'Projective' system
-		niteRc = userTracker.convertJointCoordinatesToDepth(joint.getPosition().x, joint.getPosition().y, joint.getPosition().z, &coordX, &coordY);
-
-		if(niteRc != nite::STATUS_OK)
-			cout << "ERROR: Coordinates convertion failed." << endl;
-
-		// Gets the resolution of the frame
-		int g_nXRes = depthFrame.getVideoMode().getResolutionX();
-		int g_nYRes = depthFrame.getVideoMode().getResolutionY();
-
-		// Adjusts the coordinates to the window size
-		coordX *= WIN_SIZE_X/(float)g_nXRes;
-		coordY *= WIN_SIZE_Y/(float)g_nYRes;
+		// Converts the coordinates from the 'Real World' system to the window
+		coordX = projection.offsetX + projection.scaleX * position.x / position.z;
+		coordY = projection.offsetY - projection.scaleY * position.y / position.z;
 
 		return 1;
 	}
@@ -443,21 +549,52 @@ int Kinect::getJointCoordinates(const nite::UserData& user, nite::JointType join
 
 
 /**
- Detects all the users and stores them.
+ Gets all the joints of the skeleton of a user: their position in the real world and their confidence. The
+ joints with little confidence are not available. Their position in the window is computed later, for all
+ the users at once, by @ref projectSkeletons.
+
+ @param [in] user User skeleton data.
+ @param [out] skeleton Skeleton where the joints are stored.
 
  @return Nothing.
 */
-void Kinect::usersManagement()
+void Kinect::readSkeleton(const nite::UserData& user, UserSkeleton &skeleton)
 {
-	float jointCoordX = 0;
-	float jointCoordY = 0;
+	const nite::Skeleton& niteSkeleton = user.getSkeleton();
+
+	skeleton.valid = 0;
+
+	for (int j = 0; j < SKELETON_JOINTS; j++)
+	{
+		// The joints of the skeleton are in the same order as the joints of NiTE
+		const nite::SkeletonJoint& joint = niteSkeleton.getJoint((nite::JointType)j);
+		const nite::Point3f& position = joint.getPosition();
+
+		skeleton.x[j] = position.x;
+		skeleton.y[j] = position.y;
+		skeleton.z[j] = position.z;
+		skeleton.confidence[j] = joint.getPositionConfidence();
+
+		// If there is enough confidence in the coordinates, the joint is available
+		if (skeleton.confidence[j] > SKELETON_MIN_CONFIDENCE && position.z > 0)
+			skeleton.valid |= 1u << j;
+	}
+}
 
 
+/**
+ Detects all the users of the current snapshot and stores them.
+
+ @return Nothing.
+*/
+void Kinect::usersManagement()
+{
 	// Gets a list with the data of every user
-	const nite::Array<nite::UserData>& users = userTrackerFrame.getUsers();
+	const nite::Array<nite::UserData>& users = snapshot.userTrackerFrame.getUsers();
 
 	// Gets the number of users detected
 	usersNumber = users.getSize();
+	snapshot.usersNumber = usersNumber;
 
 	// For every user detected
 	for (int i = 0; i < users.getSize(); ++i)
@@ -472,165 +609,28 @@ void Kinect::usersManagement()
 			userTracker.startSkeletonTracking( user.getId() );
 
 			// Set that user as 'found'
-			usersInfo[i].userState = USER_FOUND;
+			snapshot.usersInfo[i].userState = USER_FOUND;
 		}
 		// If the user is not new and their skeleton is being tracked
 		else if (user.getSkeleton().getState() == nite::SKELETON_TRACKED)
 		{
-			// If the joint of the left hand is detected (right hand in NiTE is, in fact, the left hand)
-			if ( getJointCoordinates(user, nite::JOINT_RIGHT_HAND, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].leftHandX = jointCoordX;
-				usersInfo[i].leftHandY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].leftHandX = -1;
-				usersInfo[i].leftHandY = -1;
-			}
-
-			// If the joint of the right hand is detected (left hand in NiTE is, in fact, the right hand)
-			if ( getJointCoordinates(user, nite::JOINT_LEFT_HAND, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].rightHandX = jointCoordX;
-				usersInfo[i].rightHandY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].rightHandX = -1;
-				usersInfo[i].rightHandY = -1;
-			}
-
-			// If the joint of the head is detected
-			if ( getJointCoordinates(user, nite::JOINT_HEAD, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].headX = jointCoordX;
-				usersInfo[i].headY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].headX = -1;
-				usersInfo[i].headY = -1;
-			}
-
-			// If the joint of the neck is detected
-			if ( getJointCoordinates(user, nite::JOINT_NECK, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].neckX = jointCoordX;
-				usersInfo[i].neckY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].neckX = -1;
-				usersInfo[i].neckY = -1;
-			}
-
-			// If the joint of the left shoulder is detected
-			if ( getJointCoordinates(user, nite::JOINT_LEFT_SHOULDER, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].leftShoulderX = jointCoordX;
-				usersInfo[i].leftShoulderY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].leftShoulderX = -1;
-				usersInfo[i].leftShoulderY = -1;
-			}
-
-			// If the joint of the right shoulder is detected
-			if ( getJointCoordinates(user, nite::JOINT_RIGHT_SHOULDER, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].rightShoulderX = jointCoordX;
-				usersInfo[i].rightShoulderY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].rightShoulderX = -1;
-				usersInfo[i].rightShoulderY = -1;
-			}
-
-			// If the joint of the left elbow is detected
-			if ( getJointCoordinates(user, nite::JOINT_LEFT_ELBOW, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].leftElbowX = jointCoordX;
-				usersInfo[i].leftElbowY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].leftElbowX = -1;
-				usersInfo[i].leftElbowY = -1;
-			}
-
-			// If the joint of the right elbow is detected
-			if ( getJointCoordinates(user, nite::JOINT_RIGHT_ELBOW, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].rightElbowX = jointCoordX;
-				usersInfo[i].rightElbowY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].rightElbowX = -1;
-				usersInfo[i].rightElbowY = -1;
-			}
-
-			// If the left joint of the hip is detected
-			if ( getJointCoordinates(user, nite::JOINT_LEFT_HIP, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].leftHipX = jointCoordX;
-				usersInfo[i].leftHipY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].leftHipX = -1;
-				usersInfo[i].leftHipY = -1;
-			}
-
-			// If the right joint of hip is detected
-			if ( getJointCoordinates(user, nite::JOINT_RIGHT_HIP, jointCoordX, jointCoordY) )
-			{
-				// Saves the coordinates of the joint
-				usersInfo[i].rightHipX = jointCoordX;
-				usersInfo[i].rightHipY = jointCoordY;
-			}
-			else
-			{
-				// Sets the coordinates as -1 to indicate they are not available
-				usersInfo[i].rightHipX = -1;
-				usersInfo[i].rightHipY = -1;
-			}
+			// Stores all the joints of the skeleton
+			readSkeleton(user, snapshot.skeletons[i]);
 
 			// Sets the state of the user as 'tracking'
-			usersInfo[i].userState = TRACKING;
+			snapshot.usersInfo[i].userState = TRACKING;
 		}
 		// If the user is not new and their skeleton is being calibrated
 		else if (user.getSkeleton().getState() == nite::SKELETON_CALIBRATING)
 		{
 			// Sets the state of the user as 'calibrating'
-			usersInfo[i].userState = CALIBRATING;
+			snapshot.usersInfo[i].userState = CALIBRATING;
 		}
 		// If the user is not new and their skeleton is not detected
 		else if (user.getSkeleton().getState() == nite::SKELETON_NONE)
 		{
 			// Sets the state of the user as 'stopped'
-			usersInfo[i].userState = STOPPED;
+			snapshot.usersInfo[i].userState = STOPPED;
 
 			// Tries to track the skeleton of the user again
 			userTracker.startSkeletonTracking(user.getId());
@@ -640,9 +640,55 @@ void Kinect::usersManagement()
 	// If no user was detected
 	if (users.getSize() == 0)
 	{
-		usersInfo[0].userState = USER_NOT_FOUND;
-		usersInfo[1].userState = USER_NOT_FOUND; // ¿? por qué solo para los dos primeros usuarios? -> cambiar
+		snapshot.usersInfo[0].userState = USER_NOT_FOUND;
+		snapshot.usersInfo[1].userState = USER_NOT_FOUND; // ¿? por qué solo para los dos primeros usuarios? -> cambiar
+	}
+
+	// The skeletons of the users not tracked in this frame are not available
+	for (int i = 0; i < MAX_USERS; i++)
+	{
+		if (i >= usersNumber || snapshot.usersInfo[i].userState != TRACKING)
+			clearSkeleton(snapshot.skeletons[i]);
+	}
+
+	// Projects the joints of all the users to the window in a single batch
+	if ( updateProjection() )
+	{
+		projectSkeletons(snapshot.skeletons, (usersNumber < MAX_USERS) ? usersNumber : MAX_USERS, projection);
 	}
+	else
+	{
+		for (int i = 0; i < MAX_USERS; i++)
+			clearSkeleton(snapshot.skeletons[i]);
+	}
+
+	// Smooths the jitter of the joints of all the users, and predicts them if the filter is configured to
+	jointFilter.apply(snapshot.skeletons, usersNumber, snapshot.timestamp);
+
+	// Updates the coordinates of the users being tracked from their skeletons
+	for (int i = 0; i < usersNumber && i < MAX_USERS; i++)
+	{
+		if (snapshot.usersInfo[i].userState == TRACKING)
+			skeletonToUserInfo(snapshot.skeletons[i], snapshot.usersInfo[i]);
+	}
+
+	// Keeps the public copy of the users up to date
+	memcpy(usersInfo, snapshot.usersInfo, sizeof(usersInfo));
+	memcpy(skeletons, snapshot.skeletons, sizeof(skeletons));
+}
+
+
+/**
+ Sets the filter applied to the coordinates of the joints by @ref usersManagement. It must not be called
+ while another thread is reading frames.
+
+ @param [in] config Parameters of the filter.
+
+ @return Nothing.
+*/
+void Kinect::setJointFilter(const JointFilterConfig &config)
+{
+	jointFilter.setConfig(config);
 }
 
 
@@ -660,37 +706,34 @@ void Kinect::usersManagement()
 */
 void Kinect::insertChroma(cv::Mat &frameColor, cv::Mat frameImageLoaded)
 {
-	Vec3b color;
+	// The background image is only scaled the first time it is used
+	chroma.setBackground(frameImageLoaded);
 
-	// Specifies a size equal to screen size
-	Size size(WIN_SIZE_X, WIN_SIZE_Y);
+	// Uses the user map of the current snapshot, so the tracker is not read again
+	if ( !snapshot.userMap.empty() )
+	{
+		// Draws the background image in every pixel where there is no user
+		chroma.apply(frameColor, (const unsigned short*)snapshot.userMap.data, snapshot.userMap.cols, snapshot.userMap.rows, (int)snapshot.userMap.step);
+	}
+}
 
-	// Resizes background image in a new frame
-	Mat frameChroma;
-	resize(frameImageLoaded, frameChroma, size);
 
-	
-	if ( userTracker.readFrame( &userTrackerFrame ) == nite::STATUS_OK )
-	{
-		const nite::UserMap& userMap = userTrackerFrame.getUserMap();
-		const nite::UserId* mapaUsuario = userMap.getPixels();
+/**
+ Makes the final RGB frame in a single pass: converts the image of the sensor to BGR, overwrites the points
+ where there is not any user with the background image, and flips the frame so it looks like a mirror.
 
-		for (int y = 0; y < userMap.getHeight(); y++)
-		{
-			for (int x = 0; x < userMap.getWidth(); x++)
-			{
-				unsigned int uIdx = x + userMap.getWidth() * y;
-			
-				// If in that pixel there is no user
-				if (mapaUsuario[uIdx] == 0)
-				{
-					color = frameChroma.at<Vec3b>(cv::Point(x, y));
-					// Draws the pixel with the color of the background image
-					circle(frameColor, cv::Point(x, y), 1, cv::Scalar(color[0],color[1],color[2]), -1);
-				}
-			}
-		}
-	}
+ @param [in] sensorColor Image of the RGB sensor, in RGB, as given by @ref readFrame.
+ @param [out] frameColor Final frame, in BGR and mirrored.
+ @param [in] frameImageLoaded Image to show in the background.
+
+ @return True if the frame was made, false if the user map does not cover the image of the sensor.
+*/
+bool Kinect::insertChromaMirrored(const cv::Mat &sensorColor, cv::Mat &frameColor, cv::Mat frameImageLoaded)
+{
+	// The background image is only scaled the first time it is used
+	chroma.setBackground(frameImageLoaded);
+
+	return chroma.applyMirrored(sensorColor, true, (const unsigned short*)snapshot.userMap.data, snapshot.userMap.cols, snapshot.userMap.rows, (int)snapshot.userMap.step, frameColor);
 }
 
 
@@ -703,3 +746,134 @@ int Kinect::getUsersNumber()
 {
 	return usersNumber;
 }
+
+
+/**
+ Reads the next frame of the sensor, or of the recorded file: the tracker frame, the users in it and the
+ RGB frame. The RGB frame is converted to BGR and the user map is copied, so the frame does not depend on
+ the buffers of OpenNI and NiTE.
+
+ @param [out] frame Frame where the data is copied.
+
+ @return True if the frame was read, false otherwise.
+*/
+bool Kinect::readSnapshot(SourceFrame &frame)
+{
+	// Gets the next snapshot of the skeleton tracking algorithm
+	if ( !readTrackerFrame() )
+		return false;
+
+	// Detects the users and stores the coordinates of the joints
+	usersManagement();
+
+	// Reads a frame from the RGB camera without copying it
+	if ( !readFrame(colorFrame, NI_SENSOR_COLOR) )
+		return false;
+
+	// Converts the frame to BGR. The buffers of the frame are only allocated the first time
+	cvtColor(colorFrame.image, frame.frameColor, CV_RGB2BGR);
+	colorFrame.release();
+
+	// Copies the data of the tracker
+	snapshot.userMap.copyTo(frame.userMap);
+	memcpy(frame.usersInfo, snapshot.usersInfo, sizeof(frame.usersInfo));
+	memcpy(frame.skeletons, snapshot.skeletons, sizeof(frame.skeletons));
+	frame.usersNumber = snapshot.usersNumber;
+	frame.timestamp = snapshot.timestamp;
+	frame.frameIndex = snapshot.frameIndex;
+
+	return true;
+}
+
+
+/**
+ Reads the next frame of the sensor, or of the recorded file, without converting its RGB image. The image
+ is a header over the buffer of OpenNI, which is kept until the next read.
+
+ @param [out] frame Frame where the user map and the joints are copied. Its RGB image is not modified.
+ @param [out] sensorColor Image of the RGB camera, in RGB.
+ @param [out] isRgb Always true.
+
+ @return True if the frame was read, false otherwise.
+*/
+bool Kinect::readRawSnapshot(SourceFrame &frame, cv::Mat &sensorColor, bool &isRgb)
+{
+	// Gets the next snapshot of the skeleton tracking algorithm
+	if ( !readTrackerFrame() )
+		return false;
+
+	// Detects the users and stores the coordinates of the joints
+	usersManagement();
+
+	// Reads a frame from the RGB camera without copying it. The buffer is released by the next read
+	if ( !readFrame(colorFrame, NI_SENSOR_COLOR) )
+		return false;
+
+	sensorColor = colorFrame.image;
+	isRgb = true;
+
+	// Copies the data of the tracker
+	snapshot.userMap.copyTo(frame.userMap);
+	memcpy(frame.usersInfo, snapshot.usersInfo, sizeof(frame.usersInfo));
+	memcpy(frame.skeletons, snapshot.skeletons, sizeof(frame.skeletons));
+	frame.usersNumber = snapshot.usersNumber;
+	frame.timestamp = snapshot.timestamp;
+	frame.frameIndex = snapshot.frameIndex;
+
+	return true;
+}
+
+
+/**
+ Gets the data of the last tracker frame.
+
+ @return The snapshot of the last frame read with @ref readTrackerFrame.
+*/
+const FrameSnapshot &Kinect::getSnapshot() const
+{
+	return snapshot;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+/////////////// KINECT FRAME ////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////
+
+/**
+ Constructor. The frame is empty until it is read with @ref Kinect::readFrame.
+*/
+KinectFrame::KinectFrame()
+{
+}
+
+
+/**
+ Destructor. Gives the buffer back to OpenNI.
+*/
+KinectFrame::~KinectFrame()
+{
+	release();
+}
+
+
+/**
+ Gives the buffer back to OpenNI. The image is emptied, so it cannot point at a freed buffer.
+
+ @return Nothing.
+*/
+void KinectFrame::release()
+{
+	image.release();
+	frameRef.release();
+}
+
+
+/**
+ Checks if the frame holds an image.
+
+ @return True if the frame was read and has not been released, false otherwise.
+*/
+bool KinectFrame::isValid() const
+{
+	return( frameRef.isValid() && !image.empty() );
+}
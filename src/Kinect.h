@@ -22,12 +22,9 @@
 
 #include <cstring>
 
-
-//Macros
-#define WIN_SIZE_X	640
-#define WIN_SIZE_Y	480
-
-#define MAX_USERS	10
+#include "ChromaKey.h"
+#include "FrameSource.h"
+#include "JointFilter.h"
 
 
 using namespace std;
@@ -35,61 +32,56 @@ using namespace std;
 /** Origins of a frame */
 enum CameraMode {NI_SENSOR_DEPTH, NI_SENSOR_COLOR};
 
-/** State of a user */
-enum UserState {USER_NOT_FOUND, USER_FOUND, CALIBRATING, TRACKING, STOPPED};
-
 /** Options of streams */
 enum StreamOption {RGB, DEPTH, RGB_AND_DEPTH};
 
-/** Holds the coordinates and user state of an user */
-struct userInfo
+/** Data of the tracker in a single frame. The user map, the depth frame and the joints all come from the same tracker frame */
+struct FrameSnapshot
 {
-	/* X-coordinate of the right hand */
-	float rightHandX;
-	/* Y-coordinate of the right hand */
-	float rightHandY;
-	/* X-coordinate of the left hand */
-	float leftHandX;
-	/* Y-coordinate of the left hand */
-	float leftHandY;
-	/* X-coordinate of the head */
-	float headX;
-	/* Y-coordinate of the head */
-	float headY;
-	/* X-coordinate of the neck */
-	float neckX;
-	/* Y-coordinate of the neck */
-	float neckY;
-	/* X-coordinate of the left shoulder */
-	float leftShoulderX;
-	/* Y-coordinate of the left shoulder */
-	float leftShoulderY;
-	/* X-coordinate of the right shoulder */
-	float rightShoulderX;
-	/* Y-coordinate of the right shoulder */
-	float rightShoulderY;
-	/* X-coordinate of the left elbow */
-	float leftElbowX;
-	/* Y-coordinate of the left elbow */
-	float leftElbowY;
-	/* X-coordinate of the right elbow */
-	float rightElbowX;
-	/* Y-coordinate of the right elbow */
-	float rightElbowY;
-	/* X-coordinate of the left hip */
-	float leftHipX;
-	/* Y-coordinate of the left hip */
-	float leftHipY;
-	/* X-coordinate of the right hip */
-	float rightHipX;
-	/* Y-coordinate of the right hip */
-	float rightHipY;
-	/* State of the user */
-	UserState userState;
+	/* Frame of the user tracker. It keeps the user map and the depth frame alive */
+	nite::UserTrackerFrameRef userTrackerFrame;
+	/* Depth frame used by the tracker */
+	openni::VideoFrameRef depthFrame;
+	/* Header over the pixels of the user map (CV_16U). 0 means there is no user in that pixel */
+	cv::Mat userMap;
+	/* Coordinates and state of every user */
+	userInfo usersInfo[MAX_USERS];
+	/* All the joints of every user. Only valid for the users being tracked */
+	UserSkeleton skeletons[MAX_USERS];
+	/* Number of users detected */
+	int usersNumber;
+	/* Timestamp of the tracker frame, in microseconds */
+	unsigned long long timestamp;
+	/* Index of the tracker frame */
+	int frameIndex;
+};
+
+
+/** Frame of a stream read without copying its pixels. The image points directly at the buffer of OpenNI,
+    which is kept alive until the frame is released or destroyed. The image must be treated as read-only. */
+class KinectFrame
+{
+	public:
+		KinectFrame();
+		~KinectFrame();
+
+		void release();
+		bool isValid() const;
+
+		cv::Mat image; /** Header over the OpenNI buffer. CV_8UC3 in RGB order for the RGB stream, CV_16U in millimetres for the depth stream */
+
+	private:
+		// A frame cannot be copied, so the buffer has a single owner
+		KinectFrame(const KinectFrame &frame);
+		KinectFrame &operator=(const KinectFrame &frame);
+
+		openni::VideoFrameRef frameRef; /** Keeps the OpenNI buffer alive */
+
+		friend class Kinect;
 };
 
 
-class Kinect
+class Kinect : public FrameSource
 {
 	public:
 		Kinect();
@@ -104,18 +96,30 @@ class Kinect
 		int startRecordStream(const char * fileName, StreamOption streamOption);
 		void stopRecordStream();
 		bool readFrame(cv::Mat &frame, CameraMode camMode);
+		bool readFrame(KinectFrame &frame, CameraMode camMode);
+		bool setPlayback(float speed, bool repeat);
 
 		// NITE functions
 		bool startUserTracking();
 		bool readTrackerFrame();
 		int getJointCoordinates(const nite::UserData& user, nite::JointType jointType, float &coordX, float &coordY);
+		bool updateProjection();
+		void readSkeleton(const nite::UserData& user, UserSkeleton &skeleton);
 		void usersManagement();
+		void setJointFilter(const JointFilterConfig &config);
 
 		// Other functions
 		void insertChroma(cv::Mat &frameColor, cv::Mat frameImageLoaded);
+		bool insertChromaMirrored(const cv::Mat &sensorColor, cv::Mat &frameColor, cv::Mat frameImageLoaded);
 		int getUsersNumber();
+		const FrameSnapshot &getSnapshot() const;
+
+		// Frame source
+		bool readSnapshot(SourceFrame &frame);
+		bool readRawSnapshot(SourceFrame &frame, cv::Mat &sensorColor, bool &isRgb);
 
 		userInfo usersInfo[MAX_USERS];
+		UserSkeleton skeletons[MAX_USERS];
 
 	private:
 		// openni
@@ -124,11 +128,18 @@ class Kinect
 		openni::VideoStream depth;
 		openni::VideoStream color;
 		openni::Recorder recorder;
-		openni::VideoFrameRef depthFrame;
 		// nite
 		nite::Status niteRc;
 		nite::UserTracker userTracker;
-		nite::UserTrackerFrameRef userTrackerFrame;
+
+		FrameSnapshot snapshot; // Data of the last tracker frame, shared by all the stages of a frame
+		KinectFrame colorFrame; // Frame of the RGB camera used by readSnapshot
+
+		ChromaKey chroma; // Background replacement, with the background image already scaled
+		JointFilter jointFilter; // Smooths the coordinates of the joints
+
+		SkeletonProjection projection; // Projection of the real world to the window, for the current video mode
+		int projectionResX, projectionResY; // Resolution of the depth frame used to measure the projection
 
 
 		int usersNumber;
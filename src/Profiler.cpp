@@ -0,0 +1,358 @@
+/**
+ @file   Profiler.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Class to measure the time spent in each stage of a frame, and to show or save the measures.
+*/
+
+#include "Profiler.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+using namespace std;
+using namespace cv;
+
+
+/**
+ Constructor. The profiler is disabled until @ref setEnabled or @ref toggleOverlay is called.
+*/
+Profiler::Profiler()
+{
+	stagesNumber = 0;
+	enabled = false;
+	overlay = false;
+}
+
+
+/**
+ Destructor.
+*/
+Profiler::~Profiler()
+{
+}
+
+
+/**
+ Adds a stage to be measured. All the stages must be added before the times are recorded.
+
+ @param [in] name Name of the stage, shown in the overlay and in the CSV file.
+
+ @return Number of the stage, or -1 if there are already PROFILER_STAGES stages.
+*/
+int Profiler::addStage(string name)
+{
+	if (stagesNumber >= PROFILER_STAGES)
+	{
+		cout << "ERROR: Too many stages in the profiler." << endl;
+		return -1;
+	}
+
+	Stage &stage = stages[stagesNumber];
+
+	stage.name = name;
+	stage.count = 0;
+	stage.total = 0;
+	stage.max = 0;
+	memset(stage.window, 0, sizeof(stage.window));
+	memset(stage.buckets, 0, sizeof(stage.buckets));
+
+	return stagesNumber++;
+}
+
+
+/**
+ Starts or stops recording the times.
+
+ @param [in] enabled True to record the times, false otherwise.
+
+ @return Nothing.
+*/
+void Profiler::setEnabled(bool enabled)
+{
+	this->enabled = enabled;
+}
+
+
+/**
+ Shows or hides the overlay. The times are recorded while the overlay is shown.
+
+ @return Nothing.
+*/
+void Profiler::toggleOverlay()
+{
+	overlay = !overlay;
+
+	if (overlay)
+		enabled = true;
+}
+
+
+/**
+ Records a sample of a stage.
+
+ @param [in] stage Number of the stage.
+ @param [in] ms Time of the stage, in milliseconds.
+
+ @return Nothing.
+*/
+void Profiler::record(int stage, double ms)
+{
+	if (stage < 0 || stage >= stagesNumber)
+		return;
+
+	Stage &s = stages[stage];
+	double us = ms * 1000;
+	int bucket = 0;
+
+	s.window[s.count % PROFILER_WINDOW] = (float)ms;
+	s.count++;
+	s.total += ms;
+	if (ms > s.max)
+		s.max = (float)ms;
+
+	// Bucket 'n' holds the samples up to 2^((n+1)/PROFILER_OCTAVE) microseconds
+	if (us > 1)
+		bucket = (int)(PROFILER_OCTAVE * log(us) / log(2.0));
+	if (bucket >= PROFILER_BUCKETS)
+		bucket = PROFILER_BUCKETS - 1;
+
+	s.buckets[bucket]++;
+}
+
+
+/**
+ Calculates the percentiles of the last PROFILER_WINDOW samples of a stage.
+
+ @param [in] stage Number of the stage.
+
+ @return A @ref StageTimes structure with the times.
+*/
+StageTimes Profiler::getRecentTimes(int stage)
+{
+	StageTimes times = {0, 0, 0, 0, 0, 0};
+	float samples[PROFILER_WINDOW];
+
+	if (stage < 0 || stage >= stagesNumber)
+		return times;
+
+	Stage &s = stages[stage];
+	int n = (s.count < PROFILER_WINDOW) ? s.count : PROFILER_WINDOW;
+
+	if (n == 0)
+		return times;
+
+	memcpy(samples, s.window, n * sizeof(float));
+	sort(samples, samples + n);
+
+	times.count = n;
+	for (int i = 0; i < n; i++)
+		times.mean += samples[i];
+	times.mean /= n;
+	times.p50 = samples[(n - 1) * 50 / 100];
+	times.p95 = samples[(n - 1) * 95 / 100];
+	times.p99 = samples[(n - 1) * 99 / 100];
+	times.max = samples[n - 1];
+
+	return times;
+}
+
+
+/**
+ Calculates the percentiles of all the samples of a stage since the session started. They are taken from
+ the histogram, so they are rounded up to the limit of their bucket (less than 10% of error).
+
+ @param [in] stage Number of the stage.
+
+ @return A @ref StageTimes structure with the times.
+*/
+StageTimes Profiler::getSessionTimes(int stage)
+{
+	StageTimes times = {0, 0, 0, 0, 0, 0};
+	double percentiles[3] = {0.50, 0.95, 0.99};
+	double *results[3] = {&times.p50, &times.p95, &times.p99};
+	unsigned long accumulated = 0;
+	int next = 0;
+
+	if (stage < 0 || stage >= stagesNumber || stages[stage].count == 0)
+		return times;
+
+	Stage &s = stages[stage];
+
+	times.count = s.count;
+	times.mean = s.total / s.count;
+	times.max = s.max;
+
+	for (int i = 0; i < PROFILER_BUCKETS && next < 3; i++)
+	{
+		accumulated += s.buckets[i];
+
+		while (next < 3 && accumulated >= percentiles[next] * s.count)
+		{
+			// The limit of the bucket is not shown above the real maximum
+			*results[next] = min(bucketLimit(i), times.max);
+			next++;
+		}
+	}
+
+	return times;
+}
+
+
+/**
+ Checks if any time was recorded during the session.
+
+ @return True if any stage has samples, false otherwise.
+*/
+bool Profiler::hasSamples()
+{
+	for (int i = 0; i < stagesNumber; i++)
+	{
+		if (stages[i].count > 0)
+			return true;
+	}
+
+	return false;
+}
+
+
+/**
+ Draws a table with the recent times of every stage in the top left corner of the frame.
+
+ @param [out] frameColor Frame where the table is drawn.
+
+ @return Nothing.
+*/
+void Profiler::drawOverlay(cv::Mat &frameColor)
+{
+	const int lineHeight = 14;
+	ostringstream line;
+
+	if (!overlay || stagesNumber == 0)
+		return;
+
+	// Darkens the area of the table, so the text can be read over the camera image
+	Rect area = Rect(0, 0, 330, lineHeight * (stagesNumber + 1) + 8) & Rect(0, 0, frameColor.cols, frameColor.rows);
+	Mat roi(frameColor, area);
+	roi.convertTo(roi, -1, 0.35);
+
+	putText(frameColor, "stage          p50    p95    p99    max ms", Point(4, lineHeight), FONT_HERSHEY_PLAIN, 0.9, Scalar(0, 255, 255), 1);
+
+	for (int i = 0; i < stagesNumber; i++)
+	{
+		StageTimes times = getRecentTimes(i);
+
+		line.str("");
+		line << fixed << setprecision(1) << left << setw(13) << stages[i].name << right
+			<< setw(7) << times.p50 << setw(7) << times.p95 << setw(7) << times.p99 << setw(7) << times.max;
+
+		putText(frameColor, line.str(), Point(4, lineHeight * (i + 2)), FONT_HERSHEY_PLAIN, 0.9, Scalar(255, 255, 255), 1);
+	}
+}
+
+
+/**
+ Writes the times of the session of every stage in a CSV file.
+
+ @param [in] path Path of the CSV file.
+
+ @return True if the file was written, false otherwise.
+*/
+bool Profiler::writeCsv(string path)
+{
+	ofstream file(path.c_str());
+
+	if (!file.is_open())
+	{
+		cout << "ERROR: Couldn't write the profile in " << path << endl;
+		return false;
+	}
+
+	file << "stage,count,mean_ms,p50_ms,p95_ms,p99_ms,max_ms" << endl;
+
+	for (int i = 0; i < stagesNumber; i++)
+	{
+		StageTimes times = getSessionTimes(i);
+
+		file << stages[i].name << "," << times.count << "," << fixed << setprecision(3) << times.mean << ","
+			<< times.p50 << "," << times.p95 << "," << times.p99 << "," << times.max << endl;
+	}
+
+	return true;
+}
+
+
+/**
+ Makes the name of the CSV file of a session, with the date and hour when it is called.
+
+ @param [in] program Name of the program profiled.
+
+ @return A name like 'profile_game_20261017_103000.csv'.
+*/
+string Profiler::sessionFileName(string program)
+{
+	char date[32];
+	time_t now = time(NULL);
+
+	strftime(date, sizeof(date), "%Y%m%d_%H%M%S", localtime(&now));
+
+	return "profile_" + program + "_" + date + ".csv";
+}
+
+
+/**
+ Gets the upper limit of a bucket of the histogram.
+
+ @param [in] bucket Number of the bucket.
+
+ @return Upper limit of the bucket, in milliseconds.
+*/
+double Profiler::bucketLimit(int bucket)
+{
+	return pow(2.0, (bucket + 1) / (double)PROFILER_OCTAVE) / 1000;
+}
+
+
+/**
+ Constructor. Starts measuring the stage if the profiler is enabled.
+
+ @param [in] profiler Profiler where the time is recorded. It can be NULL.
+ @param [in] stage Number of the stage.
+*/
+ProfileScope::ProfileScope(Profiler *profiler, int stage)
+{
+	this->profiler = profiler;
+	this->stage = stage;
+
+	start = (profiler != NULL && profiler->isEnabled()) ? getTickCount() : 0;
+}
+
+
+/**
+ Destructor. Records the time of the stage, if it was not recorded yet.
+*/
+ProfileScope::~ProfileScope()
+{
+	stop();
+}
+
+
+/**
+ Records the time since the stage started. Later calls do nothing.
+
+ @return Nothing.
+*/
+void ProfileScope::stop()
+{
+	if (start == 0)
+		return;
+
+	profiler->record(stage, (getTickCount() - start) * 1000.0 / getTickFrequency());
+	start = 0;
+}
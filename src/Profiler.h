@@ -0,0 +1,106 @@
+/**
+ @file   Profiler.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Class to measure the time spent in each stage of a frame, and to show or save the measures.
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include "cvaux.h" // Include for OpenCV
+
+//Macros
+#define PROFILER_STAGES		16 // Maximum number of stages
+#define PROFILER_WINDOW		256 // Number of the last samples of each stage used by the overlay
+#define PROFILER_BUCKETS	192 // Buckets of the histogram of the session: 8 per octave, from 1 microsecond
+#define PROFILER_OCTAVE		8
+
+
+using namespace std;
+
+/** Percentiles of the time of a stage, in milliseconds */
+struct StageTimes
+{
+	/* Number of samples used */
+	unsigned long count;
+	/* Mean time */
+	double mean;
+	/* Percentile 50 (median) */
+	double p50;
+	/* Percentile 95 */
+	double p95;
+	/* Percentile 99 */
+	double p99;
+	/* Maximum time */
+	double max;
+};
+
+
+class Profiler
+{
+	public:
+		Profiler();
+		~Profiler();
+
+		int addStage(string name);
+		void setEnabled(bool enabled);
+		void toggleOverlay();
+
+		/**
+		 Checks if the times are being recorded. It is inline, so a disabled profiler costs a single test.
+
+		 @return True if the times are recorded, false otherwise.
+		*/
+		bool isEnabled() const { return enabled; }
+
+		void record(int stage, double ms);
+		StageTimes getRecentTimes(int stage);
+		StageTimes getSessionTimes(int stage);
+
+		bool hasSamples();
+		void drawOverlay(cv::Mat &frameColor);
+		bool writeCsv(string path);
+		static string sessionFileName(string program);
+
+	private:
+		double bucketLimit(int bucket);
+
+		/** Samples of a stage. Each stage must be recorded always from the same thread */
+		struct Stage
+		{
+			string name;
+			float window[PROFILER_WINDOW]; // Last samples, in a ring
+			unsigned long count; // Number of samples of the session
+			double total; // Sum of the samples of the session
+			float max; // Maximum sample of the session
+			unsigned long buckets[PROFILER_BUCKETS]; // Histogram of the session, with logarithmic buckets
+		};
+
+		Stage stages[PROFILER_STAGES];
+		int stagesNumber;
+		volatile bool enabled; /** True if the times are recorded */
+		bool overlay; /** True if the overlay is drawn */
+};
+
+
+/**
+ Measures the time of a stage from its creation until it is destroyed, or until @ref stop is called.
+ If the profiler is NULL or disabled, the clock is not read.
+*/
+class ProfileScope
+{
+	public:
+		ProfileScope(Profiler *profiler, int stage);
+		~ProfileScope();
+
+		void stop();
+
+	private:
+		Profiler *profiler;
+		int stage;
+		int64 start; /** Ticks when the stage started, or 0 if it is not being measured */
+};
+
+#endif
@@ -0,0 +1,430 @@
+/**
+ @file   SessionFile.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Binary file with the skeleton samples of a game: a header, fixed-size records appended in order of
+ 	time and an index to seek by time. The file can be read with mmap, without SQLite.
+*/
+
+#include "SessionFile.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <fcntl.h> // Include for open() function
+#include <unistd.h> // Include for close() function
+#include <sys/mman.h> // Include for mmap() function
+#include <sys/stat.h> // Include for fstat() and mkdir() functions
+
+using namespace std;
+
+
+// The layout of the file must not depend on the compiler: these declarations fail to compile if the sizes change
+typedef char sessionHeaderSizeCheck[(sizeof(SessionHeader) == 64) ? 1 : -1];
+typedef char sessionRecordSizeCheck[(sizeof(SessionRecord) == 400) ? 1 : -1];
+typedef char sessionIndexSizeCheck[(sizeof(SessionIndexEntry) == 16) ? 1 : -1];
+
+
+/////////////////////////////////////////////////////////////////////
+/////////////// WRITER //////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////
+
+/**
+ Constructor. The file is not created until @ref open is called.
+*/
+SessionWriter::SessionWriter()
+{
+	file = NULL;
+}
+
+
+/**
+ Destructor. Closes the file, if it is open.
+*/
+SessionWriter::~SessionWriter()
+{
+	close();
+}
+
+
+/**
+ Gets the path of the session file of a game. The directory is created if it does not exist.
+
+ @param [in] directory Directory of the session files.
+ @param [in] gameId ID number of the game.
+
+ @return Path of the file.
+*/
+string SessionWriter::fileName(string directory, int gameId)
+{
+	ostringstream path;
+
+	mkdir(directory.c_str(), 0755);
+
+	path << directory << "/game_" << gameId << ".ses";
+
+	return path.str();
+}
+
+
+/**
+ Creates a session file and writes its header. If the file already exists, it is not changed, so a recorded
+ session is never lost.
+
+ @param [in] path Path of the file.
+ @param [in] gameId ID number of the game.
+
+ @return True if the file was created, false otherwise.
+*/
+bool SessionWriter::open(string path, int gameId)
+{
+	int fd;
+
+	close();
+
+	// The file is only created if it does not exist
+	fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+	if(fd < 0)
+	{
+		if(errno == EEXIST)
+			cout << "ERROR: Session file " << path << " already exists, the session is not saved." << endl;
+		else
+			cout << "ERROR: Session file " << path << " cannot be created." << endl;
+		return false;
+	}
+
+	file = fdopen(fd, "wb");
+	if(file == NULL)
+	{
+		cout << "ERROR: Session file " << path << " cannot be created." << endl;
+		::close(fd);
+		return false;
+	}
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SESSION_MAGIC, sizeof(header.magic));
+	header.version = SESSION_VERSION;
+	header.headerSize = sizeof(SessionHeader);
+	header.recordSize = sizeof(SessionRecord);
+	header.joints = SKELETON_JOINTS;
+	header.gameId = gameId;
+	header.indexInterval = SESSION_INDEX_INTERVAL;
+
+	index.clear();
+
+	// The header says that the file is not closed until the records and the index are written
+	if( fwrite(&header, sizeof(header), 1, file) != 1 )
+	{
+		cout << "ERROR: Session file " << path << " cannot be written." << endl;
+		fclose(file);
+		file = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+
+/**
+ Appends a record at the end of the file. The records must be appended in order of time.
+
+ @param [in] record Record to be appended.
+
+ @return True if the record was written, false otherwise.
+*/
+bool SessionWriter::append(const SessionRecord &record)
+{
+	SessionIndexEntry entry;
+
+	if(file == NULL)
+		return false;
+
+	if( fwrite(&record, sizeof(record), 1, file) != 1 )
+		return false;
+
+	// Every SESSION_INDEX_INTERVAL records, the position of the record is added to the index
+	if(header.recordsNumber % SESSION_INDEX_INTERVAL == 0)
+	{
+		entry.timestamp = record.timestamp;
+		entry.record = header.recordsNumber;
+		index.push_back(entry);
+	}
+
+	if(header.recordsNumber == 0)
+		header.firstTimestamp = record.timestamp;
+
+	header.lastTimestamp = record.timestamp;
+	header.recordsNumber++;
+
+	return true;
+}
+
+
+/**
+ Writes the index after the records, updates the header and closes the file.
+
+ @return True if the file was closed correctly, false otherwise.
+*/
+bool SessionWriter::close()
+{
+	bool ok = true;
+
+	if(file == NULL)
+		return true;
+
+	header.indexOffset = sizeof(SessionHeader) + header.recordsNumber * sizeof(SessionRecord);
+	header.indexEntries = index.size();
+
+	if( !index.empty() && fwrite(&index[0], sizeof(SessionIndexEntry), index.size(), file) != index.size() )
+		ok = false;
+
+	// The header is written the last, so a file with a valid index is always complete
+	if( ok && (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1) )
+		ok = false;
+
+	if( fclose(file) != 0 )
+		ok = false;
+
+	if(!ok)
+		cout << "ERROR: Session file of the game " << header.gameId << " cannot be closed." << endl;
+
+	file = NULL;
+	index.clear();
+
+	return ok;
+}
+
+
+/**
+ Checks if the file is open.
+
+ @return True if the file is open, false otherwise.
+*/
+bool SessionWriter::isOpen()
+{
+	return file != NULL;
+}
+
+
+/**
+ Gets the ID number of the game of the file.
+
+ @return ID number of the game.
+*/
+int SessionWriter::getGameId()
+{
+	return header.gameId;
+}
+
+
+/////////////////////////////////////////////////////////////////////
+/////////////// READER //////////////////////////////////////////////
+/////////////////////////////////////////////////////////////////////
+
+/**
+ Constructor. The file is not read until @ref open is called.
+*/
+SessionReader::SessionReader()
+{
+	data = NULL;
+	size = 0;
+	records = NULL;
+	recordsNumber = 0;
+	index = NULL;
+	memset(&header, 0, sizeof(header));
+}
+
+
+/**
+ Destructor. Unmaps the file, if it is open.
+*/
+SessionReader::~SessionReader()
+{
+	close();
+}
+
+
+/**
+ Maps a session file in memory. The records are read directly from the mapping, so only the pages that are
+ used are read from the disk. If the file was not closed (the game was stopped), the records are counted from
+ the size of the file and it has no index.
+
+ @param [in] path Path of the file.
+
+ @return True if the file is a valid session file, false otherwise.
+*/
+bool SessionReader::open(string path)
+{
+	struct stat fileStat;
+	int fd;
+
+	close();
+
+	fd = ::open(path.c_str(), O_RDONLY);
+	if(fd < 0)
+	{
+		cout << "ERROR: Session file " << path << " cannot be opened." << endl;
+		return false;
+	}
+
+	if( fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(SessionHeader) )
+	{
+		cout << "ERROR: Session file " << path << " is not valid." << endl;
+		::close(fd);
+		return false;
+	}
+
+	size = fileStat.st_size;
+	data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+	// The mapping keeps the file alive
+	::close(fd);
+
+	if(data == MAP_FAILED)
+	{
+		cout << "ERROR: Session file " << path << " cannot be mapped." << endl;
+		data = NULL;
+		size = 0;
+		return false;
+	}
+
+	memcpy(&header, data, sizeof(header));
+
+	if( memcmp(header.magic, SESSION_MAGIC, sizeof(header.magic)) != 0 || header.version != SESSION_VERSION
+		|| header.headerSize < sizeof(SessionHeader) || header.headerSize > size || header.recordSize != sizeof(SessionRecord) || header.joints != SKELETON_JOINTS )
+	{
+		cout << "ERROR: Session file " << path << " has an unknown format." << endl;
+		close();
+		return false;
+	}
+
+	records = (const SessionRecord*)((const char*)data + header.headerSize);
+
+	// A closed file has the number of records and the index. Otherwise, only the whole records are read
+	if( header.indexOffset != 0 && header.indexOffset + header.indexEntries * sizeof(SessionIndexEntry) <= size
+		&& header.headerSize + header.recordsNumber * sizeof(SessionRecord) <= header.indexOffset )
+	{
+		recordsNumber = header.recordsNumber;
+		index = (header.indexEntries > 0) ? (const SessionIndexEntry*)((const char*)data + header.indexOffset) : NULL;
+	}
+	else
+	{
+		recordsNumber = (size - header.headerSize) / sizeof(SessionRecord);
+		index = NULL;
+		header.indexEntries = 0;
+	}
+
+	// The records are usually scanned from the first to the last
+	madvise(data, size, MADV_SEQUENTIAL);
+
+	return true;
+}
+
+
+/**
+ Unmaps the file. The records got before are not valid anymore.
+
+ @return Nothing.
+*/
+void SessionReader::close()
+{
+	if(data != NULL)
+		munmap(data, size);
+
+	data = NULL;
+	size = 0;
+	records = NULL;
+	recordsNumber = 0;
+	index = NULL;
+}
+
+
+/**
+ Gets the header of the file.
+
+ @return The header of the file.
+*/
+const SessionHeader &SessionReader::getHeader() const
+{
+	return header;
+}
+
+
+/**
+ Gets the number of records of the file.
+
+ @return Number of records.
+*/
+unsigned long long SessionReader::getRecordsNumber() const
+{
+	return recordsNumber;
+}
+
+
+/**
+ Gets a record of the file. It points inside the mapping, so it is valid until the file is closed.
+
+ @param [in] record Number of the record.
+
+ @return The record, or NULL if it does not exist.
+*/
+const SessionRecord *SessionReader::getRecord(unsigned long long record) const
+{
+	if(record >= recordsNumber)
+		return NULL;
+
+	return &records[record];
+}
+
+
+/**
+ Finds the first record at or after a moment. The index gives the block of records where it is, so only
+ that block is searched.
+
+ @param [in] timestamp Moment to find, in microseconds.
+
+ @return Number of the record, or the number of records if all of them are before that moment.
+*/
+unsigned long long SessionReader::findRecord(unsigned long long timestamp) const
+{
+	unsigned long long first = 0;
+	unsigned long long last = recordsNumber;
+	unsigned long long middle;
+	unsigned int low, high, entry;
+
+	// Finds the last entry of the index before the moment, and the next one
+	if(index != NULL)
+	{
+		low = 0;
+		high = header.indexEntries;
+
+		while(low < high)
+		{
+			entry = (low + high) / 2;
+
+			if(index[entry].timestamp < timestamp)
+				low = entry + 1;
+			else
+				high = entry;
+		}
+
+		if(low > 0)
+			first = index[low - 1].record;
+		if(low < header.indexEntries)
+			last = index[low].record;
+	}
+
+	// Binary search between the two entries
+	while(first < last)
+	{
+		middle = first + (last - first) / 2;
+
+		if(records[middle].timestamp < timestamp)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	return first;
+}
@@ -0,0 +1,133 @@
+/**
+ @file   SessionFile.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Binary file with the skeleton samples of a game: a header, fixed-size records appended in order of
+ 	time and an index to seek by time. The file can be read with mmap, without SQLite.
+*/
+
+#ifndef SESSIONFILE_H
+#define SESSIONFILE_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Skeleton.h"
+
+//Macros
+#define SESSION_MAGIC			"KSES" // First bytes of a session file
+#define SESSION_VERSION			1
+#define SESSION_INDEX_INTERVAL	256 // Records between two entries of the index
+#define SESSION_DIRECTORY		"./sessions" // Directory of the session files of the games
+
+
+using namespace std;
+
+/** Header at the beginning of a session file. All the fields are aligned, so the layout is the same in 32 and 64 bits */
+struct SessionHeader
+{
+	/* SESSION_MAGIC, without the final null character */
+	char magic[4];
+	/* Version of the format */
+	unsigned int version;
+	/* Size of this header, in bytes. The first record starts here */
+	unsigned int headerSize;
+	/* Size of a record, in bytes */
+	unsigned int recordSize;
+	/* Number of joints of the skeleton of a record */
+	unsigned int joints;
+	/* ID number of the game */
+	int gameId;
+	/* Number of records. 0 if the file was not closed, then the records are counted from the size of the file */
+	unsigned long long recordsNumber;
+	/* Position of the index in the file, after the last record. 0 if the file was not closed */
+	unsigned long long indexOffset;
+	/* Number of entries of the index */
+	unsigned int indexEntries;
+	/* Records between two entries of the index */
+	unsigned int indexInterval;
+	/* Timestamp of the first record, in microseconds */
+	unsigned long long firstTimestamp;
+	/* Timestamp of the last record, in microseconds */
+	unsigned long long lastTimestamp;
+};
+
+/** Sample of the skeleton of a user in a frame of the game */
+struct SessionRecord
+{
+	/* Timestamp of the frame, in microseconds */
+	unsigned long long timestamp;
+	/* Time played since the game started, without the pauses, in microseconds */
+	unsigned long long gameTime;
+	/* ID number of the game */
+	int gameId;
+	/* Slot of the user in the frame */
+	int user;
+	/* Coordinates of the fruit */
+	float fruitX, fruitY;
+	/* All the joints of the user */
+	UserSkeleton skeleton;
+	/* Not used, it keeps the size of the record a multiple of 8 bytes */
+	unsigned int reserved;
+};
+
+/** Entry of the index: position of a record, every SESSION_INDEX_INTERVAL records */
+struct SessionIndexEntry
+{
+	/* Timestamp of the record, in microseconds */
+	unsigned long long timestamp;
+	/* Number of the record */
+	unsigned long long record;
+};
+
+
+class SessionWriter
+{
+	public:
+		SessionWriter();
+		~SessionWriter();
+
+		static string fileName(string directory, int gameId);
+
+		bool open(string path, int gameId);
+		bool append(const SessionRecord &record);
+		bool close();
+		bool isOpen();
+		int getGameId();
+
+	private:
+		FILE *file; /** Session file, NULL if it is not open */
+		SessionHeader header; /** Header written when the file is closed */
+		vector<SessionIndexEntry> index; /** Entries of the index, written after the records when the file is closed */
+};
+
+
+class SessionReader
+{
+	public:
+		SessionReader();
+		~SessionReader();
+
+		bool open(string path);
+		void close();
+
+		const SessionHeader &getHeader() const;
+		unsigned long long getRecordsNumber() const;
+		const SessionRecord *getRecord(unsigned long long record) const;
+		unsigned long long findRecord(unsigned long long timestamp) const;
+
+	private:
+		// A reader cannot be copied, so the mapping has a single owner
+		SessionReader(const SessionReader &reader);
+		SessionReader &operator=(const SessionReader &reader);
+
+		void *data; /** Mapping of the whole file, NULL if it is not open */
+		size_t size; /** Size of the mapping, in bytes */
+		SessionHeader header;
+		const SessionRecord *records; /** First record, inside the mapping */
+		unsigned long long recordsNumber;
+		const SessionIndexEntry *index; /** First entry of the index, inside the mapping. NULL if the file has no index */
+};
+
+#endif
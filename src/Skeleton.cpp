@@ -0,0 +1,185 @@
+/**
+ @file   Skeleton.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Skeleton of a user with all the joints of the tracker, stored as arrays of coordinates.
+*/
+
+#include "Skeleton.h"
+#include "FrameSource.h"
+
+#include <cstddef> // Include for offsetof
+
+using namespace std;
+
+
+//Macros
+#define VIEW_JOINTS		10 // Joints of 'userInfo'
+#define VIEW_FOCAL_LENGTH	525.0f // Focal length of the depth camera at 640x480, in pixels
+
+
+/** Joint of the skeleton shown in each pair of coordinates of 'userInfo'. The hands of the tracker are swapped,
+    because its right hand is, in fact, the left hand of the user as seen in the mirrored window */
+static const int viewJoints[VIEW_JOINTS] =
+{
+	SKELETON_LEFT_HAND, SKELETON_RIGHT_HAND, SKELETON_HEAD, SKELETON_NECK, SKELETON_LEFT_SHOULDER,
+	SKELETON_RIGHT_SHOULDER, SKELETON_LEFT_ELBOW, SKELETON_RIGHT_ELBOW, SKELETON_LEFT_HIP, SKELETON_RIGHT_HIP
+};
+
+/** Position of the X-coordinate of each pair of coordinates of 'userInfo'. The Y-coordinate is the next field */
+static const size_t viewOffsets[VIEW_JOINTS] =
+{
+	offsetof(userInfo, rightHandX), offsetof(userInfo, leftHandX), offsetof(userInfo, headX), offsetof(userInfo, neckX),
+	offsetof(userInfo, leftShoulderX), offsetof(userInfo, rightShoulderX), offsetof(userInfo, leftElbowX),
+	offsetof(userInfo, rightElbowX), offsetof(userInfo, leftHipX), offsetof(userInfo, rightHipX)
+};
+
+
+/**
+ Sets all the joints of a skeleton as not available.
+
+ @param [out] skeleton Skeleton to be cleared.
+
+ @return Nothing.
+*/
+void clearSkeleton(UserSkeleton &skeleton)
+{
+	for (int j = 0; j < SKELETON_JOINTS; j++)
+	{
+		skeleton.x[j] = 0;
+		skeleton.y[j] = 0;
+		skeleton.z[j] = 0;
+		skeleton.confidence[j] = 0;
+		skeleton.windowX[j] = -1;
+		skeleton.windowY[j] = -1;
+	}
+
+	skeleton.valid = 0;
+}
+
+
+/**
+ Checks if a joint of a skeleton is available.
+
+ @param [in] skeleton Skeleton of the user.
+ @param [in] joint Index of the joint.
+
+ @return True if the joint is available, false otherwise.
+*/
+bool isJointValid(const UserSkeleton &skeleton, int joint)
+{
+	return (skeleton.valid & (1u << joint)) != 0;
+}
+
+
+/**
+ Copies the window coordinates of the joints of a skeleton in the fields of a user. The joints that are not
+ available are set as -1. The state of the user is not changed.
+
+ @param [in] skeleton Skeleton of the user.
+ @param [out] user Coordinates of the user.
+
+ @return Nothing.
+*/
+void skeletonToUserInfo(const UserSkeleton &skeleton, userInfo &user)
+{
+	float *coordinates;
+	int joint;
+
+	for (int i = 0; i < VIEW_JOINTS; i++)
+	{
+		joint = viewJoints[i];
+		coordinates = (float*)((char*)&user + viewOffsets[i]);
+
+		if ( isJointValid(skeleton, joint) )
+		{
+			coordinates[0] = skeleton.windowX[joint];
+			coordinates[1] = skeleton.windowY[joint];
+		}
+		else
+		{
+			coordinates[0] = -1;
+			coordinates[1] = -1;
+		}
+	}
+}
+
+
+/**
+ Makes a skeleton from the window coordinates of a user, for the sources that do not have a tracker. The
+ joints not available in the user (-1) are not available in the skeleton, and the joints that the user
+ does not have (knees, feet and torso) are never available. The real world coordinates are estimated
+ as if all the joints were at the same distance from the sensor.
+
+ @param [in] user Coordinates of the user.
+ @param [in] depth Distance of the user to the sensor, in millimetres.
+ @param [out] skeleton Skeleton of the user.
+
+ @return Nothing.
+*/
+void userInfoToSkeleton(const userInfo &user, float depth, UserSkeleton &skeleton)
+{
+	const float *coordinates;
+	int joint;
+
+	clearSkeleton(skeleton);
+
+	for (int i = 0; i < VIEW_JOINTS; i++)
+	{
+		joint = viewJoints[i];
+		coordinates = (const float*)((const char*)&user + viewOffsets[i]);
+
+		if (coordinates[0] == -1)
+			continue;
+
+		skeleton.windowX[joint] = coordinates[0];
+		skeleton.windowY[joint] = coordinates[1];
+
+		// The Y-axis of the real world goes up, and the one of the window goes down
+		skeleton.x[joint] = (coordinates[0] - WIN_SIZE_X / 2) * depth / VIEW_FOCAL_LENGTH;
+		skeleton.y[joint] = (WIN_SIZE_Y / 2 - coordinates[1]) * depth / VIEW_FOCAL_LENGTH;
+		skeleton.z[joint] = depth;
+		skeleton.confidence[joint] = 1;
+		skeleton.valid |= 1u << joint;
+	}
+}
+
+
+/**
+ Projects the real world coordinates of the joints of several skeletons to the window, all of them in a single
+ batch. The coordinates of every joint are computed without branches, so the loop can be vectorized, and the
+ joints that are not available are set as -1 afterwards.
+
+ @param [in,out] skeletons Skeletons whose window coordinates are computed.
+ @param [in] skeletonsNumber Number of skeletons.
+ @param [in] projection Projection of the real world to the window.
+
+ @return Nothing.
+*/
+void projectSkeletons(UserSkeleton *skeletons, int skeletonsNumber, const SkeletonProjection &projection)
+{
+	float inverseZ;
+
+	for (int i = 0; i < skeletonsNumber; i++)
+	{
+		UserSkeleton &skeleton = skeletons[i];
+
+		for (int j = 0; j < SKELETON_JOINTS; j++)
+		{
+			// A joint at distance 0 is not available, so its value does not matter
+			inverseZ = (skeleton.z[j] > 0) ? 1 / skeleton.z[j] : 0;
+
+			skeleton.windowX[j] = projection.offsetX + projection.scaleX * skeleton.x[j] * inverseZ;
+			skeleton.windowY[j] = projection.offsetY - projection.scaleY * skeleton.y[j] * inverseZ;
+		}
+
+		for (int j = 0; j < SKELETON_JOINTS; j++)
+		{
+			if ( !isJointValid(skeleton, j) )
+			{
+				skeleton.windowX[j] = -1;
+				skeleton.windowY[j] = -1;
+			}
+		}
+	}
+}
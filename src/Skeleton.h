@@ -0,0 +1,63 @@
+/**
+ @file   Skeleton.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Skeleton of a user with all the joints of the tracker, stored as arrays of coordinates.
+*/
+
+#ifndef SKELETON_H
+#define SKELETON_H
+
+//Macros
+#define SKELETON_JOINTS		15 // Joints given by NiTE
+#define SKELETON_MIN_CONFIDENCE	0.5f // Minimum confidence of a joint to be available
+
+
+/** Joints of the skeleton, in the same order as nite::JointType */
+enum SkeletonJointIndex {SKELETON_HEAD, SKELETON_NECK, SKELETON_LEFT_SHOULDER, SKELETON_RIGHT_SHOULDER, SKELETON_LEFT_ELBOW,
+	SKELETON_RIGHT_ELBOW, SKELETON_LEFT_HAND, SKELETON_RIGHT_HAND, SKELETON_TORSO, SKELETON_LEFT_HIP, SKELETON_RIGHT_HIP,
+	SKELETON_LEFT_KNEE, SKELETON_RIGHT_KNEE, SKELETON_LEFT_FOOT, SKELETON_RIGHT_FOOT};
+
+/** Skeleton of a user. Each coordinate of all the joints is stored in its own array, so the same operation can
+    be done over all the joints in a single loop. The left and right sides are the ones given by the tracker */
+struct UserSkeleton
+{
+	/* X-coordinate of every joint in the real world, in millimetres */
+	float x[SKELETON_JOINTS];
+	/* Y-coordinate of every joint in the real world, in millimetres */
+	float y[SKELETON_JOINTS];
+	/* Z-coordinate (distance to the sensor) of every joint in the real world, in millimetres */
+	float z[SKELETON_JOINTS];
+	/* Confidence of the position of every joint, from 0 to 1 */
+	float confidence[SKELETON_JOINTS];
+	/* X-coordinate of every joint in the window, in pixels. -1 if the joint is not available */
+	float windowX[SKELETON_JOINTS];
+	/* Y-coordinate of every joint in the window, in pixels. -1 if the joint is not available */
+	float windowY[SKELETON_JOINTS];
+	/* Bit 'j' is set if the joint 'j' is available */
+	unsigned int valid;
+};
+
+/** Projection of the real world coordinates to the window: windowX = offsetX + scaleX * x / z and
+    windowY = offsetY - scaleY * y / z. It includes the scale from the depth frame to the window */
+struct SkeletonProjection
+{
+	/* X-coordinate of the centre of the image in the window, in pixels */
+	float offsetX;
+	/* Y-coordinate of the centre of the image in the window, in pixels */
+	float offsetY;
+	/* Focal length in the X-axis, in pixels of the window */
+	float scaleX;
+	/* Focal length in the Y-axis, in pixels of the window */
+	float scaleY;
+};
+
+struct userInfo;
+
+void clearSkeleton(UserSkeleton &skeleton);
+bool isJointValid(const UserSkeleton &skeleton, int joint);
+void skeletonToUserInfo(const UserSkeleton &skeleton, userInfo &user);
+void userInfoToSkeleton(const userInfo &user, float depth, UserSkeleton &skeleton);
+void projectSkeletons(UserSkeleton *skeletons, int skeletonsNumber, const SkeletonProjection &projection);
+
+#endif
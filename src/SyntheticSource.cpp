@@ -0,0 +1,257 @@
+/**
+ @file   SyntheticSource.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Source of synthetic frames: a user that moves following a script, without a Kinect sensor.
+*/
+
+#include "SyntheticSource.h"
+
+#include <cmath>
+#include <unistd.h> // Include for usleep() function
+#include <sys/time.h> // Include for gettimeofday() function
+
+using namespace std;
+using namespace cv;
+
+
+/**
+ Sets all the coordinates of a user as not available.
+
+ @param [out] user User to be cleared.
+
+ @return Nothing.
+*/
+static void clearJoints(userInfo &user)
+{
+	user.rightHandX = user.rightHandY = -1;
+	user.leftHandX = user.leftHandY = -1;
+	user.headX = user.headY = -1;
+	user.neckX = user.neckY = -1;
+	user.leftShoulderX = user.leftShoulderY = -1;
+	user.rightShoulderX = user.rightShoulderY = -1;
+	user.leftElbowX = user.leftElbowY = -1;
+	user.rightElbowX = user.rightElbowY = -1;
+	user.leftHipX = user.leftHipY = -1;
+	user.rightHipX = user.rightHipY = -1;
+}
+
+
+/**
+ Draws a part of the body both in the RGB frame and in the user map.
+
+ @param [out] frameColor RGB frame.
+ @param [out] userMap User map.
+ @param [in] x1 X-coordinate of the first joint.
+ @param [in] y1 Y-coordinate of the first joint.
+ @param [in] x2 X-coordinate of the second joint.
+ @param [in] y2 Y-coordinate of the second joint.
+ @param [in] thickness Width of the part of the body.
+ @param [in] color Color of the part of the body.
+
+ @return Nothing.
+*/
+static void drawLimb(Mat &frameColor, Mat &userMap, float x1, float y1, float x2, float y2, int thickness, const Scalar &color)
+{
+	line( frameColor, Point((int)x1, (int)y1), Point((int)x2, (int)y2), color, thickness );
+	line( userMap, Point((int)x1, (int)y1), Point((int)x2, (int)y2), Scalar(1), thickness );
+}
+
+
+/**
+ Constructor. Draws the room shown behind the user.
+
+ @param [in] realTime If true, the frames are given at SYNTHETIC_FPS frames per second, as the sensor does.
+	Otherwise, they are given as fast as they are read, to measure the performance of the game.
+*/
+SyntheticSource::SyntheticSource(bool realTime)
+{
+	this->realTime = realTime;
+
+	frameRoom.create(WIN_SIZE_Y, WIN_SIZE_X, CV_8UC3);
+
+	// Wall with a vertical gradient and a floor
+	for (int y = 0; y < WIN_SIZE_Y; y++)
+	{
+		Scalar color = (y < 2 * WIN_SIZE_Y / 3) ? Scalar(200 - y / 4, 190 - y / 4, 170 - y / 4) : Scalar(60, 90, 110);
+		frameRoom.row(y).setTo(color);
+	}
+
+	// A window and a door, so the image is not uniform
+	rectangle( frameRoom, Point(40, 60), Point(180, 200), Scalar(230, 210, 160), -1 );
+	rectangle( frameRoom, Point(500, 90), Point(600, 320), Scalar(40, 70, 120), -1 );
+
+	reset();
+}
+
+
+/**
+ Destructor.
+*/
+SyntheticSource::~SyntheticSource()
+{
+}
+
+
+/**
+ Starts the script again from the first frame.
+
+ @return Nothing.
+*/
+void SyntheticSource::reset()
+{
+	timeval now;
+
+	gettimeofday(&now, NULL);
+
+	frameIndex = 0;
+	nextFrameUsec = (long long)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+
+/**
+ Generates the next frame of the script. The same frame index always gives the same frame.
+
+ @param [out] frame Frame where the data is copied.
+
+ @return True, the frame is always generated.
+*/
+bool SyntheticSource::readSnapshot(SourceFrame &frame)
+{
+	timeval now;
+	long long nowUsec;
+	userInfo user;
+
+	// Waits until the moment of the frame, as the sensor does
+	if (realTime)
+	{
+		gettimeofday(&now, NULL);
+		nowUsec = (long long)now.tv_sec * 1000000 + now.tv_usec;
+
+		if (nextFrameUsec > nowUsec)
+			usleep(nextFrameUsec - nowUsec);
+		else if (nowUsec - nextFrameUsec > 1000000 / SYNTHETIC_FPS)
+			nextFrameUsec = nowUsec; // If the reader fell behind, the frames are not given in a burst
+
+		nextFrameUsec += 1000000 / SYNTHETIC_FPS;
+	}
+
+	// Places the joints of the user and draws them
+	moveUser(frameIndex, user);
+	drawUser(user, frame.frameColor, frame.userMap);
+
+	// The user is found in the first frame, and it is calibrated during some frames before being tracked
+	if (frameIndex == 0)
+		user.userState = USER_FOUND;
+	else if (frameIndex < SYNTHETIC_CALIBRATION)
+		user.userState = CALIBRATING;
+	else
+		user.userState = TRACKING;
+
+	// The coordinates are only available while the user is tracked
+	if (user.userState != TRACKING)
+		clearJoints(user);
+
+	frame.usersInfo[0] = user;
+	for (int i = 1; i < MAX_USERS; i++)
+	{
+		clearJoints(frame.usersInfo[i]);
+		frame.usersInfo[i].userState = USER_NOT_FOUND;
+		clearSkeleton(frame.skeletons[i]);
+	}
+
+	// The skeleton has the same joints as the user, all of them at the same distance
+	userInfoToSkeleton(user, SYNTHETIC_DEPTH, frame.skeletons[0]);
+
+	frame.usersNumber = 1;
+	frame.timestamp = (unsigned long long)frameIndex * 1000000 / SYNTHETIC_FPS;
+	frame.frameIndex = frameIndex;
+
+	frameIndex++;
+
+	return true;
+}
+
+
+/**
+ Places the joints of the user at a given frame. The user moves from side to side, and each hand
+ draws a circle over its shoulder, so the hands go through every area of the top of the screen.
+
+ @param [in] frameNum Index of the frame.
+ @param [out] user Coordinates of the user, in the same system as the coordinates of the sensor.
+
+ @return Nothing.
+*/
+void SyntheticSource::moveUser(int frameNum, userInfo &user)
+{
+	double t = frameNum / (double)SYNTHETIC_FPS;
+	float centerX = WIN_SIZE_X / 2 + 100 * sin(0.4 * t);
+	double angle = 1.2 * t;
+
+	user.headX = centerX;
+	user.headY = 110;
+	user.neckX = centerX;
+	user.neckY = 160;
+
+	// The right side of the user is on the left side of the image, since the image is not flipped yet
+	user.rightShoulderX = centerX - 55;
+	user.rightShoulderY = 170;
+	user.leftShoulderX = centerX + 55;
+	user.leftShoulderY = 170;
+
+	user.rightHipX = centerX - 35;
+	user.rightHipY = 320;
+	user.leftHipX = centerX + 35;
+	user.leftHipY = 320;
+
+	// Both hands turn around their shoulder, in opposite directions
+	user.rightHandX = user.rightShoulderX - 70 + 90 * cos(angle);
+	user.rightHandY = user.rightShoulderY - 60 + 110 * sin(angle);
+	user.leftHandX = user.leftShoulderX + 70 - 90 * cos(angle + M_PI);
+	user.leftHandY = user.leftShoulderY - 60 + 110 * sin(angle + M_PI);
+
+	// The elbows are between the shoulder and the hand, a bit outside
+	user.rightElbowX = (user.rightShoulderX + user.rightHandX) / 2 - 20;
+	user.rightElbowY = (user.rightShoulderY + user.rightHandY) / 2;
+	user.leftElbowX = (user.leftShoulderX + user.leftHandX) / 2 + 20;
+	user.leftElbowY = (user.leftShoulderY + user.leftHandY) / 2;
+}
+
+
+/**
+ Draws the user over the room, in the RGB frame and in the user map.
+
+ @param [in] user Coordinates of the user.
+ @param [out] frameColor RGB frame, in BGR.
+ @param [out] userMap User map (CV_16U).
+
+ @return Nothing.
+*/
+void SyntheticSource::drawUser(const userInfo &user, cv::Mat &frameColor, cv::Mat &userMap)
+{
+	const Scalar clothes(150, 90, 60);
+	const Scalar skin(120, 160, 210);
+
+	// The buffers are only allocated the first time
+	frameRoom.copyTo(frameColor);
+	userMap.create(WIN_SIZE_Y, WIN_SIZE_X, CV_16U);
+	userMap.setTo( Scalar(0) );
+
+	// Body
+	drawLimb( frameColor, userMap, user.neckX, user.neckY, (user.rightHipX + user.leftHipX) / 2, user.rightHipY, 90, clothes );
+	drawLimb( frameColor, userMap, user.rightShoulderX, user.rightShoulderY, user.leftShoulderX, user.leftShoulderY, 30, clothes );
+
+	// Arms
+	drawLimb( frameColor, userMap, user.rightShoulderX, user.rightShoulderY, user.rightElbowX, user.rightElbowY, 22, clothes );
+	drawLimb( frameColor, userMap, user.rightElbowX, user.rightElbowY, user.rightHandX, user.rightHandY, 18, skin );
+	drawLimb( frameColor, userMap, user.leftShoulderX, user.leftShoulderY, user.leftElbowX, user.leftElbowY, 22, clothes );
+	drawLimb( frameColor, userMap, user.leftElbowX, user.leftElbowY, user.leftHandX, user.leftHandY, 18, skin );
+
+	// Legs
+	drawLimb( frameColor, userMap, user.rightHipX, user.rightHipY, user.rightHipX - 10, WIN_SIZE_Y, 30, clothes );
+	drawLimb( frameColor, userMap, user.leftHipX, user.leftHipY, user.leftHipX + 10, WIN_SIZE_Y, 30, clothes );
+
+	// Head
+	circle( frameColor, Point((int)user.headX, (int)user.headY), 32, skin, -1 );
+	circle( userMap, Point((int)user.headX, (int)user.headY), 32, Scalar(1), -1 );
+}
@@ -0,0 +1,40 @@
+/**
+ @file   SyntheticSource.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Source of synthetic frames: a user that moves following a script, without a Kinect sensor.
+*/
+
+#ifndef SYNTHETICSOURCE_H
+#define SYNTHETICSOURCE_H
+
+#include "FrameSource.h"
+
+//Macros
+#define SYNTHETIC_FPS			30
+#define SYNTHETIC_CALIBRATION	15 // Number of frames before the user is tracked
+#define SYNTHETIC_DEPTH			2000 // Distance of the user to the sensor, in millimetres
+
+
+using namespace std;
+
+class SyntheticSource : public FrameSource
+{
+	public:
+		SyntheticSource(bool realTime = true);
+		~SyntheticSource();
+
+		bool readSnapshot(SourceFrame &frame);
+		void reset();
+
+	private:
+		void moveUser(int frameNum, userInfo &user);
+		void drawUser(const userInfo &user, cv::Mat &frameColor, cv::Mat &userMap);
+
+		cv::Mat frameRoom; /** Image of the room without user, drawn only once */
+		int frameIndex; /** Index of the next frame */
+		bool realTime; /** If true, the frames are given at SYNTHETIC_FPS. Otherwise, as fast as they are read */
+		long long nextFrameUsec; /** Moment when the next frame must be given, if the source is real time */
+};
+
+#endif
@@ -0,0 +1,368 @@
+/**
+ @file   TelemetryWriter.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Class to save the skeleton samples of a game in the database and in its session file from a dedicated thread.
+*/
+
+#include "TelemetryWriter.h"
+
+#include <cstring>
+#include <cerrno>
+#include <sys/time.h> // Include for gettimeofday() function
+
+using namespace std;
+
+
+/**
+ Constructor. The thread is not created until @ref start is called.
+
+ @param [in] queueSize Maximum number of samples waiting to be saved. When the queue is full, new samples are dropped.
+ @param [in] batchSize Number of samples saved in every transaction.
+ @param [in] databaseFile Path of the database where the samples are saved.
+*/
+TelemetryWriter::TelemetryWriter(int queueSize, int batchSize, string databaseFile)
+{
+	this->queueSize = queueSize;
+	this->batchSize = batchSize;
+	this->databaseFile = databaseFile;
+
+	queue = new TelemetryEntry[queueSize];
+	head = 0;
+	count = 0;
+
+	running = false;
+	started = false;
+
+	memset(&stats, 0, sizeof(stats));
+
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&samplesReady, NULL);
+}
+
+
+/**
+ Destructor. Saves the pending samples and stops the thread.
+*/
+TelemetryWriter::~TelemetryWriter()
+{
+	stop();
+
+	pthread_cond_destroy(&samplesReady);
+	pthread_mutex_destroy(&mutex);
+
+	delete[] queue;
+}
+
+
+/**
+ Creates the thread that saves the samples in the database.
+
+ @return True if the thread was created, false otherwise.
+*/
+bool TelemetryWriter::start()
+{
+	if(started)
+		return true;
+
+	running = true;
+
+	if( pthread_create(&thread, NULL, writerThread, this) != 0 )
+	{
+		running = false;
+		return false;
+	}
+
+	started = true;
+
+	return true;
+}
+
+
+/**
+ Saves all the samples of the queue and waits until the thread finishes.
+
+ @return Nothing.
+*/
+void TelemetryWriter::stop()
+{
+	if(!started)
+		return;
+
+	// Wakes up the thread so it saves the pending samples and finishes
+	pthread_mutex_lock(&mutex);
+	running = false;
+	pthread_cond_signal(&samplesReady);
+	pthread_mutex_unlock(&mutex);
+
+	pthread_join(thread, NULL);
+
+	started = false;
+}
+
+
+/**
+ Sets the directory where the records of every game are saved, one session file per game. It must be called
+ before @ref start.
+
+ @param [in] directory Directory of the session files. If it is empty, the records are not saved.
+
+ @return Nothing.
+*/
+void TelemetryWriter::setSessionDirectory(string directory)
+{
+	sessionDirectory = directory;
+}
+
+
+/**
+ Adds a sample to the queue. It never waits for the database.
+
+ @param [in] sample Skeleton sample to be saved.
+
+ @return True if the sample was queued, false if it was dropped because the queue is full.
+*/
+bool TelemetryWriter::push(const GameSample &sample)
+{
+	pthread_mutex_lock(&mutex);
+
+	// If the queue is full, the sample is dropped so the game never waits
+	if(count == queueSize)
+	{
+		stats.dropped++;
+		pthread_mutex_unlock(&mutex);
+
+		return false;
+	}
+
+	queue[(head + count) % queueSize].sample = sample;
+	queue[(head + count) % queueSize].hasRecord = false;
+	count++;
+	stats.queued++;
+
+	if(count > stats.highWatermark)
+		stats.highWatermark = count;
+
+	// Wakes up the thread when there are enough samples for a batch
+	if(count >= batchSize)
+		pthread_cond_signal(&samplesReady);
+
+	pthread_mutex_unlock(&mutex);
+
+	return true;
+}
+
+
+/**
+ Adds a sample to the queue, with its record for the session file of the game. It never waits for the database.
+
+ @param [in] sample Skeleton sample to be saved in the database.
+ @param [in] record Record to be appended to the session file of its game.
+
+ @return True if the sample was queued, false if it was dropped because the queue is full.
+*/
+bool TelemetryWriter::push(const GameSample &sample, const SessionRecord &record)
+{
+	pthread_mutex_lock(&mutex);
+
+	// If the queue is full, the sample is dropped so the game never waits
+	if(count == queueSize)
+	{
+		stats.dropped++;
+		pthread_mutex_unlock(&mutex);
+
+		return false;
+	}
+
+	queue[(head + count) % queueSize].sample = sample;
+	queue[(head + count) % queueSize].record = record;
+	queue[(head + count) % queueSize].hasRecord = true;
+	count++;
+	stats.queued++;
+
+	if(count > stats.highWatermark)
+		stats.highWatermark = count;
+
+	// Wakes up the thread when there are enough samples for a batch
+	if(count >= batchSize)
+		pthread_cond_signal(&samplesReady);
+
+	pthread_mutex_unlock(&mutex);
+
+	return true;
+}
+
+
+/**
+ Reports if the database is not keeping up with the game, so the caller can reduce the number of samples.
+
+ @return True if the queue is more than three quarters full, false otherwise.
+*/
+bool TelemetryWriter::isCongested()
+{
+	bool congested;
+
+	pthread_mutex_lock(&mutex);
+	congested = (count * 4 > queueSize * 3);
+	pthread_mutex_unlock(&mutex);
+
+	return congested;
+}
+
+
+/**
+ Gets a copy of the counters of the writer.
+
+ @return A @ref TelemetryStats structure with the counters.
+*/
+TelemetryStats TelemetryWriter::getStats()
+{
+	TelemetryStats copy;
+
+	pthread_mutex_lock(&mutex);
+	copy = stats;
+	copy.pending = count;
+	pthread_mutex_unlock(&mutex);
+
+	return copy;
+}
+
+
+/**
+ Entry point of the thread.
+
+ @param [in] param Pointer to the @ref TelemetryWriter object.
+
+ @return Nothing.
+*/
+void *TelemetryWriter::writerThread(void *param)
+{
+	TelemetryWriter *writer = (TelemetryWriter*)param;
+
+	writer->writeSamples();
+
+	return NULL;
+}
+
+
+/**
+ Loop of the thread. Takes the samples from the queue and saves them in batches, one transaction per batch.
+ A batch is saved when it is full or every @ref TELEMETRY_FLUSH_MS milliseconds. The records of the batch
+ are appended to the session file of their game before the transaction.
+
+ @return Nothing.
+*/
+void TelemetryWriter::writeSamples()
+{
+	// The connection is opened in this thread, so it is never shared with the game
+	Database db1(databaseFile);
+	SessionWriter session;
+	int sessionGame = -1; // Game of the last session file opened, or tried to be opened
+	TelemetryEntry *batch = new TelemetryEntry[batchSize];
+	timeval now;
+	timespec deadline;
+	int samplesNum;
+	int written, failed, recorded;
+
+	while(true)
+	{
+		pthread_mutex_lock(&mutex);
+
+		// Calculates the moment when the samples must be saved even if the batch is not full
+		gettimeofday(&now, NULL);
+		deadline.tv_sec = now.tv_sec + TELEMETRY_FLUSH_MS / 1000;
+		deadline.tv_nsec = now.tv_usec * 1000 + (TELEMETRY_FLUSH_MS % 1000) * 1000000;
+		if(deadline.tv_nsec >= 1000000000)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+
+		// Waits until there are enough samples, the time is over or the writer is stopped
+		while(running && count < batchSize)
+		{
+			if( pthread_cond_timedwait(&samplesReady, &mutex, &deadline) == ETIMEDOUT )
+				break;
+		}
+
+		// If the writer was stopped and all the samples were saved, the thread finishes
+		if(!running && count == 0)
+		{
+			pthread_mutex_unlock(&mutex);
+			break;
+		}
+
+		// Takes a batch of samples from the queue
+		samplesNum = (count < batchSize) ? count : batchSize;
+		for(int i = 0; i < samplesNum; i++)
+			batch[i] = queue[(head + i) % queueSize];
+
+		head = (head + samplesNum) % queueSize;
+		count -= samplesNum;
+
+		pthread_mutex_unlock(&mutex);
+
+		if(samplesNum == 0)
+			continue;
+
+		// Appends the records to the session file of their game. A new game starts a new file
+		recorded = 0;
+
+		for(int i = 0; i < samplesNum && !sessionDirectory.empty(); i++)
+		{
+			if(!batch[i].hasRecord)
+				continue;
+
+			// If the file of the game cannot be created, it is not tried again for every record
+			if( sessionGame != batch[i].record.gameId )
+			{
+				sessionGame = batch[i].record.gameId;
+				session.open(SessionWriter::fileName(sessionDirectory, sessionGame), sessionGame);
+			}
+
+			if( session.append(batch[i].record) )
+				recorded++;
+		}
+
+		// Saves the whole batch in a single transaction
+		written = 0;
+		failed = 0;
+
+		// If the transaction cannot be started, the samples are not inserted one by one outside of it
+		if( !db1.beginTransaction() )
+		{
+			failed = samplesNum;
+		}
+		else
+		{
+			for(int i = 0; i < samplesNum; i++)
+			{
+				if( db1.insertGameData(batch[i].sample) )
+					written++;
+				else
+					failed++;
+			}
+
+			// If the transaction cannot be committed, none of the samples was saved
+			if( !db1.commitTransaction() )
+			{
+				db1.rollbackTransaction();
+				written = 0;
+				failed = samplesNum;
+			}
+		}
+
+		pthread_mutex_lock(&mutex);
+		stats.written += written;
+		stats.failed += failed;
+		stats.sessionRecords += recorded;
+		stats.batches++;
+		stats.database = db1.getStats();
+		pthread_mutex_unlock(&mutex);
+	}
+
+	// Writes the index of the session file
+	session.close();
+
+	delete[] batch;
+}
@@ -0,0 +1,95 @@
+/**
+ @file   TelemetryWriter.h
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Class to save the skeleton samples of a game in the database and in its session file from a dedicated thread.
+*/
+
+#ifndef TELEMETRYWRITER_H
+#define TELEMETRYWRITER_H
+
+#include <pthread.h> // Include for POSIX threads
+
+#include "Database.h"
+#include "SessionFile.h"
+
+//Macros
+#define TELEMETRY_QUEUE_SIZE	1024
+#define TELEMETRY_BATCH_SIZE	64
+#define TELEMETRY_FLUSH_MS		250
+
+
+using namespace std;
+
+/** Counters of the telemetry writer */
+struct TelemetryStats
+{
+	/* Number of samples accepted in the queue. */
+	unsigned long queued;
+	/* Number of samples saved in the database. */
+	unsigned long written;
+	/* Number of samples discarded because the queue was full. */
+	unsigned long dropped;
+	/* Number of samples that the database refused. */
+	unsigned long failed;
+	/* Number of records saved in the session files. */
+	unsigned long sessionRecords;
+	/* Number of transactions committed. */
+	unsigned long batches;
+	/* Waits of the connection of the writer for the locks of other programs. */
+	DatabaseStats database;
+	/* Number of samples waiting in the queue. */
+	int pending;
+	/* Maximum number of samples that have been waiting in the queue at the same time. */
+	int highWatermark;
+};
+
+/** Sample waiting in the queue of the telemetry writer */
+struct TelemetryEntry
+{
+	/* Sample saved in the database */
+	GameSample sample;
+	/* Record saved in the session file of the game */
+	SessionRecord record;
+	/* True if the record must be saved */
+	bool hasRecord;
+};
+
+
+class TelemetryWriter
+{
+	public:
+		TelemetryWriter(int queueSize = TELEMETRY_QUEUE_SIZE, int batchSize = TELEMETRY_BATCH_SIZE, string databaseFile = DATABASE_FILE);
+		~TelemetryWriter();
+
+		bool start();
+		void stop();
+		void setSessionDirectory(string directory);
+		bool push(const GameSample &sample);
+		bool push(const GameSample &sample, const SessionRecord &record);
+		bool isCongested();
+		TelemetryStats getStats();
+
+	private:
+		static void *writerThread(void *param);
+		void writeSamples();
+
+		pthread_t thread; /** Thread where the samples are saved */
+		pthread_mutex_t mutex; /** Protects the queue and the counters */
+		pthread_cond_t samplesReady; /** Signaled when a batch of samples is ready to be saved */
+
+		TelemetryEntry *queue; /** Circular buffer with the samples waiting to be saved */
+		int queueSize; /** Maximum number of samples in the queue */
+		int batchSize; /** Number of samples saved in every transaction */
+		string databaseFile; /** Path of the database where the samples are saved */
+		string sessionDirectory; /** Directory of the session files. Empty if the records are not saved */
+		int head; /** Position of the oldest sample of the queue */
+		int count; /** Number of samples in the queue */
+
+		bool running; /** False when the thread must save the pending samples and finish */
+		bool started; /** True if the thread was created */
+
+		TelemetryStats stats;
+};
+
+#endif
@@ -0,0 +1,169 @@
+/**
+ @file   bench.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Benchmark of the per-frame cost of the background replacement, without a Kinect sensor.
+*/
+
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include "cvaux.h" // Include for OpenCV
+#include "highgui.h" // Include for OpenCV
+
+#include "ChromaKey.h"
+
+//Macros
+#define BENCH_SIZE_X	640
+#define BENCH_SIZE_Y	480
+#define BENCH_FRAMES	200
+
+
+using namespace std;
+using namespace cv;
+
+
+/**
+ Draws a synthetic user map: an ellipse that moves from side to side, as if it were a user.
+
+ @param [out] userMap User map to be drawn.
+ @param [in] frameNum Number of the frame, used to move the user.
+
+ @return Nothing.
+*/
+void drawUserMap(Mat &userMap, int frameNum)
+{
+	int centerX = BENCH_SIZE_X / 2 + (int)(150 * sin(frameNum * 0.05));
+
+	userMap.setTo( Scalar(0) );
+	ellipse( userMap, Point(centerX, BENCH_SIZE_Y / 2), Size(90, 200), 0, 0, 360, Scalar(1), -1 );
+}
+
+
+/**
+ Background replacement as it was done before: the background is scaled in every frame, and a circle
+ of radius 1 is drawn for every pixel without user.
+
+ @param [out] frameColor Frame where the background is drawn.
+ @param [in] frameImageLoaded Image to show in the background.
+ @param [in] userMap User map of the frame.
+
+ @return Nothing.
+*/
+void legacyChroma(Mat &frameColor, Mat frameImageLoaded, const Mat &userMap)
+{
+	Vec3b color;
+	Mat frameChroma;
+
+	resize(frameImageLoaded, frameChroma, Size(BENCH_SIZE_X, BENCH_SIZE_Y));
+
+	for (int y = 0; y < userMap.rows; y++)
+	{
+		for (int x = 0; x < userMap.cols; x++)
+		{
+			if (userMap.at<unsigned short>(y, x) == 0)
+			{
+				color = frameChroma.at<Vec3b>(cv::Point(x, y));
+				circle(frameColor, cv::Point(x, y), 1, cv::Scalar(color[0],color[1],color[2]), -1);
+			}
+		}
+	}
+}
+
+
+int main(int argc, char *argv[])
+{
+	int framesNum = BENCH_FRAMES;
+	int64 ticks;
+	double legacyMs, chromaMs, stepsMs, singlePassMs;
+
+	// The number of frames can be passed as argument
+	if (argc == 2)
+		framesNum = atoi(argv[1]);
+
+	if (framesNum <= 0)
+	{
+		cout << "Usage: " << argv[0] << " [frames]" << endl;
+		return -1;
+	}
+
+	// Loads the background image. If it cannot be loaded, a synthetic one is used
+	Mat frameImageLoaded = imread("./img/background.jpg", CV_LOAD_IMAGE_COLOR);
+	if (frameImageLoaded.empty())
+	{
+		frameImageLoaded.create(BENCH_SIZE_Y / 2, BENCH_SIZE_X / 2, CV_8UC3);
+		randu(frameImageLoaded, Scalar::all(0), Scalar::all(255));
+	}
+
+	Mat frameCamera(BENCH_SIZE_Y, BENCH_SIZE_X, CV_8UC3);
+	randu(frameCamera, Scalar::all(0), Scalar::all(255));
+
+	Mat frameColor;
+	Mat userMap(BENCH_SIZE_Y, BENCH_SIZE_X, CV_16U);
+	ChromaKey chroma;
+
+	cout << "Background replacement, " << BENCH_SIZE_X << "x" << BENCH_SIZE_Y << ", " << framesNum << " frames, " << getNumThreads() << " threads" << endl;
+
+	// Measures the previous implementation
+	ticks = 0;
+	for (int i = 0; i < framesNum; i++)
+	{
+		drawUserMap(userMap, i);
+		frameCamera.copyTo(frameColor);
+
+		int64 start = getTickCount();
+		legacyChroma(frameColor, frameImageLoaded, userMap);
+		ticks += getTickCount() - start;
+	}
+	legacyMs = ticks * 1000.0 / getTickFrequency() / framesNum;
+
+	// Measures the current implementation
+	ticks = 0;
+	for (int i = 0; i < framesNum; i++)
+	{
+		drawUserMap(userMap, i);
+		frameCamera.copyTo(frameColor);
+
+		int64 start = getTickCount();
+		chroma.setBackground(frameImageLoaded);
+		chroma.apply(frameColor, (const unsigned short*)userMap.data, userMap.cols, userMap.rows, (int)userMap.step);
+		ticks += getTickCount() - start;
+	}
+	chromaMs = ticks * 1000.0 / getTickFrequency() / framesNum;
+
+	// Measures the whole camera pipeline done in steps: conversion, background and mirror
+	Mat frameFlipped;
+	ticks = 0;
+	for (int i = 0; i < framesNum; i++)
+	{
+		drawUserMap(userMap, i);
+
+		int64 start = getTickCount();
+		cvtColor(frameCamera, frameColor, CV_RGB2BGR);
+		chroma.apply(frameColor, (const unsigned short*)userMap.data, userMap.cols, userMap.rows, (int)userMap.step);
+		flip(frameColor, frameFlipped, 1);
+		ticks += getTickCount() - start;
+	}
+	stepsMs = ticks * 1000.0 / getTickFrequency() / framesNum;
+
+	// Measures the same pipeline in a single pass
+	ticks = 0;
+	for (int i = 0; i < framesNum; i++)
+	{
+		drawUserMap(userMap, i);
+
+		int64 start = getTickCount();
+		chroma.applyMirrored(frameCamera, true, (const unsigned short*)userMap.data, userMap.cols, userMap.rows, (int)userMap.step, frameFlipped);
+		ticks += getTickCount() - start;
+	}
+	singlePassMs = ticks * 1000.0 / getTickFrequency() / framesNum;
+
+	cout << "insertChroma with cv::circle: " << legacyMs << " ms/frame" << endl;
+	cout << "ChromaKey::apply:             " << chromaMs << " ms/frame" << endl;
+	cout << "Speedup:                      " << legacyMs / chromaMs << "x" << endl;
+	cout << "cvtColor + apply + flip:      " << stepsMs << " ms/frame" << endl;
+	cout << "ChromaKey::applyMirrored:     " << singlePassMs << " ms/frame" << endl;
+	cout << "Speedup:                      " << stepsMs / singlePassMs << "x" << endl;
+
+	return 0;
+}
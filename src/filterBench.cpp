@@ -0,0 +1,125 @@
+/**
+ @file   filterBench.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Check of the accuracy of the filters of the joints, without a Kinect sensor: a noisy joint that stands
+ 	still and then moves at a constant speed.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+
+#include "JointFilter.h"
+
+//Macros
+#define FILTER_BENCH_FRAMES		300 // Frames of the check. The joint stands still in the first half
+#define FILTER_BENCH_FRAME_US	33333 // Time between two frames, in microseconds (30 fps)
+#define FILTER_BENCH_POSITION	300.0f // Position of the joint while it stands still, in pixels
+#define FILTER_BENCH_SPEED		20.0f // Movement of the joint in every frame of the second half, in pixels (600 pixels/second)
+#define FILTER_BENCH_NOISE		3 // Largest error of the tracker, in pixels
+#define FILTER_BENCH_SETTLE		100 // Frames of each half not measured, while the filter settles
+
+
+using namespace std;
+
+
+/**
+ Gets the real position of the joint in a frame.
+
+ @param [in] frame Number of the frame.
+
+ @return Position of the joint, in pixels.
+*/
+float truePosition(int frame)
+{
+	int half = FILTER_BENCH_FRAMES / 2;
+
+	if (frame < half)
+		return FILTER_BENCH_POSITION;
+
+	return FILTER_BENCH_POSITION + (frame - half) * FILTER_BENCH_SPEED;
+}
+
+
+/**
+ Runs a filter over the noisy joint and measures its mean error. While the joint stands still, the error is
+ measured against its position. While it moves, it is measured against its position in the next frame, which
+ is the one a filter with a lead of one frame should predict.
+
+ @param [in] text Filter, in the format of the environment variable KINECT_FILTER.
+
+ @return True if the filter is valid, false otherwise.
+*/
+bool runFilter(const char *text)
+{
+	JointFilterConfig config;
+	JointFilter filter;
+	UserSkeleton skeleton;
+	int half = FILTER_BENCH_FRAMES / 2;
+	double stillError = 0, movingError = 0;
+	int stillNum = 0, movingNum = 0;
+
+	if ( !JointFilter::parseConfig(text, config) )
+	{
+		cout << "ERROR: Invalid joint filter: " << text << endl;
+		return false;
+	}
+
+	filter.setConfig(config);
+
+	// The same noise for every filter, so they are compared with the same input
+	srand(3);
+
+	for (int i = 0; i < FILTER_BENCH_FRAMES; i++)
+	{
+		clearSkeleton(skeleton);
+		skeleton.windowX[SKELETON_RIGHT_HAND] = truePosition(i) + (rand() % (2 * FILTER_BENCH_NOISE + 1) - FILTER_BENCH_NOISE);
+		skeleton.windowY[SKELETON_RIGHT_HAND] = FILTER_BENCH_POSITION;
+		skeleton.valid = 1u << SKELETON_RIGHT_HAND;
+
+		filter.apply(&skeleton, 1, (unsigned long long)i * FILTER_BENCH_FRAME_US);
+
+		if (i >= FILTER_BENCH_SETTLE && i < half)
+		{
+			stillError += fabs(skeleton.windowX[SKELETON_RIGHT_HAND] - truePosition(i));
+			stillNum++;
+		}
+		else if (i >= half + FILTER_BENCH_SETTLE / 2)
+		{
+			movingError += fabs(skeleton.windowX[SKELETON_RIGHT_HAND] - truePosition(i + 1));
+			movingNum++;
+		}
+	}
+
+	cout << setw(24) << left << text << right << fixed << setprecision(2)
+		<< setw(12) << stillError / stillNum << setw(12) << movingError / movingNum << endl;
+
+	return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+	const char *defaultFilters[] = {"none", "oneeuro", "oneeuro:1:0.01:33", "kalman", "kalman:250000:9:33"};
+	bool rc = true;
+
+	cout << "Noisy joint (+/-" << FILTER_BENCH_NOISE << " px) still, then moving at " << FILTER_BENCH_SPEED * 1000000 / FILTER_BENCH_FRAME_US
+		<< " px/s, " << 1000000 / FILTER_BENCH_FRAME_US << " fps" << endl;
+	cout << setw(24) << left << "Filter" << right << setw(12) << "Still (px)" << setw(12) << "Next (px)" << endl;
+
+	// Arguments: [filter...], in the format of KINECT_FILTER. By default, the filters are compared with their default parameters
+	if (argc > 1)
+	{
+		for (int i = 1; i < argc; i++)
+			rc = runFilter(argv[i]) && rc;
+	}
+	else
+	{
+		for (unsigned int i = 0; i < sizeof(defaultFilters) / sizeof(defaultFilters[0]); i++)
+			rc = runFilter(defaultFilters[i]) && rc;
+	}
+
+	return rc ? 0 : -1;
+}
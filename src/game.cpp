@@ -8,12 +8,18 @@
 #include <sstream>
 #include <ctime>
 #include <cmath>
+#include <cstring> // Include for strcmp() function
 #include "cvaux.h" // Include for OpenCV
 #include "highgui.h" // Include for OpenCV
 
 #include "Kinect.h"
 #include "Database.h"
 #include "Graphics.h"
+#include "TelemetryWriter.h"
+#include "FrameCapture.h"
+#include "SyntheticSource.h"
+#include "Profiler.h"
+#include "GameSimulation.h"
 
 using namespace cv;
 using namespace std;
@@ -42,19 +48,6 @@ const string getDate()
 }
 
 
-/**
- Gets the value in usec from a timeval struct.
-
- @param [in] tval Timeval struct.
-
- @return The value in usec of the timeval struct.
-*/
-long int getTimevalUsec(timeval tval)
-{
-	return ((tval.tv_sec * 1000000) + tval.tv_usec);
-}
-
-
 /**
  Converts a integer in a string.
 
@@ -76,41 +69,72 @@ int main(int argc, char** argv)
 {
 	Mat frameChroma = imread("./img/background.jpg", CV_LOAD_IMAGE_COLOR); // Loads background image
 	Mat frameColor; // Frame to store the image from the RGB camera
-	Mat frameColorFlipped; // Auxiliary frame used to flip the color frame.
+	CapturedFrame *capturedFrame; // Newest frame read by the capture thread
+	Mat frameColorFlipped; // Auxiliary frame used to flip the color frame, if the capture thread did not flip it
+	userInfo usersInfo[MAX_USERS]; // Coordinates and state of the users in the current frame
+	int usersNumber = 0; // Number of users in the current frame
 
 	Mode mode = STARTING; // By default, the mode is starting
 	UserState uState = USER_NOT_FOUND; // Saves the state of the user
 	const char* deviceURI; // Uniform Resource Identifier of the device
 
-	timeval currentTimeGame; // Current moment
-	timeval initTimeGame; // Moment when the game is started
-	timeval totalTimeGame = (struct timeval){0}; // Current duration of the game
-	timeval initTimeFruit; // Moment when the fruit was drawn
-	timeval initTimePause; // Moment when the pause mode was activated
-	timeval durationTimePause = (struct timeval){0}; // Duration of a pause
-	timeval accumulatedTimePause = (struct timeval){0}; // Total duration of all the pauses of the game
+	long long nowUsec; // Moment of the current frame, in microseconds of the monotonic clock
 
 	string idUser = ""; // ID of the user playing
-	int score[2] = {0, 0}; // Game score (score[0] successes, score[1] failures)
-	int tableSize = 0; // Size of a table of the database
+	int gameId = 0; // ID of the game being played, used to save its data
+	int frameNumber = 0; // Number of the next sample of the game
+	GameSample sample; // Skeleton sample to be saved in the database
+	SessionRecord record; // Skeleton sample to be saved in the session file of the game
+	TelemetryStats telemetryStats; // Counters of the telemetry writer
+	CaptureStats captureStats; // Counters of the capture thread
+	JointFilterConfig filterConfig; // Parameters of the filter of the joints
+	DatabaseConfig databaseConfig; // Settings of the connections to the database
+	FrameDamage graphicsDamage; // Counters of the areas drawn by the graphics
+	int stageWait, stageGame, stageDatabase, stageShow, stageKey; // Stages of the frame measured by the profiler
 	string startDate; // Date when the game started
 	string endDate; // Date when the game finished
-	bool fruitIntersected = false; // Flag indicating if a fruit was intersected
 	bool rc = false;
-	float fruitX = 460, fruitY = 40; //Coger estos valores de clase Graphics
 	int fruitDuration = 3; // Duration of the fruit (3 seconds by default)
 	int maxDuration = 60; // Duration of the game (60 seconds by default)
-	unsigned long long int fruitClockProgress = 0;
 	char key = ' '; // Saves the keyboard input
 
-	Kinect *kinect1 = new Kinect();
-	Database *db1 = new Database();
+	Kinect *kinect1 = NULL; // Kinect sensor, or recorded file. NULL if the frames are synthetic
+	SyntheticSource *synthetic = NULL; // Generator of synthetic frames, used to run the game without a sensor
+	FrameSource *source; // Source of the frames of the game
+	FrameCapture *capture;
+	GameSimulation *simulation; // Rules of the game: fruits, score, pauses and duration
+	Database *db1; // Connection of the game, opened when the settings of the database are known
 	Graphics *graphics = new Graphics();
+	Profiler *profiler = new Profiler();
+	TelemetryWriter *telemetry = new TelemetryWriter();
+
 
 
+	// Chooses the settings of the database: 'synchronous[:checkpointPages[:busyTimeoutMs[:busyRetries]]]'
+	if(getenv("KINECT_DATABASE") != NULL)
+	{
+		if(Database::parseConfig(getenv("KINECT_DATABASE"), databaseConfig))
+			Database::setConfig(databaseConfig);
+		else
+			cout<<"ERROR: Invalid database settings: "<<getenv("KINECT_DATABASE")<<endl;
+	}
 
-	// Initializes OpenNI and NiTE
-	kinect1->init();
+	db1 = new Database();
+
+	// If the synthetic source is chosen, the game runs without a sensor
+	if(argc == 2 && strcmp(argv[1], "--synthetic") == 0)
+	{
+		synthetic = new SyntheticSource();
+		source = synthetic;
+	}
+	else
+	{
+		kinect1 = new Kinect();
+		source = kinect1;
+
+		// Initializes OpenNI and NiTE
+		kinect1->init();
+	}
 
 	// If a *.oni file is passed as a parameter
 	if(argc == 2)
@@ -136,35 +160,70 @@ int main(int argc, char** argv)
 		}
 	}
 
-	// Opens the device
-	rc = kinect1->openDevice(deviceURI);
-	if( !rc )
-	{
-		cout<<"ERROR: Device open failed."<<endl;
-		return 0;
-	}
+	// The rules of the game run with a fixed tick, independent of the frames shown
+	simulation = new GameSimulation(graphics, maxDuration, fruitDuration);
 
-	// Creates and starts the depth stream
-	rc = kinect1->createDepthStream();
-	if( !rc )
+	if(kinect1 != NULL)
 	{
-		cout<<"ERROR: Create depth stream failed."<<endl;
-		return 0;
-	}
+		// Opens the device
+		rc = kinect1->openDevice(deviceURI);
+		if( !rc )
+		{
+			cout<<"ERROR: Device open failed."<<endl;
+			return 0;
+		}
 
-	// Creates and starts the RBG stream
-	rc = kinect1->createColorStream();
-	if( !rc )
-	{
-		cout<<"ERROR: Create RGB stream failed."<<endl;
-		return 0;
-	}
+		// Creates and starts the depth stream
+		rc = kinect1->createDepthStream();
+		if( !rc )
+		{
+			cout<<"ERROR: Create depth stream failed."<<endl;
+			return 0;
+		}
+
+		// Creates and starts the RBG stream
+		rc = kinect1->createColorStream();
+		if( !rc )
+		{
+			cout<<"ERROR: Create RGB stream failed."<<endl;
+			return 0;
+		}
 
-	// Sinchronyzes the RGB and depth sensors
-	kinect1->syncDepthColor();
+		// Sinchronyzes the RGB and depth sensors
+		kinect1->syncDepthColor();
 
-	// Starts users tracking
-	kinect1->startUserTracking();
+		// Starts users tracking
+		kinect1->startUserTracking();
+
+		// Chooses the filter of the joints: 'none', 'oneeuro[:minCutoff[:beta[:leadMs]]]' or 'kalman[:processNoise[:measurementNoise[:leadMs]]]'
+		if(getenv("KINECT_FILTER") != NULL)
+		{
+			if(JointFilter::parseConfig(getenv("KINECT_FILTER"), filterConfig))
+				kinect1->setJointFilter(filterConfig);
+			else
+				cout<<"ERROR: Invalid joint filter: "<<getenv("KINECT_FILTER")<<endl;
+		}
+	}
+
+	// Starts the thread that saves the data of the game in the database and in its session file
+	telemetry->setSessionDirectory(SESSION_DIRECTORY);
+	telemetry->start();
+
+	// Adds the stages of the frame to the profiler. The times are recorded from the beginning if
+	// KINECT_PROFILE is set, or after the 'T' key is pressed
+	stageWait = profiler->addStage("wait frame");
+	stageGame = profiler->addStage("game");
+	stageDatabase = profiler->addStage("database");
+	stageShow = profiler->addStage("imshow");
+	stageKey = profiler->addStage("waitKey");
+	graphics->setProfiler(profiler);
+	profiler->setEnabled(getenv("KINECT_PROFILE") != NULL);
+
+	// Starts the thread that reads the frames, inserting the background image in every frame
+	capture = new FrameCapture(source);
+	capture->setBackground(frameChroma);
+	capture->setProfiler(profiler);
+	capture->start();
 
 	// Sets the name of the window
 	namedWindow("Sistema Kinect para el desarrollo de la motricidad gruesa", CV_WINDOW_AUTOSIZE);
@@ -173,54 +232,65 @@ int main(int argc, char** argv)
 	// Infinite loop
 	while(true)
 	{
-		// Gets the current moment in the time
-		gettimeofday(&currentTimeGame, NULL);
-
-		// Gets the next snapshot of the skeleton tracking algorithm
-		if (!kinect1->readTrackerFrame())
+		// Takes the newest frame read by the capture thread, with the background already inserted
+		ProfileScope waitScope(profiler, stageWait);
+		capturedFrame = capture->acquireLatestFrame();
+		if (capturedFrame == NULL)
 		{
 			cout<<"Get next frame failed!"<<endl;
 			continue;
 		}
+		waitScope.stop();
 
-		// Reads a frame from the RGB camera and store it in 'frameColor'
-		kinect1->readFrame(frameColor, NI_SENSOR_COLOR);
+		// Gets the current moment in the time
+		nowUsec = GameSimulation::monotonicUsec();
 
-		// Inserts a background image, as if it were a chroma
-		kinect1->insertChroma(frameColor, frameChroma);
+		ProfileScope gameScope(profiler, stageGame);
 
-		// Detects the users and stores the coordinates of the joints
-		kinect1->usersManagement();
+		// The graphics are drawn directly in the frame of the capture thread, which is already a mirror.
+		// The frame is held until it is shown
+		if (capturedFrame->mirrored)
+		{
+			frameColor = capturedFrame->frameColor;
+		}
+		else
+		{
+			// Flips the RGB frame so the image looks like a mirror
+			cv::flip(capturedFrame->frameColor, frameColorFlipped, 1);
+			frameColor = frameColorFlipped;
+		}
 
-		// Flips the RGB frame so the image looks like a mirror
-		cv::flip(frameColor, frameColorFlipped, 1);
-		frameColor = frameColorFlipped;
+		// Copies the coordinates of the joints
+		memcpy(usersInfo, capturedFrame->usersInfo, sizeof(usersInfo));
+		usersNumber = capturedFrame->usersNumber;
 
+		// Starts counting the areas drawn over the new frame
+		graphics->beginFrame();
 
 		// For each user detected
-		for (int i = 0; i < kinect1->getUsersNumber(); i++)
+		for (int i = 0; i < usersNumber; i++)
 		{
 			// If the user is been tracking
-			if( kinect1->usersInfo[i].userState == TRACKING )
+			if( usersInfo[i].userState == TRACKING )
 			{
 				// If the right hand coordinates are available
-				if(kinect1->usersInfo[i].rightHandX != -1)
+				if(usersInfo[i].rightHandX != -1)
 				{
 					// Shows a marker around the right hand
 					if(mode == GAME)
-						graphics->showGameJoint(frameColor, kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY);
+						graphics->showGameJoint(frameColor, usersInfo[i].rightHandX, usersInfo[i].rightHandY);
 					else if(mode == SCORE_SCREEN)
-						graphics->showSelectJoint(frameColor, kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY);
+						graphics->showSelectJoint(frameColor, usersInfo[i].rightHandX, usersInfo[i].rightHandY);
 				}
 
 				// If the left hand coordinates are available
-				if(kinect1->usersInfo[i].leftHandX != -1)
+				if(usersInfo[i].leftHandX != -1)
 				{
 					// Shows a marker around the left hand
 					if(mode == GAME)
-						graphics->showGameJoint(frameColor, kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY);
+						graphics->showGameJoint(frameColor, usersInfo[i].leftHandX, usersInfo[i].leftHandY);
 					else if(mode == SCORE_SCREEN)
-						graphics->showSelectJoint(frameColor, kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY);
+						graphics->showSelectJoint(frameColor, usersInfo[i].leftHandX, usersInfo[i].leftHandY);
 				}
 
 
@@ -229,53 +299,73 @@ int main(int argc, char** argv)
 					// Saves the date and hour when the game has started
 					startDate = getDate();
 
-					// Saves the moment when the game has started
-					gettimeofday(&initTimeGame, NULL);
+					// Saves the game now, so its ID is reserved before its samples are saved. Without an ID, they are not saved
+					if( !db1->insertGame(idUser, startDate, gameId) )
+					{
+						cout<<"ERROR: The game couldn't be saved in the database, so its samples won't be saved."<<endl;
+						gameId = -1;
+					}
+					frameNumber = 0;
 
-					// Saves the moment when the first fruit has been drawn 
-					gettimeofday(&initTimeFruit, NULL);
+					// Starts the game from this moment, with the score at zero
+					simulation->start(nowUsec);
 
 					// Starts the game
 					mode = GAME;
 				}
 
-				if(mode == GAME)
+				if(mode == GAME && gameId >= 0)
 				{
-					// Gets the size of the 'games' table. This way, we can know which the game id must be
-					db1->getGameTableSize(tableSize);
-
-					// Inserts the data of the game in this moment in the database
-					db1->insertGameData(totalTimeGame.tv_sec, tableSize, fruitX, fruitY, kinect1->usersInfo[i].headX, kinect1->usersInfo[i].headY, kinect1->usersInfo[i].neckX, kinect1->usersInfo[i].neckY, kinect1->usersInfo[i].leftShoulderX, kinect1->usersInfo[i].leftShoulderY, kinect1->usersInfo[i].rightShoulderX, kinect1->usersInfo[i].rightShoulderY, kinect1->usersInfo[i].leftElbowX, kinect1->usersInfo[i].leftElbowY, kinect1->usersInfo[i].rightElbowX, kinect1->usersInfo[i].rightElbowY, kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY, kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY, kinect1->usersInfo[i].leftHipX, kinect1->usersInfo[i].leftHipY, kinect1->usersInfo[i].rightHipX, kinect1->usersInfo[i].rightHipY);
-
-					// Calculates intersection between right hand and fruit image
-					if( graphics->intersectionFruit(kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY) )
-					{
-						fruitIntersected = true;
-						break;
-					}
-					// Calculates intersection between left hand and fruit image
-					else if( graphics->intersectionFruit(kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY) )
-					{
-						fruitIntersected = true;
-						break;
-					}
+					// Queues the data of the game in this moment, to be saved in the database by the telemetry writer
+					sample.time = simulation->getElapsedSeconds();
+					sample.gameId = gameId;
+					sample.frame = frameNumber++;
+					sample.fruitX = simulation->getFruitX();
+					sample.fruitY = simulation->getFruitY();
+					sample.headX = usersInfo[i].headX;
+					sample.headY = usersInfo[i].headY;
+					sample.neckX = usersInfo[i].neckX;
+					sample.neckY = usersInfo[i].neckY;
+					sample.leftShoulderX = usersInfo[i].leftShoulderX;
+					sample.leftShoulderY = usersInfo[i].leftShoulderY;
+					sample.rightShoulderX = usersInfo[i].rightShoulderX;
+					sample.rightShoulderY = usersInfo[i].rightShoulderY;
+					sample.leftElbowX = usersInfo[i].leftElbowX;
+					sample.leftElbowY = usersInfo[i].leftElbowY;
+					sample.rightElbowX = usersInfo[i].rightElbowX;
+					sample.rightElbowY = usersInfo[i].rightElbowY;
+					sample.leftHandX = usersInfo[i].leftHandX;
+					sample.leftHandY = usersInfo[i].leftHandY;
+					sample.rightHandX = usersInfo[i].rightHandX;
+					sample.rightHandY = usersInfo[i].rightHandY;
+					sample.leftHipX = usersInfo[i].leftHipX;
+					sample.leftHipY = usersInfo[i].leftHipY;
+					sample.rightHipX = usersInfo[i].rightHipX;
+					sample.rightHipY = usersInfo[i].rightHipY;
+
+					// The session file keeps all the joints, with the timestamp of the frame
+					record.timestamp = capturedFrame->timestamp;
+					record.gameTime = simulation->getElapsedUsec();
+					record.gameId = gameId;
+					record.user = i;
+					record.fruitX = sample.fruitX;
+					record.fruitY = sample.fruitY;
+					record.skeleton = capturedFrame->skeletons[i];
+					record.reserved = 0;
+					telemetry->push(sample, record);
 				}
 				else if(mode == SCORE_SCREEN)
 				{
 					// Calculates intersection between any hand and the "new game" button
-					if( graphics->intersectionNewGameButton(kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY) 
-						|| graphics->intersectionNewGameButton(kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY) )
+					if( graphics->intersectionNewGameButton(usersInfo[i].rightHandX, usersInfo[i].rightHandY) 
+						|| graphics->intersectionNewGameButton(usersInfo[i].leftHandX, usersInfo[i].leftHandY) )
 					{
-						// Resets score
-						score[0] = 0;
-						score[1] = 0;
-
-						// Changes mode to "game mode"
+						// Changes mode to "game mode". The score is reset when the game starts
 						mode = STARTING;
 					}
 					// Calculates intersection between any hand and the "exit" button
-					else if( graphics->intersectionExitButton(kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY) 
-						|| graphics->intersectionExitButton(kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY) )
+					else if( graphics->intersectionExitButton(usersInfo[i].rightHandX, usersInfo[i].rightHandY) 
+						|| graphics->intersectionExitButton(usersInfo[i].leftHandX, usersInfo[i].leftHandY) )
 					{
 						mode = LEAVING;
 					}
@@ -285,23 +375,23 @@ int main(int argc, char** argv)
 
 
 		// Sets the user state
-		if(kinect1->getUsersNumber() == 0) // If no user has been detected ever
+		if(usersNumber == 0) // If no user has been detected ever
 		{
 			uState = USER_NOT_FOUND;
 			
 		}
 		else
 		{
-			for(int j = 0; j < kinect1->getUsersNumber(); j++)
+			for(int j = 0; j < usersNumber; j++)
 			{
 				// If the user is being tracked
-				if(kinect1->usersInfo[j].leftHandY != -1 || kinect1->usersInfo[j].rightHandY != -1)
+				if(usersInfo[j].leftHandY != -1 || usersInfo[j].rightHandY != -1)
 				{
-					uState = kinect1->usersInfo[j].userState;
+					uState = usersInfo[j].userState;
 
 					break;
 				}
-				else if(j == kinect1->getUsersNumber()-1) //Si es el último usuario y no hay ninguno activo
+				else if(j == usersNumber-1) //Si es el último usuario y no hay ninguno activo
 				{
 					uState = USER_NOT_FOUND;
 
@@ -312,97 +402,57 @@ int main(int argc, char** argv)
 		}
 
 
+		// Runs the ticks of the game until the moment of the frame. The hands of the frame are checked against the fruit in every tick
+		simulation->setHands(usersInfo, usersNumber, nowUsec);
+		simulation->advance(nowUsec);
+
 		if(mode == GAME)
 		{
 			// If the playing time is over
-			if( getTimevalUsec(currentTimeGame) - getTimevalUsec(initTimeGame) - getTimevalUsec(accumulatedTimePause) > (maxDuration*1000000) )
+			if( simulation->getState() == SIMULATION_OVER )
 			{
 				// Changes to score screen
 				mode = SCORE_SCREEN;
 				// Stores the date when the game ended.
 				endDate = getDate();
+
+				// Saves the score of the game and adds it to the score of the user, if the user is identified
+				ProfileScope databaseScope(profiler, stageDatabase);
+
+				db1->updateGame(gameId, endDate, simulation->getSuccesses(), simulation->getFailures());
+
+				if(idUser != "")
+					db1->updateUserTotalScore(idUser, simulation->getSuccesses(), simulation->getFailures());
 			}
 			// Else, if the game continues
 			else
 			{
-				// If the fruit image was intersected
-				if(fruitIntersected)
-				{
-					// Increases the successes score
-					score[0]++;
-
-					// Creates a new fruit
-					graphics->changeFruit(fruitX, fruitY);
-
-					// Saves the moment when the new fruit has been drawn 
-					gettimeofday(&initTimeFruit, NULL);
-
-					// As the fruit is new, the delay by the pause is reset
-					durationTimePause = (struct timeval){0};
-
-					// Resets the 'fruitIntersected' flag to false
-					fruitIntersected = false;
-				}
-				// If the fruit time is end
-				else if( currentTimeGame.tv_sec - initTimeFruit.tv_sec - durationTimePause.tv_sec > (fruitDuration) )
-				{
-					// Increases the failures score
-					score[1]++;
-
-					// Creates a new fruit
-					graphics->changeFruit(fruitX, fruitY);
-
-					// Saves the moment when the new fruit has been drawn 
-					gettimeofday(&initTimeFruit, NULL);
-
-					// As the fruit is new, the delay by the pause is reset
-					durationTimePause = (struct timeval){0};
-				}
-
-				// Shows bottom bar
-				graphics->showBottomBar(frameColor);
+				// Shows bottom bar, with the score and the timer with the countdown. It is drawn first, so the fruit
+				// and its progress bar are drawn over it when they are near the bottom
+				graphics->showScoreBar( frameColor, intToString(simulation->getSuccesses()), intToString(simulation->getFailures()), simulation->getRemainingSeconds() );
 
 				// Shows the fruit of the game
 				graphics->showFruit(frameColor);
 
-				// Calculates the progress of the fruit
-				fruitClockProgress = getTimevalUsec(currentTimeGame) - getTimevalUsec(initTimeFruit) - getTimevalUsec(durationTimePause);
-				cout<<"PreEnvio: "<<fruitClockProgress<<endl;
-				// Shows the progress bar of the fruit
-				graphics->showFruitClock( frameColor, fruitClockProgress, fruitDuration );
-
-				// Shows score
-				graphics->showScore( frameColor, intToString(score[0]), intToString(score[1]) );
-
-				// Calculates the current duration of the game
-				totalTimeGame.tv_sec = currentTimeGame.tv_sec - initTimeGame.tv_sec - accumulatedTimePause.tv_sec;
-				totalTimeGame.tv_usec = currentTimeGame.tv_usec - initTimeGame.tv_usec - accumulatedTimePause.tv_usec;
-
-				// Shows the timer with the countdown
-				graphics->showTimer( frameColor, maxDuration-(totalTimeGame.tv_sec) );
+				// Shows the progress bar of the fruit, interpolated between the ticks
+				graphics->showFruitClock( frameColor, simulation->getFruitProgress(nowUsec), fruitDuration );
 			}
 		}
 		else if(mode == PAUSING || mode == PAUSE || mode == DISPAUSING || mode == USER_LOST_PAUSING || mode == USER_LOST_PAUSE || mode == USER_LOST_DISPAUSING)
 		{
-			// Shows bottom bar
-			graphics->showBottomBar(frameColor);
+			// Shows bottom bar, with the score and the timer with the countdown
+			graphics->showScoreBar( frameColor, intToString(simulation->getSuccesses()), intToString(simulation->getFailures()), simulation->getRemainingSeconds() );
 
 			// Shows the fruit of the game
 			graphics->showFruit(frameColor);
 
-			// Shows the progress bar of the fruit
-			graphics->showFruitClock( frameColor, fruitClockProgress, fruitDuration );
-
-			// Shows score
-			graphics->showScore( frameColor, intToString(score[0]), intToString(score[1]) );
-
-			// Shows the timer with the countdown
-			graphics->showTimer( frameColor, maxDuration-(totalTimeGame.tv_sec) );
+			// Shows the progress bar of the fruit, which is stopped during the pause
+			graphics->showFruitClock( frameColor, simulation->getFruitProgress(nowUsec), fruitDuration );
 
 			if(mode == PAUSING)
 			{
-				// Saves the moment when the pause was started
-				gettimeofday(&initTimePause, NULL);
+				// The ticks of the pause do not count for the game nor for the fruit
+				simulation->pause();
 
 				// Starts pause mode
 				mode = PAUSE;
@@ -413,21 +463,15 @@ int main(int argc, char** argv)
 			}
 			else if(mode == DISPAUSING)
 			{
-				// Saves the duration of the pause
-				durationTimePause.tv_sec = currentTimeGame.tv_sec - initTimePause.tv_sec;
-				durationTimePause.tv_usec = currentTimeGame.tv_usec - initTimePause.tv_usec;
-
-				// Adds the duration of the pause to the sum of all the pauses of the game
-				accumulatedTimePause.tv_sec = accumulatedTimePause.tv_sec + durationTimePause.tv_sec;
-				accumulatedTimePause.tv_usec = accumulatedTimePause.tv_usec + durationTimePause.tv_usec;
+				simulation->resume();
 
 				// Returns to the game
 				mode = GAME;
 			}
 			else if(mode == USER_LOST_PAUSING)
 			{
-				// Saves the moment when the pause was started
-				gettimeofday(&initTimePause, NULL);
+				// The ticks of the pause do not count for the game nor for the fruit
+				simulation->pause();
 
 				// Starts pause mode
 				mode = USER_LOST_PAUSE;
@@ -441,13 +485,7 @@ int main(int argc, char** argv)
 			}
 			else if(mode == USER_LOST_DISPAUSING)
 			{
-				// Saves the duration of the pause
-				durationTimePause.tv_sec = currentTimeGame.tv_sec - initTimePause.tv_sec;
-				durationTimePause.tv_usec = currentTimeGame.tv_usec - initTimePause.tv_usec;
-
-				// Adds the duration of the pause to the sum of all the pauses of the game
-				accumulatedTimePause.tv_sec = accumulatedTimePause.tv_sec + durationTimePause.tv_sec;
-				accumulatedTimePause.tv_usec = accumulatedTimePause.tv_usec + durationTimePause.tv_usec;
+				simulation->resume();
 
 				// Returns to the game
 				mode = GAME;
@@ -456,16 +494,12 @@ int main(int argc, char** argv)
 		else if(mode == SCORE_SCREEN)
 		{
 			// Shows the score screen
-			graphics->showScoreScreen( frameColor, intToString(score[0]), intToString(score[1]) );
+			graphics->showScoreScreen( frameColor, intToString(simulation->getSuccesses()), intToString(simulation->getFailures()) );
 		}
 		else if(mode == LEAVING)
 		{
-			// If the user is identified
-			if(idUser != "")
-			{
-				db1->insertGame(idUser, startDate, endDate, score[0], score[1]);
-				db1->updateUserTotalScore(idUser, score[0], score[1]);
-			}
+			// Saves the samples still waiting in the queue. The game was saved when it finished
+			telemetry->stop();
 		}
 
 
@@ -479,16 +513,27 @@ int main(int argc, char** argv)
 			case(USER_NOT_FOUND): graphics->showUserState(frameColor, "BUSCANDO USUARIO"); break;
 		}
 
-	
+		gameScope.stop();
+
+		// Shows the times of the stages, if the overlay is enabled
+		profiler->drawOverlay(frameColor);
+
 		// Shows the color frame if it is not empty
+		ProfileScope showScope(profiler, stageShow);
 		if( !frameColor.empty() )
 		{
         	imshow("Sistema Kinect para el desarrollo de la motricidad gruesa", frameColor);
     	}
+		showScope.stop();
+
+		// Gives the frame back to the capture thread
+		capture->releaseFrame();
 
 
 		// Waits for a key input
+		ProfileScope keyScope(profiler, stageKey);
 		key = waitKey(2);
+		keyScope.stop();
 
 		if (key == 27 || mode == LEAVING) // Escape -> Exit
 		{
@@ -505,20 +550,54 @@ int main(int argc, char** argv)
 				mode = DISPAUSING;
 			}
 		}
-		else if (key == 82 || key == 114) // R -> Records a file *.oni
+		else if ((key == 82 || key == 114) && kinect1 != NULL) // R -> Records a file *.oni
 		{
 			kinect1->startRecordStream("gameVideo.oni", RGB_AND_DEPTH);
 		}
-		else if (key == 83 || key == 115) // S -> Stops recording
+		else if ((key == 83 || key == 115) && kinect1 != NULL) // S -> Stops recording
 		{
 			kinect1->stopRecordStream();
 		}
+		else if (key == 84 || key == 116) // T -> Shows or hides the times of the stages
+		{
+			profiler->toggleOverlay();
+		}
+
+	}
+
+	// Stops the capture thread and reports the frames that were not shown
+	capture->stop();
+	captureStats = capture->getStats();
+	cout<<"Capture: "<<captureStats.captured<<" frames read, "<<captureStats.published<<" published, "<<captureStats.dropped<<" dropped, "<<captureStats.overruns<<" overruns, "<<captureStats.failed<<" failed reads."<<endl;
+
+	// Reports the samples that could not be saved
+	telemetry->stop();
+	telemetryStats = telemetry->getStats();
+	cout<<"Telemetry: "<<telemetryStats.written<<" samples saved in "<<telemetryStats.batches<<" transactions, "<<telemetryStats.dropped<<" dropped, "<<telemetryStats.failed<<" failed, "<<telemetryStats.sessionRecords<<" in the session file."<<endl;
+	cout<<"Database: locked by other programs "<<telemetryStats.database.busyWaits<<" times ("<<telemetryStats.database.busyWaitMs<<" ms waited), "<<telemetryStats.database.retries<<" retries, "<<telemetryStats.database.busyFailures<<" statements failed."<<endl;
+
+	// Reports the part of the frames drawn by the graphics
+	graphicsDamage = graphics->getTotalDamage();
+	if(graphicsDamage.frames > 0)
+		cout<<"Graphics: "<<graphicsDamage.pixels / graphicsDamage.frames<<" pixels drawn per frame ("<<100.0 * graphicsDamage.pixels / graphicsDamage.frames / (WIN_SIZE_X * WIN_SIZE_Y)<<"% of the frame) in "<<graphicsDamage.rects / graphicsDamage.frames<<" rectangles."<<endl;
+
+	// Saves the times of the stages, if they were recorded
+	if(profiler->hasSamples())
+	{
+		string profilePath = Profiler::sessionFileName("game");
 
+		if(profiler->writeCsv(profilePath))
+			cout<<"Profile: times of the stages saved in "<<profilePath<<"."<<endl;
 	}
 
+	delete capture;
+	delete simulation;
 	delete kinect1;
+	delete synthetic;
 	delete db1;
 	delete graphics;
+	delete telemetry;
+	delete profiler;
 
 	return 0;
 }
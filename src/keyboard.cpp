@@ -14,6 +14,7 @@
 #include "Kinect.h"
 #include "Database.h"
 #include "Graphics.h"
+#include "Profiler.h"
 
 using namespace cv;
 using namespace std;
@@ -34,6 +35,7 @@ int main(int argc, char** argv)
 {
 	Mat frameChroma = imread("./img/background.jpg", CV_LOAD_IMAGE_COLOR); // Loads the background image
 	Mat frameColor; // Frame to store the image from the RGB camera
+	KinectFrame colorFrame; // Frame of the RGB camera, read without copying it
 	Mat frameColorFlipped; // Auxiliary frame used to flip the color frame.
 
 	Mode mode = KEYBOARD; // By default, the mode is keyboard
@@ -55,9 +57,27 @@ int main(int argc, char** argv)
 
 	bool keyButtonPressed = false;
 
+	JointFilterConfig filterConfig; // Parameters of the filter of the joints
+	DatabaseConfig databaseConfig; // Settings of the connections to the database
+	int stageTracker, stageColor, stageUsers, stageKeyboard, stageShow, stageKey; // Stages of the frame measured by the profiler
+
 	Kinect *kinect1 = new Kinect();
-	Database *db1 = new Database();
+	const FrameSnapshot &snapshot = kinect1->getSnapshot(); // Tracker data of the current frame
+	Database *db1; // Connection of the keyboard, opened when the settings of the database are known
 	Graphics *graphics = new Graphics();
+	Profiler *profiler = new Profiler();
+
+
+	// Chooses the settings of the database: 'synchronous[:checkpointPages[:busyTimeoutMs[:busyRetries]]]'
+	if(getenv("KINECT_DATABASE") != NULL)
+	{
+		if(Database::parseConfig(getenv("KINECT_DATABASE"), databaseConfig))
+			Database::setConfig(databaseConfig);
+		else
+			cout<<"ERROR: Invalid database settings: "<<getenv("KINECT_DATABASE")<<endl;
+	}
+
+	db1 = new Database();
 
 
 	if(argc == 3)
@@ -117,6 +137,26 @@ int main(int argc, char** argv)
 	// Starts users tracking
 	kinect1->startUserTracking();
 
+	// Chooses the filter of the joints: 'none', 'oneeuro[:minCutoff[:beta[:leadMs]]]' or 'kalman[:processNoise[:measurementNoise[:leadMs]]]'
+	if(getenv("KINECT_FILTER") != NULL)
+	{
+		if(JointFilter::parseConfig(getenv("KINECT_FILTER"), filterConfig))
+			kinect1->setJointFilter(filterConfig);
+		else
+			cout<<"ERROR: Invalid joint filter: "<<getenv("KINECT_FILTER")<<endl;
+	}
+
+	// Adds the stages of the frame to the profiler. The times are recorded from the beginning if
+	// KINECT_PROFILE is set, or after the 'T' key is pressed
+	stageTracker = profiler->addStage("tracker");
+	stageColor = profiler->addStage("color");
+	stageUsers = profiler->addStage("users");
+	stageKeyboard = profiler->addStage("keyboard");
+	stageShow = profiler->addStage("imshow");
+	stageKey = profiler->addStage("waitKey");
+	graphics->setProfiler(profiler);
+	profiler->setEnabled(getenv("KINECT_PROFILE") != NULL);
+
 	// Sets the name of the window
 	namedWindow("Teclado virtual: Sistema Kinect para el desarrollo de la motricidad gruesa", CV_WINDOW_AUTOSIZE);
 
@@ -124,53 +164,68 @@ int main(int argc, char** argv)
 	while(true)
 	{
 		// Gets the next snapshot of the skeleton tracking algorithm
+		ProfileScope trackerScope(profiler, stageTracker);
 		if (!kinect1->readTrackerFrame())
 		{
 			cout<<"Get next frame failed!"<<endl;
 			continue;
 		}
+		trackerScope.stop();
 
-		// Reads a frame from the RGB camera and store it in 'frameColor'
-		kinect1->readFrame(frameColor, NI_SENSOR_COLOR);
+		// Reads a frame from the RGB camera without copying it
+		ProfileScope colorScope(profiler, stageColor);
+		if (kinect1->readFrame(colorFrame, NI_SENSOR_COLOR))
+		{
+			// Converts the frame to BGR, inserts a background image as if it were a chroma and flips the frame,
+			// reading the buffer of OpenNI only once
+			if (!kinect1->insertChromaMirrored(colorFrame.image, frameColor, frameChroma))
+			{
+				// If the user map does not cover the frame, the steps are done one after the other
+				cvtColor(colorFrame.image, frameColor, CV_RGB2BGR);
+				kinect1->insertChroma(frameColor, frameChroma);
+				cv::flip(frameColor, frameColorFlipped, 1);
+				frameColor = frameColorFlipped;
+			}
 
-		// Inserts a background image, as if it were a chroma
-		kinect1->insertChroma(frameColor, frameChroma);
+			colorFrame.release();
+		}
+		colorScope.stop();
 
 		// Detects the users and stores the coordinates of the joints
+		ProfileScope usersScope(profiler, stageUsers);
 		kinect1->usersManagement();
+		usersScope.stop();
 
-		// Flips the RGB frame
-		cv::flip(frameColor, frameColorFlipped, 1);
-		frameColor = frameColorFlipped;
+		ProfileScope keyboardScope(profiler, stageKeyboard);
 
 
 		// For each user detected
-		for (int i = 0; i < kinect1->getUsersNumber(); i++)
+		for (int i = 0; i < snapshot.usersNumber; i++)
 		{
 			// If the user is been tracked
-			if( kinect1->usersInfo[i].userState == TRACKING )
+			if( snapshot.usersInfo[i].userState == TRACKING )
 			{
 				// If the right hand coordinates are available
-				if(kinect1->usersInfo[i].rightHandX != -1)
+				if(snapshot.usersInfo[i].rightHandX != -1)
 				{
 					// Shows a marker around the right hand
-					graphics->showSelectJoint(frameColor, kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY);
+					graphics->showSelectJoint(frameColor, snapshot.usersInfo[i].rightHandX, snapshot.usersInfo[i].rightHandY);
 				}
 
 				// If the left hand coordinates are available
-				if(kinect1->usersInfo[i].leftHandX != -1)
+				if(snapshot.usersInfo[i].leftHandX != -1)
 				{
 					// Shows a marker around the left hand
-					graphics->showSelectJoint(frameColor, kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY);
+					graphics->showSelectJoint(frameColor, snapshot.usersInfo[i].leftHandX, snapshot.usersInfo[i].leftHandY);
 				}
 
 				if(mode == KEYBOARD)
 				{
 					// Calculates the intersection between the left hand and the intro button
-					if( graphics->intersectionEnterKey(kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY) )
+					if( graphics->intersectionEnterKey(snapshot.usersInfo[i].leftHandX, snapshot.usersInfo[i].leftHandY) )
 					{
 						// Calculates the intersection between the right hand and the intro button
-						if( graphics->intersectionEnterKey(kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY) && !keyButtonPressed )
+						if( graphics->intersectionEnterKey(snapshot.usersInfo[i].rightHandX, snapshot.usersInfo[i].rightHandY) && !keyButtonPressed )
 						{
 							if( table == USERS )
 							{
@@ -245,7 +300,7 @@ int main(int argc, char** argv)
 							{
 								for(int column = 0; column<10; column++)
 								{
-									if( graphics->intersectionKey(row, column, kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY) && !keyButtonPressed)
+									if( graphics->intersectionKey(row, column, snapshot.usersInfo[i].rightHandX, snapshot.usersInfo[i].rightHandY) && !keyButtonPressed)
 									{
 										// If the key selected is the delete key
 										if( graphics->getQwertyKey(row, column) == "delete" )
@@ -266,14 +321,14 @@ int main(int argc, char** argv)
 
 					}
 					// Calculates the intersection between the right hand and the intro button
-					else if( graphics->intersectionEnterKey(kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY) )
+					else if( graphics->intersectionEnterKey(snapshot.usersInfo[i].rightHandX, snapshot.usersInfo[i].rightHandY) )
 					{
 						// Calculates the intersection between the left hand and every key
 						for(int row = 0; row<4; row++)
 						{
 							for(int column = 0; column<10; column++)
 							{
-								if( graphics->intersectionKey(row, column, kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY) && !keyButtonPressed)
+								if( graphics->intersectionKey(row, column, snapshot.usersInfo[i].leftHandX, snapshot.usersInfo[i].leftHandY) && !keyButtonPressed)
 								{
 									// If the key selected is the delete key
 									if( graphics->getQwertyKey(row, column) == "delete" )
@@ -293,7 +348,7 @@ int main(int argc, char** argv)
 
 					}
 					// If there is not intersection, the user is been tracked and the hands are under the intro button
-					else if(kinect1->usersInfo[i].leftHandY != -1 && kinect1->usersInfo[i].rightHandY != -1 && kinect1->usersInfo[i].leftHandY > graphics->enterKey.y+graphics->enterKey.height && kinect1->usersInfo[i].rightHandY > graphics->enterKey.y+graphics->enterKey.height)
+					else if(snapshot.usersInfo[i].leftHandY != -1 && snapshot.usersInfo[i].rightHandY != -1 && snapshot.usersInfo[i].leftHandY > graphics->enterKey.y+graphics->enterKey.height && snapshot.usersInfo[i].rightHandY > graphics->enterKey.y+graphics->enterKey.height)
 					{
 						keyButtonPressed = false;
 					}
@@ -301,8 +356,8 @@ int main(int argc, char** argv)
 				else if(mode == KEYBOARD_CONFIRM)
 				{
 					// Calculates the intersection between any hand and the yes/no buttons, and gets the answer
-					if( (graphics->intersectionDialog(kinect1->usersInfo[i].leftHandX, kinect1->usersInfo[i].leftHandY, dialogAnswer)
-						|| graphics->intersectionDialog(kinect1->usersInfo[i].rightHandX, kinect1->usersInfo[i].rightHandY, dialogAnswer))
+					if( (graphics->intersectionDialog(snapshot.usersInfo[i].leftHandX, snapshot.usersInfo[i].leftHandY, dialogAnswer)
+						|| graphics->intersectionDialog(snapshot.usersInfo[i].rightHandX, snapshot.usersInfo[i].rightHandY, dialogAnswer))
 						&& !keyButtonPressed )
 					{
 						keyButtonPressed = true;
@@ -316,7 +371,7 @@ int main(int argc, char** argv)
 
 
 				// If the user is been tracked and the hands are under the intro button
-				if(kinect1->usersInfo[i].leftHandY != -1 && kinect1->usersInfo[i].rightHandY != -1 && kinect1->usersInfo[i].leftHandY > graphics->enterKey.y+graphics->enterKey.height && kinect1->usersInfo[i].rightHandY > graphics->enterKey.y+graphics->enterKey.height)
+				if(snapshot.usersInfo[i].leftHandY != -1 && snapshot.usersInfo[i].rightHandY != -1 && snapshot.usersInfo[i].leftHandY > graphics->enterKey.y+graphics->enterKey.height && snapshot.usersInfo[i].rightHandY > graphics->enterKey.y+graphics->enterKey.height)
 				{
 					keyButtonPressed = false;
 				}
@@ -325,19 +380,19 @@ int main(int argc, char** argv)
 
 
 		// Sets the user state
-		if(kinect1->getUsersNumber() == 0) // If no user has been detected ever
+		if(snapshot.usersNumber == 0) // If no user has been detected ever
 		{
 			graphics->showUserState(frameColor, "BUSCANDO USUARIO");
 			
 		}
 		else
 		{
-			for(int i = 0; i < kinect1->getUsersNumber(); i++)
+			for(int i = 0; i < snapshot.usersNumber; i++)
 			{
 				// If the user is been tracked
-				if(kinect1->usersInfo[i].leftHandY != -1 || kinect1->usersInfo[i].rightHandY != -1)
+				if(snapshot.usersInfo[i].leftHandY != -1 || snapshot.usersInfo[i].rightHandY != -1)
 				{
-					switch(kinect1->usersInfo[i].userState)
+					switch(snapshot.usersInfo[i].userState)
 					{
 						case(USER_FOUND): graphics->showUserState(frameColor, "USUARIO DETECTADO"); break;
 						case(CALIBRATING): graphics->showUserState(frameColor, "CALIBRANDO"); break;
@@ -349,7 +404,7 @@ int main(int argc, char** argv)
 					break;
 				}
 				// If it is the last user, and none of them is been tracked
-				else if(i == kinect1->getUsersNumber()-1)
+				else if(i == snapshot.usersNumber-1)
 				{
 					graphics->showUserState(frameColor, "BUSCANDO USUARIO");
 				}
@@ -443,15 +498,24 @@ int main(int argc, char** argv)
 			}
 		}
 
+		keyboardScope.stop();
+
+		// Shows the times of the stages, if the overlay is enabled
+		profiler->drawOverlay(frameColor);
+
 		// Shows the color frame if it is not empty
+		ProfileScope showScope(profiler, stageShow);
 		if( !frameColor.empty() )
 		{
         	imshow("Teclado virtual: Sistema Kinect para el desarrollo de la motricidad gruesa", frameColor);
     	}
+		showScope.stop();
 
 
 		// Waits for a keyboard input
+		ProfileScope keyScope(profiler, stageKey);
 		char key = waitKey(5);
+		keyScope.stop();
 
 		if (key == 27 || mode == LEAVING) // Escape -> Exit
 		{
@@ -461,12 +525,26 @@ int main(int argc, char** argv)
 		{
 			mode = KEYBOARD;
 		}
+		else if (key == 84 || key == 116) // T -> Shows or hides the times of the stages
+		{
+			profiler->toggleOverlay();
+		}
+	}
+
+	// Saves the times of the stages, if they were recorded
+	if(profiler->hasSamples())
+	{
+		string profilePath = Profiler::sessionFileName("keyboard");
+
+		if(profiler->writeCsv(profilePath))
+			cout<<"Profile: times of the stages saved in "<<profilePath<<"."<<endl;
 	}
 
 	
 	delete kinect1;
 	delete db1;
 	delete graphics;
+	delete profiler;
 
 	return 0;
 }
@@ -7,10 +7,115 @@
 
 #include <gtk/gtk.h> // Include of GTK+ Graphic Interface
 #include <cstring> // Include for strcmp() function
-#include <cstdlib> // Include for system() function
+#include <cstdlib> // Include for system() and getenv() functions
+#include <iostream>
 #include "Database.h" // Header of the Database class
 
 
+/** Connection to the database, opened by main() for the whole life of the launcher and borrowed by the callbacks */
+Database *sharedDatabase = NULL;
+
+
+/**
+ Appends a user to a list store with two columns (id and name). Used to list the users in a single query.
+
+ @param user [in] User to be appended.
+ @param param [in] List store where the user is appended.
+
+ @return True, to keep on listing users.
+*/
+bool appendUserRow(const User &user, void *param)
+{
+	GtkListStore *liststore = (GtkListStore*)param;
+	GtkTreeIter iter;
+
+	gtk_list_store_append(liststore, &iter);
+	gtk_list_store_set(liststore, &iter, 0, user.id.c_str(), 1, user.name.c_str(), -1);
+
+	return true;
+}
+
+
+/**
+ Appends a user and its score to a list store with four columns (id, name, successes and failures).
+
+ @param user [in] User to be appended.
+ @param param [in] List store where the user is appended.
+
+ @return True, to keep on listing users.
+*/
+bool appendUserScoreRow(const User &user, void *param)
+{
+	GtkListStore *liststore = (GtkListStore*)param;
+	GtkTreeIter iter;
+
+	gtk_list_store_append(liststore, &iter);
+	gtk_list_store_set(liststore, &iter, 0, user.id.c_str(), 1, user.name.c_str(), 2, user.successes, 3, user.failures, -1);
+
+	return true;
+}
+
+
+/**
+ Appends a specialist to a list store with two columns (id and name).
+
+ @param specialist [in] Specialist to be appended.
+ @param param [in] List store where the specialist is appended.
+
+ @return True, to keep on listing specialists.
+*/
+bool appendSpecialistRow(const Specialist &specialist, void *param)
+{
+	GtkListStore *liststore = (GtkListStore*)param;
+	GtkTreeIter iter;
+
+	gtk_list_store_append(liststore, &iter);
+	gtk_list_store_set(liststore, &iter, 0, specialist.id.c_str(), 1, specialist.name.c_str(), -1);
+
+	return true;
+}
+
+
+/**
+ Appends a specialist to a list store with three columns (id, name and specialty).
+
+ @param specialist [in] Specialist to be appended.
+ @param param [in] List store where the specialist is appended.
+
+ @return True, to keep on listing specialists.
+*/
+bool appendSpecialistInfoRow(const Specialist &specialist, void *param)
+{
+	GtkListStore *liststore = (GtkListStore*)param;
+	GtkTreeIter iter;
+
+	gtk_list_store_append(liststore, &iter);
+	gtk_list_store_set(liststore, &iter, 0, specialist.id.c_str(), 1, specialist.name.c_str(), 2, specialist.specialty.c_str(), -1);
+
+	return true;
+}
+
+
+/**
+ Appends the date of a game to a list store with one column.
+
+ @param game [in] Game to be appended.
+ @param param [in] List store where the game is appended.
+
+ @return True, to keep on listing games.
+*/
+bool appendGameRow(const Game &game, void *param)
+{
+	GtkListStore *liststore = (GtkListStore*)param;
+	GtkTreeIter iter;
+
+	gtk_list_store_append(liststore, &iter);
+	gtk_list_store_set(liststore, &iter, 0, game.date.c_str(), -1);
+
+	return true;
+}
+
+
 /**
  Inserts the list of users in a combobox.
 
@@ -21,28 +126,13 @@
 */
 void createUsersCbox(GtkWidget **usersCbox, GtkListStore **liststore)
 {
-	Database db1;
-	User user1;
-	GtkTreeIter iter;
+	Database &db1 = *sharedDatabase;
 	GtkCellRenderer *cellrenderertext;
-	int tableSize = 0;
-	const gchar *nameData;
-	const gchar *idData;
 
 	// Creates a list store, to store the list of users
 	*liststore = gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_STRING);
-	// Gets the size of the table of users
-	db1.getUsersTableSize(tableSize);
 	// Saves all the users in the list store
-	for(int row = 0; row < tableSize; row++)
-	{
-		db1.getNUser(row, user1);
-		nameData = user1.name.c_str();
-		idData = user1.id.c_str();
-
-		gtk_list_store_append(*liststore, &iter);
-		gtk_list_store_set(*liststore, &iter, 0, idData, 1, nameData, -1);
-	}
+	db1.forEachUser(appendUserRow, *liststore);
 
 	// Creates a combobox with the previous users list store
 	*usersCbox = gtk_combo_box_new_with_model( GTK_TREE_MODEL(*liststore) );
@@ -69,30 +159,14 @@ void createUsersCbox(GtkWidget **usersCbox, GtkListStore **liststore)
 */
 void updateUsersCbox(GtkWidget *combobox, GtkListStore *liststore)
 {
-	Database db1;
-	User user1;
-	int tableSize = 0;
-	GtkTreeIter iter;
+	Database &db1 = *sharedDatabase;
 	GtkCellRenderer *cellrenderertext;
-	const gchar *nameData;
-	const gchar *idData;
 
 	// Clear the content of the list store
 	gtk_list_store_clear(liststore);
 
-	// Gets the size of the users table
-	db1.getUsersTableSize(tableSize);
-
 	// Saves all the users in the list store
-	for(int row = 0; row < tableSize; row++)
-	{
-		db1.getNUser(row, user1);
-		nameData = user1.name.c_str();
-		idData = user1.id.c_str();
-
-		gtk_list_store_append(liststore, &iter);
-		gtk_list_store_set(liststore, &iter, 0, idData, 1, nameData, -1);
-	}
+	db1.forEachUser(appendUserRow, liststore);
 
 	// Removes the renderers of the combobox
 	gtk_cell_layout_clear( GTK_CELL_LAYOUT(combobox) );
@@ -122,28 +196,13 @@ void updateUsersCbox(GtkWidget *combobox, GtkListStore *liststore)
 */
 void createSpecialistsCbox(GtkWidget **specialistsCbox, GtkListStore **liststore)
 {
-	Database db1;
-	Specialist specialist1;
-	GtkTreeIter iter;
+	Database &db1 = *sharedDatabase;
 	GtkCellRenderer *cellrenderertext;
-	int tableSize = 0;
-	const gchar *nameData;
-	const gchar *idData;
 
 	// Creates a list store, to store the list of specialists
 	*liststore = gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_STRING);
-	// Gets the size of the table of specialists
-	db1.getSpecialistsTableSize(tableSize);
 	// Saves all the specialists in the list store
-	for(int row = 0; row < tableSize; row++)
-	{
-		db1.getNSpecialist(row, specialist1);
-		nameData = specialist1.name.c_str();
-		idData = specialist1.id.c_str();
-
-		gtk_list_store_append(*liststore, &iter);
-		gtk_list_store_set(*liststore, &iter, 0, idData, 1, nameData, -1);
-	}
+	db1.forEachSpecialist(appendSpecialistRow, *liststore);
 
 	// Creates a combobox with the previous specialists list store
 	*specialistsCbox = gtk_combo_box_new_with_model( GTK_TREE_MODEL(*liststore) );
@@ -225,7 +284,7 @@ void exportUsersList(GtkWidget *widget, gpointer data)
 void exportGameData(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	User user1;
 	Game game1;
 	int posUser, posGame;
@@ -245,7 +304,7 @@ void exportGameData(GtkWidget *widget, gpointer data)
 	db1.getNGamesbyUser(user1.id, posGame, game1);
 
 	// Command to export the game data of a game of a user
-	string command = "sqlite3 -header -csv database.db 'SELECT * FROM GAME_DATA WHERE GAME_ID = "+game1.gameId+";' > datosPartida"+game1.gameId+"deUsuario"+user1.id+".csv";
+	string command = "sqlite3 -header -csv database.db 'SELECT * FROM GAME_DATA WHERE GAME_ID = "+game1.gameId+" ORDER BY FRAME_NO;' > datosPartida"+game1.gameId+"deUsuario"+user1.id+".csv";
 
 	// Runs the previous command
 	system(command.c_str());
@@ -270,7 +329,7 @@ void exportGameData(GtkWidget *widget, gpointer data)
 void exportUserGames(GtkWidget *widget, gpointer dialog)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	User user1;
 	int posUser;
 
@@ -284,7 +343,7 @@ void exportUserGames(GtkWidget *widget, gpointer dialog)
 	db1.getNUser(posUser, user1);
 
 	// Command to export the games of a user to a *.csv file
-	string command = "sqlite3 -header -csv -column database.db 'SELECT * FROM GAMES WHERE USER_ID = "+user1.id+";' > partidas"+user1.id+".csv";
+	string command = "sqlite3 -header -csv -column database.db 'SELECT * FROM GAMES WHERE USER_ID = "+user1.id+" AND END_DATE IS NOT NULL ORDER BY GAME_ID;' > partidas"+user1.id+".csv";
 
 	// Runs the previous command
 	system(command.c_str());
@@ -309,7 +368,7 @@ void exportUserGames(GtkWidget *widget, gpointer dialog)
 void addUser(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	DatabaseMessage rc;
 
 	// Gets the data sent
@@ -357,7 +416,7 @@ void addUser(GtkWidget *widget, gpointer data)
 void updateUser(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	DatabaseMessage rc = OK;
 	User userDB;
 	User userInserted;
@@ -421,7 +480,7 @@ void updateUser(GtkWidget *widget, gpointer data)
 void deleteUser(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	DatabaseMessage rc;
 	User user1;
 	int posUser;
@@ -474,7 +533,7 @@ void deleteUser(GtkWidget *widget, gpointer data)
 void addSpecialist(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	DatabaseMessage rc;
 
 	// Gets the data sent
@@ -516,7 +575,7 @@ void addSpecialist(GtkWidget *widget, gpointer data)
 void updateSpecialist(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	DatabaseMessage rc = OK;
 	Specialist specialistDB;
 	Specialist specialistInserted;
@@ -581,7 +640,7 @@ void updateSpecialist(GtkWidget *widget, gpointer data)
 void deleteSpecialist(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	DatabaseMessage rc;
 	Specialist specialist1;
 	int posSpecialist;
@@ -627,7 +686,7 @@ void deleteSpecialist(GtkWidget *widget, gpointer data)
 void linkUserSpecialist(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	DatabaseMessage rc;
 	User user1;
 	Specialist specialist1;
@@ -678,7 +737,7 @@ void linkUserSpecialist(GtkWidget *widget, gpointer data)
 void unlinkUserSpecialist(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	DatabaseMessage rc;
 	User user1;
 	Specialist specialist1;
@@ -751,7 +810,7 @@ bool entryIsValid(const char *string, int bottom, int top)
 void runGame(GtkWidget *widget, gpointer data)
 {
 	GtkWidget *messageDialog;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	User user1;
 	string command;
 
@@ -841,16 +900,12 @@ void exportGameDataDialog(GtkWidget *widget, gpointer data)
 	GtkWidget *gamesCbox;
 	GtkWidget *button;
 	GtkListStore *liststore;
-	GtkTreeIter iter;
 	GtkCellRenderer *cellrenderertext;
 	GtkWidget *label;
 
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	User user;
-	Game game;
 	int posUser;
-	int gamesNum = 0;
-	const gchar *dateData;
 
 
 	// Gets the data sent
@@ -871,17 +926,8 @@ void exportGameDataDialog(GtkWidget *widget, gpointer data)
 
 	// Creates a list store, to store the list of games
 	liststore = gtk_list_store_new(2, G_TYPE_STRING, G_TYPE_STRING);
-	// Gets the number of games that this user has played
-	db1.getUserGamesNum(user.id, gamesNum);
 	// Saves all the games of the user in the list store
-	for(int row = 0; row < gamesNum; row++)
-	{
-		db1.getNGamesbyUser(user.id, row, game);
-		dateData = game.date.c_str();
-
-		gtk_list_store_append(liststore, &iter);
-		gtk_list_store_set(liststore, &iter, 0, dateData, /*1, nameData,*/ -1);
-	}
+	db1.forEachGameByUser(user.id, appendGameRow, liststore);
 
 	// Creates a combobox with the previous users list store
 	gamesCbox = gtk_combo_box_new_with_model( GTK_TREE_MODEL(liststore) );
@@ -1044,7 +1090,7 @@ void updateUserDialog(GtkWidget *widget, gpointer data)
 	GtkWidget *updateButton;
 	GtkWidget *vbox, *hbox1, *hbox2;
 	GtkWidget *grid;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	User user1;
 	int posUser;
 
@@ -1143,7 +1189,7 @@ void chooseUserDialog(GtkWidget *widget, gpointer data)
 	GtkWidget *button;
 	GtkListStore *dialogListstore;
 
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	const gchar *nameData;
 	const gchar *idData;
 
@@ -1247,13 +1293,9 @@ void usersListDialog(GtkWidget *widget, gpointer data)
 	GtkWidget *vbox;
 	GtkWidget *treeView;
 	GtkListStore *liststore;
-	GtkTreeIter iter;
 	GtkTreeViewColumn *col;
 	GtkCellRenderer *renderer;
-	Database db1;
-	User user1;
-	int tableSize = 0;
-	const gchar *nameData, *idData;
+	Database &db1 = *sharedDatabase;
 
 	
 	// Creates a new dialog
@@ -1267,18 +1309,8 @@ void usersListDialog(GtkWidget *widget, gpointer data)
 
 	// Creates a list store, to store the list of users
 	liststore = gtk_list_store_new(4, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT, G_TYPE_INT);
-	// Gets the size of the table of users
-	db1.getUsersTableSize(tableSize);
 	// Saves all the users in the list store
-	for(int row = 0; row < tableSize; row++)
-	{
-		db1.getNUser(row, user1);
-		nameData = user1.name.c_str();
-		idData = user1.id.c_str();
-
-		gtk_list_store_append(liststore, &iter);
-		gtk_list_store_set(liststore, &iter, 0, idData, 1, nameData, 2, user1.successes, 3, user1.failures, -1);
-	}
+	db1.forEachUser(appendUserScoreRow, liststore);
 
 	// Creates a tree view with the previous list store
 	treeView = gtk_tree_view_new_with_model( GTK_TREE_MODEL(liststore) );
@@ -1447,7 +1479,7 @@ void updateSpecialistDialog(GtkWidget *widget, gpointer data)
 	GtkWidget *updateButton;
 	GtkWidget *vbox, *hbox1, *hbox2;
 	GtkWidget *grid;
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	Specialist specialist1;
 	int posSpecialist;
 
@@ -1553,7 +1585,7 @@ void chooseSpecialistDialog(GtkWidget *widget, gpointer data)
 	GtkWidget *button;
 	GtkListStore *dialogListstore;
 
-	Database db1;
+	Database &db1 = *sharedDatabase;
 	const gchar *nameData;
 	const gchar *idData;
 
@@ -1633,12 +1665,9 @@ void specialistsListDialog(GtkWidget *widget, gpointer data)
 	GtkWidget *vbox;
 	GtkWidget *treeView;
 	GtkListStore *liststore;
-	GtkTreeIter iter;
 	GtkTreeViewColumn *col;
 	GtkCellRenderer *renderer;
-	Database db1;
-	Specialist specialist1;
-	int tableSize = 0;
+	Database &db1 = *sharedDatabase;
 	
 	// Creates a new dialog
 	dialog = gtk_dialog_new();
@@ -1651,16 +1680,8 @@ void specialistsListDialog(GtkWidget *widget, gpointer data)
 
 	// Creates a list store, to store the list of specialists
 	liststore = gtk_list_store_new(3, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
-	// Gets the size of the table of specialists
-	db1.getSpecialistsTableSize(tableSize);
 	// Saves all the specialists in the list store
-	for(int row = 0; row < tableSize; row++)
-	{
-		db1.getNSpecialist(row, specialist1);
-
-		gtk_list_store_append(liststore, &iter);
-		gtk_list_store_set(liststore, &iter, 0, specialist1.id.c_str(), 1, specialist1.name.c_str(), 2, specialist1.specialty.c_str(), -1);
-	}
+	db1.forEachSpecialist(appendSpecialistInfoRow, liststore);
 
 	// Creates a tree view with the previous list store
 	treeView = gtk_tree_view_new_with_model( GTK_TREE_MODEL(liststore) );
@@ -1828,7 +1849,7 @@ int main(int argc, char *argv[])
 
 	const gchar *gameDurationBuffer;
 	const gchar *fruitDurationBuffer;
-	Database db1;
+	DatabaseConfig databaseConfig;
 	User user1;
 	int tableSize = 0;
 	const gchar *nameData;
@@ -1841,6 +1862,19 @@ int main(int argc, char *argv[])
 	// Initializes everything needed to operate the toolkit and parses arguments from the command line to the application
 	gtk_init(&argc, &argv);
 
+	// Chooses the settings of the database: 'synchronous[:checkpointPages[:busyTimeoutMs[:busyRetries]]]'
+	if(getenv("KINECT_DATABASE") != NULL)
+	{
+		if(Database::parseConfig(getenv("KINECT_DATABASE"), databaseConfig))
+			Database::setConfig(databaseConfig);
+		else
+			cout<<"ERROR: Invalid database settings: "<<getenv("KINECT_DATABASE")<<endl;
+	}
+
+	// The connection of the launcher stays open. The file uses a write-ahead log, so the game writes while the launcher reads
+	Database db1;
+	sharedDatabase = &db1;
+
 	// Creates the main window
 	mainWindow = gtk_window_new(GTK_WINDOW_TOPLEVEL);
 
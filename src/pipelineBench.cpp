@@ -0,0 +1,416 @@
+/**
+ @file   pipelineBench.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Benchmark of the whole pipeline of the game, without a window: frame source, background replacement,
+ 	graphics and telemetry. The frames are synthetic or read from a recorded *.oni file.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdio> // Include for remove() function
+#include <cstdlib>
+#include <cstring> // Include for strstr() function
+#include "cvaux.h" // Include for OpenCV
+#include "highgui.h" // Include for OpenCV
+
+#include "Kinect.h"
+#include "Graphics.h"
+#include "TelemetryWriter.h"
+#include "FrameCapture.h"
+#include "SyntheticSource.h"
+#include "GameSimulation.h"
+
+//Macros
+#define PIPELINE_FRAMES		300
+#define PIPELINE_WARMUP		30 // Frames read before measuring, so the user is already tracked
+#define PIPELINE_DATABASE	"pipelineBench.db" // Database of the telemetry, removed at the end
+#define PIPELINE_FRUIT_DURATION	3 // Duration of a fruit, in seconds
+#define PIPELINE_GAME_DURATION	3600 // Duration of the game, long enough to never end during the benchmark
+#define PIPELINE_FRAME_US	(1000000 / SYNTHETIC_FPS) // Time of the game between two frames
+
+
+using namespace std;
+using namespace cv;
+
+
+/** Ways of making the RGB image of a frame */
+enum PipelineMode {STEPS, SINGLE_PASS, CAPTURE_THREAD};
+
+/** State of the game shared by all the frames of the benchmark */
+struct PipelineGame
+{
+	/* Graphics of the game */
+	Graphics *graphics;
+	/* Writer of the samples of the game */
+	TelemetryWriter *telemetry;
+	/* Rules of the game */
+	GameSimulation *simulation;
+	/* Simulated time of the game. It advances a frame of the sensor in every frame, so the game runs faster than real time */
+	long long clockUsec;
+	/* Number of the next sample. It is not reset between the configurations, so all the samples have their own key */
+	int frame;
+};
+
+
+/**
+ Converts a integer in a string.
+
+ @param [in] number The number to be converted.
+
+ @return A string containing the number.
+*/
+string intToString(int number)
+{
+	ostringstream convert;
+	convert << number;
+
+	return ( convert.str() );
+}
+
+
+/**
+ Gets the time since an instant, in milliseconds.
+
+ @param [in] start Instant, in ticks.
+
+ @return Milliseconds since the instant.
+*/
+double elapsedMs(int64 start)
+{
+	return (getTickCount() - start) * 1000.0 / getTickFrequency();
+}
+
+
+/**
+ Does the work of the game over a frame, as game.cpp does in the game mode: runs the ticks of the game,
+ draws the graphics and queues the skeleton of the tracked user.
+
+ @param [in,out] game State of the game.
+ @param [in,out] frameColor Frame where the graphics are drawn. It must be already mirrored.
+ @param [in] usersInfo Coordinates and state of the users.
+ @param [in] usersNumber Number of users.
+
+ @return Nothing.
+*/
+void playFrame(PipelineGame &game, Mat &frameColor, const userInfo *usersInfo, int usersNumber)
+{
+	Graphics *graphics = game.graphics;
+	GameSimulation *simulation = game.simulation;
+	GameSample sample;
+	string userState = "BUSCANDO USUARIO";
+
+	graphics->beginFrame();
+
+	simulation->setHands(usersInfo, usersNumber, game.clockUsec);
+	simulation->advance(game.clockUsec);
+
+	for (int i = 0; i < usersNumber; i++)
+	{
+		const userInfo &user = usersInfo[i];
+
+		if (user.userState != TRACKING)
+			continue;
+
+		userState = "SIGUIENDO";
+
+		if (user.rightHandX != -1)
+			graphics->showGameJoint(frameColor, user.rightHandX, user.rightHandY);
+		if (user.leftHandX != -1)
+			graphics->showGameJoint(frameColor, user.leftHandX, user.leftHandY);
+
+		// Queues the skeleton, as the game does in every frame
+		sample.time = simulation->getElapsedSeconds();
+		sample.gameId = -1;
+		sample.frame = game.frame++;
+		sample.fruitX = simulation->getFruitX();
+		sample.fruitY = simulation->getFruitY();
+		sample.headX = user.headX;
+		sample.headY = user.headY;
+		sample.neckX = user.neckX;
+		sample.neckY = user.neckY;
+		sample.leftShoulderX = user.leftShoulderX;
+		sample.leftShoulderY = user.leftShoulderY;
+		sample.rightShoulderX = user.rightShoulderX;
+		sample.rightShoulderY = user.rightShoulderY;
+		sample.leftElbowX = user.leftElbowX;
+		sample.leftElbowY = user.leftElbowY;
+		sample.rightElbowX = user.rightElbowX;
+		sample.rightElbowY = user.rightElbowY;
+		sample.leftHandX = user.leftHandX;
+		sample.leftHandY = user.leftHandY;
+		sample.rightHandX = user.rightHandX;
+		sample.rightHandY = user.rightHandY;
+		sample.leftHipX = user.leftHipX;
+		sample.leftHipY = user.leftHipY;
+		sample.rightHipX = user.rightHipX;
+		sample.rightHipY = user.rightHipY;
+		game.telemetry->push(sample);
+
+		break;
+	}
+
+	graphics->showScoreBar(frameColor, intToString(simulation->getSuccesses()), intToString(simulation->getFailures()), simulation->getRemainingSeconds());
+	graphics->showFruit(frameColor);
+	graphics->showFruitClock(frameColor, simulation->getFruitProgress(game.clockUsec), PIPELINE_FRUIT_DURATION);
+	graphics->showUserState(frameColor, userState);
+
+	game.clockUsec += PIPELINE_FRAME_US;
+}
+
+
+/**
+ Reads a frame from the source and makes its mirrored RGB image with the background inserted, in the
+ calling thread.
+
+ @param [in] source Source of the frames.
+ @param [in] chroma Background replacement.
+ @param [in] mode STEPS to convert, key and mirror in separate steps, SINGLE_PASS to do it in a single pass.
+ @param [out] frame Frame read. Its RGB image is not mirrored.
+ @param [out] sensorColor Image of the source, before it is converted.
+ @param [out] frameColor Mirrored RGB image with the background.
+
+ @return True if the frame was read, false otherwise.
+*/
+bool readInline(FrameSource *source, ChromaKey &chroma, PipelineMode mode, SourceFrame &frame, Mat &sensorColor, Mat &frameColor)
+{
+	bool isRgb;
+
+	if (mode == STEPS)
+	{
+		if ( !source->readSnapshot(frame) )
+			return false;
+
+		chroma.apply(frame.frameColor, (const unsigned short*)frame.userMap.data, frame.userMap.cols, frame.userMap.rows, (int)frame.userMap.step);
+		flip(frame.frameColor, frameColor, 1);
+
+		return true;
+	}
+
+	if ( !source->readRawSnapshot(frame, sensorColor, isRgb) )
+		return false;
+
+	// Converts, keys and mirrors the image in a single pass
+	if ( chroma.applyMirrored(sensorColor, isRgb, (const unsigned short*)frame.userMap.data, frame.userMap.cols, frame.userMap.rows, (int)frame.userMap.step, frameColor) )
+		return true;
+
+	// If the user map does not cover the image, the separate steps are used, as in FrameCapture
+	if (isRgb)
+		cvtColor(sensorColor, frame.frameColor, CV_RGB2BGR);
+	else
+		sensorColor.copyTo(frame.frameColor);
+
+	chroma.apply(frame.frameColor, (const unsigned short*)frame.userMap.data, frame.userMap.cols, frame.userMap.rows, (int)frame.userMap.step);
+	flip(frame.frameColor, frameColor, 1);
+
+	return true;
+}
+
+
+/**
+ Runs a configuration of the pipeline and prints its throughput and the percentiles of the time of a frame.
+
+ @param [in] name Name of the configuration.
+ @param [in] source Source of the frames.
+ @param [in] frameImageLoaded Image inserted in the background.
+ @param [in] mode How the RGB image is made.
+ @param [in,out] game State of the game.
+ @param [in] framesNum Number of frames measured.
+
+ @return True if all the frames were read, false otherwise.
+*/
+bool runPipeline(string name, FrameSource *source, const Mat &frameImageLoaded, PipelineMode mode, PipelineGame &game, int framesNum)
+{
+	vector<double> latencies;
+	SourceFrame frame;
+	Mat sensorColor, frameColor;
+	ChromaKey chroma;
+	FrameCapture *capture = NULL;
+	CapturedFrame *capturedFrame;
+	int64 start = 0, frameStart;
+	double totalMs;
+
+	latencies.reserve(framesNum);
+	chroma.setBackground(frameImageLoaded);
+
+	if (mode == CAPTURE_THREAD)
+	{
+		capture = new FrameCapture(source);
+		capture->setBackground(frameImageLoaded);
+		capture->setSinglePass(true);
+
+		if ( !capture->start() )
+		{
+			cout << "ERROR: The capture thread couldn't be created." << endl;
+			delete capture;
+			return false;
+		}
+	}
+
+	for (int i = -PIPELINE_WARMUP; i < framesNum; i++)
+	{
+		// The time starts after the warmup frames
+		if (i == 0)
+			start = getTickCount();
+
+		frameStart = getTickCount();
+
+		if (capture != NULL)
+		{
+			capturedFrame = capture->acquireLatestFrame(1000);
+			if (capturedFrame == NULL)
+				break;
+
+			playFrame(game, capturedFrame->frameColor, capturedFrame->usersInfo, capturedFrame->usersNumber);
+			capture->releaseFrame();
+		}
+		else
+		{
+			if ( !readInline(source, chroma, mode, frame, sensorColor, frameColor) )
+				break;
+
+			playFrame(game, frameColor, frame.usersInfo, frame.usersNumber);
+		}
+
+		if (i >= 0)
+			latencies.push_back(elapsedMs(frameStart));
+	}
+
+	totalMs = (latencies.size() > 0) ? elapsedMs(start) : 0;
+
+	if (capture != NULL)
+	{
+		capture->stop();
+		delete capture;
+	}
+
+	if ((int)latencies.size() < framesNum)
+	{
+		cout << "ERROR: The source stopped after " << latencies.size() << " frames (" << name << ")." << endl;
+		return false;
+	}
+
+	sort(latencies.begin(), latencies.end());
+
+	cout << left << setw(24) << name << right << fixed << setprecision(2)
+		<< setw(9) << framesNum * 1000.0 / totalMs
+		<< setw(9) << totalMs / framesNum
+		<< setw(9) << latencies[(framesNum - 1) * 50 / 100]
+		<< setw(9) << latencies[(framesNum - 1) * 95 / 100]
+		<< setw(9) << latencies[(framesNum - 1) * 99 / 100]
+		<< setw(9) << latencies[framesNum - 1] << endl;
+
+	return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+	int framesNum = PIPELINE_FRAMES;
+	const char *oniFile = NULL;
+	Kinect *kinect1 = NULL;
+	SyntheticSource *synthetic = NULL;
+	FrameSource *source;
+	TelemetryStats telemetryStats;
+	DatabaseConfig databaseConfig;
+	PipelineGame game;
+	bool rc = true;
+
+	// Arguments: [frames] [file.oni]
+	for (int i = 1; i < argc; i++)
+	{
+		if (strstr(argv[i], ".oni") != NULL)
+			oniFile = argv[i];
+		else
+			framesNum = atoi(argv[i]);
+	}
+
+	if (framesNum <= 0)
+	{
+		cout << "Usage: " << argv[0] << " [frames] [file.oni]" << endl;
+		return -1;
+	}
+
+	// The settings of the database can be compared: 'synchronous[:checkpointPages[:busyTimeoutMs[:busyRetries]]]'
+	if (getenv("KINECT_DATABASE") != NULL)
+	{
+		if (Database::parseConfig(getenv("KINECT_DATABASE"), databaseConfig))
+			Database::setConfig(databaseConfig);
+		else
+			cout << "ERROR: Invalid database settings: " << getenv("KINECT_DATABASE") << endl;
+	}
+
+	// The frames are read as fast as possible, so the benchmark measures the pipeline and not the sensor
+	if (oniFile != NULL)
+	{
+		kinect1 = new Kinect();
+		kinect1->init();
+
+		if ( !kinect1->openDevice(oniFile) || !kinect1->createDepthStream() || !kinect1->createColorStream() )
+		{
+			cout << "ERROR: The file " << oniFile << " couldn't be opened." << endl;
+			delete kinect1;
+			return -1;
+		}
+
+		kinect1->syncDepthColor();
+		kinect1->startUserTracking();
+		kinect1->setPlayback(-1, true);
+
+		source = kinect1;
+	}
+	else
+	{
+		synthetic = new SyntheticSource(false);
+		source = synthetic;
+	}
+
+	Mat frameImageLoaded = imread("./img/background.jpg", CV_LOAD_IMAGE_COLOR);
+
+	// The graphics load their images from ./img, so the benchmark must be run from the root of the project
+	game.graphics = new Graphics();
+	game.telemetry = new TelemetryWriter(TELEMETRY_QUEUE_SIZE, TELEMETRY_BATCH_SIZE, PIPELINE_DATABASE);
+	game.frame = 0;
+	game.telemetry->start();
+	game.simulation = new GameSimulation(game.graphics, PIPELINE_GAME_DURATION, PIPELINE_FRUIT_DURATION);
+
+	cout << "Pipeline of the game, " << ((oniFile != NULL) ? oniFile : "synthetic frames") << ", " << framesNum << " frames, " << getNumThreads() << " threads" << endl;
+	cout << left << setw(24) << "configuration" << right << setw(9) << "fps" << setw(9) << "mean" << setw(9) << "p50"
+		<< setw(9) << "p95" << setw(9) << "p99" << setw(9) << "max ms" << endl;
+
+	const char *names[3] = {"steps", "single pass", "single pass + thread"};
+	PipelineMode modes[3] = {STEPS, SINGLE_PASS, CAPTURE_THREAD};
+
+	for (int i = 0; i < 3 && rc; i++)
+	{
+		// Every configuration plays the same frames and the same fruits
+		if (synthetic != NULL)
+			synthetic->reset();
+		srand(0);
+
+		game.clockUsec = 0;
+		game.simulation->start(game.clockUsec);
+
+		rc = runPipeline(names[i], source, frameImageLoaded, modes[i], game, framesNum);
+	}
+
+	// Reports the samples that could not be saved
+	game.telemetry->stop();
+	telemetryStats = game.telemetry->getStats();
+	cout << "Telemetry: " << telemetryStats.written << " samples saved in " << telemetryStats.batches << " transactions, "
+		<< telemetryStats.dropped << " dropped, " << telemetryStats.failed << " failed, " << telemetryStats.highWatermark << " pending at most." << endl;
+	cout << "Database: locked " << telemetryStats.database.busyWaits << " times (" << telemetryStats.database.busyWaitMs << " ms waited), "
+		<< telemetryStats.database.retries << " retries, " << telemetryStats.database.busyFailures << " statements failed." << endl;
+
+	delete game.simulation;
+	delete game.telemetry;
+	delete game.graphics;
+	delete kinect1;
+	delete synthetic;
+
+	remove(PIPELINE_DATABASE);
+
+	return rc ? 0 : -1;
+}
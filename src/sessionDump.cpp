@@ -0,0 +1,90 @@
+/**
+ @file   sessionDump.cpp
+ @author Pedro Américo Toledano López
+ @date   October, 2026
+ @brief  Exports the records of a session file to CSV, reading the file with mmap.
+*/
+
+#include <iostream>
+#include <cstdlib>
+
+#include "SessionFile.h"
+
+
+using namespace std;
+
+
+/** Names of the joints, in the order of the skeleton */
+static const char *jointNames[SKELETON_JOINTS] =
+{
+	"head", "neck", "leftShoulder", "rightShoulder", "leftElbow", "rightElbow", "leftHand", "rightHand",
+	"torso", "leftHip", "rightHip", "leftKnee", "rightKnee", "leftFoot", "rightFoot"
+};
+
+
+int main(int argc, char *argv[])
+{
+	SessionReader reader;
+	unsigned long long from = 0;
+	unsigned long long to = (unsigned long long)-1;
+	unsigned long long first, recordsNum;
+	unsigned long long exported = 0;
+	const SessionRecord *record;
+
+	// Arguments: file.ses [fromSeconds [toSeconds]]
+	if (argc < 2 || argc > 4)
+	{
+		cout << "Usage: " << argv[0] << " file.ses [fromSeconds [toSeconds]]" << endl;
+		return -1;
+	}
+
+	if ( !reader.open(argv[1]) )
+		return -1;
+
+	const SessionHeader &header = reader.getHeader();
+	recordsNum = reader.getRecordsNumber();
+
+	// The times are relative to the first record
+	if (argc >= 3)
+		from = header.firstTimestamp + (unsigned long long)(atof(argv[2]) * 1000000);
+	if (argc == 4)
+		to = header.firstTimestamp + (unsigned long long)(atof(argv[3]) * 1000000);
+
+	cerr << "Game " << header.gameId << ": " << recordsNum << " records, " << header.indexEntries << " entries in the index"
+		<< ((header.indexOffset == 0) ? " (the file was not closed)." : ".") << endl;
+
+	// Header of the CSV
+	cout << "timestamp,gameTime,user,fruitX,fruitY";
+	for (int j = 0; j < SKELETON_JOINTS; j++)
+		cout << "," << jointNames[j] << "X," << jointNames[j] << "Y," << jointNames[j] << "Z," << jointNames[j] << "Confidence";
+	cout << endl;
+
+	// The index gives the first record of the range, and the rest are read in order
+	first = (argc >= 3) ? reader.findRecord(from) : 0;
+
+	for (unsigned long long r = first; r < recordsNum; r++)
+	{
+		record = reader.getRecord(r);
+
+		if (record->timestamp > to)
+			break;
+
+		cout << record->timestamp << "," << record->gameTime << "," << record->user << "," << record->fruitX << "," << record->fruitY;
+
+		// The joints that are not available are left empty
+		for (int j = 0; j < SKELETON_JOINTS; j++)
+		{
+			if (record->skeleton.valid & (1u << j))
+				cout << "," << record->skeleton.x[j] << "," << record->skeleton.y[j] << "," << record->skeleton.z[j] << "," << record->skeleton.confidence[j];
+			else
+				cout << ",,,,";
+		}
+		cout << "\n";
+
+		exported++;
+	}
+
+	cerr << exported << " records exported." << endl;
+
+	return 0;
+}